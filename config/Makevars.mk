@@ -47,6 +47,30 @@ ifdef MAKE_GUI
   COMMON_LDFLAGS += -DMFM_GUI_DRIVER
 endif
 
+# Use lock-free packet rings rather than mutex-guarded byte queues
+# between tiles
+ifdef LOCKFREE_CONNECTIONS
+  COMMON_CPPFLAGS += -DMFM_LOCKFREE_CONNECTIONS
+endif
+
+# Have tiles waiting on event acknowledgments block rather than
+# yield-poll their connections
+ifdef BLOCKING_FLUSH
+  COMMON_CPPFLAGS += -DMFM_BLOCKING_FLUSH
+endif
+
+# Have Random use the small, fast xoshiro128** generator rather than
+# the Mersenne Twister.  Snapshots are not portable between the two.
+ifdef FAST_RANDOM
+  COMMON_CPPFLAGS += -DMFM_FAST_RANDOM
+endif
+
+# Have tiles keep a dense plane of their atoms' types beside the
+# atoms themselves, for scans that need only the types
+ifdef TYPE_PLANE
+  COMMON_CPPFLAGS += -DMFM_TYPE_PLANE
+endif
+
 # Common flags: All about errors -- let's help them help us
 # Also: We need pthread!
 COMMON_CFLAGS+=-Wall -pedantic -Werror -Wundef -D SHARED_DIR=\"$(SHARED_DIR)\" -pthread
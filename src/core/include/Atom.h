@@ -180,6 +180,24 @@ namespace MFM
       return static_cast<const T*>(this)->GetTypeImpl();
     }
 
+    /**
+     * The value GetTypeIfSane returns for an insane Atom.  It is no
+     * Element's type.
+     */
+    static const u32 INSANE_TYPE = 0xffffffff;
+
+    /**
+     * Gets the type of this Atom if it is sane, or INSANE_TYPE if it
+     * is not, in one step.
+     *
+     * @remarks Subclasses of Atom may hide this with a faster version.
+     */
+    u32 GetTypeIfSane() const
+    {
+      const T & self = *static_cast<const T*>(this);
+      return self.IsSane() ? self.GetType() : INSANE_TYPE;
+    }
+
     /**
      * Prints this Atom in a semi-readable way to a ByteSink.
      *
@@ -314,6 +332,8 @@ namespace MFM
     }
   };
 
+  template <class CC>
+  const u32 Atom<CC>::INSANE_TYPE;
 
 } /* namespace MFM */
 
@@ -156,6 +156,24 @@ namespace MFM {
      */
     inline u32 Read(const u32 startIdx, const u32 length) const;
 
+    /**
+     * Reads the LEN bits starting at bit START, like Read(START,
+     * LEN), but with the position fixed at compile time: a single
+     * load, shift, and mask, with no bounds checks or branches.  The
+     * bits must lie within one BitUnitType, or this won't compile.
+     *
+     * @returns The bits read, right-justified.
+     */
+    template <u32 START, u32 LEN>
+    u32 ReadWithinUnit() const
+    {
+      COMPILATION_REQUIREMENT< (LEN > 0) >();
+      COMPILATION_REQUIREMENT< (START + LEN <= BITS) >();
+      COMPILATION_REQUIREMENT< ((START % BITS_PER_UNIT) + LEN <= BITS_PER_UNIT) >();
+      const u32 shift = BITS_PER_UNIT - (START % BITS_PER_UNIT) - LEN;
+      return (m_bits[START / BITS_PER_UNIT] >> shift) & MakeMaskClip(LEN);
+    }
+
     /**
      * Writes up to 32 bits of a specified u32 to a section of this BitVector.
      *
@@ -0,0 +1,156 @@
+/*                                              -*- mode:C++ -*-
+  BufferPoolThread.h Background thread fed from a fixed pool of buffers
+  Copyright (C) 2014 The Regents of the University of New Mexico.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file BufferPoolThread.h Background thread fed from a fixed pool of buffers
+  \lgpl
+ */
+#ifndef BUFFERPOOLTHREAD_H
+#define BUFFERPOOLTHREAD_H
+
+#include <pthread.h>
+#include "itype.h"
+#include "SPSCQueue.h"
+#include "EventCount.h"
+
+namespace MFM
+{
+  /**
+   * A background thread that processes work handed to it in BUFFERS
+   * buffers owned by someone else, who knows them only by index.  One
+   * producer thread Acquires a free buffer, fills it, and Queues it;
+   * the background thread passes each queued index, oldest first, to
+   * a Processor, which Releases it back to the pool as soon as it is
+   * done with its contents.  Acquire never waits: when every buffer
+   * is in use it fails, so the producer may drop its work rather than
+   * fall behind.
+   *
+   * BUFFERS must be a power of two.
+   */
+  template <u32 BUFFERS>
+  class BufferPoolThread
+  {
+  public:
+    /**
+     * Called on the background thread with the \c owner given to
+     * Start and the \c index of a queued buffer, which it must
+     * Release exactly once.
+     */
+    typedef void (*Processor)(void * owner, u32 index);
+
+    BufferPoolThread() ;
+
+    /**
+     * Stops, if started.
+     */
+    ~BufferPoolThread() ;
+
+    /**
+     * Makes every buffer free and starts the background thread,
+     * which will call \c processor with \c owner.  FAILs with
+     * ILLEGAL_STATE if already started.
+     *
+     * @returns false if the thread could not be created.
+     */
+    bool Start(Processor processor, void * owner) ;
+
+    bool IsStarted() const
+    {
+      return m_started;
+    }
+
+    /**
+     * Called by the producer to take a free buffer, storing its index
+     * in \c index.
+     *
+     * @returns false if every buffer is in use.
+     */
+    bool Acquire(u32 & index)
+    {
+      return m_free.Read(index);
+    }
+
+    /**
+     * Called by the producer to hand the Acquired buffer \c index to
+     * the background thread.
+     */
+    void Queue(u32 index)
+    {
+      m_queued.Write(index);
+      m_queuedSignal.Notify();
+    }
+
+    /**
+     * Called by the Processor to return buffer \c index to the pool.
+     */
+    void Release(u32 index)
+    {
+      m_free.Write(index);
+      m_releasedSignal.Notify();
+    }
+
+    /**
+     * Called by the producer to wait until every buffer has been
+     * Released.  Returns at once if not started.
+     */
+    void Flush() ;
+
+    /**
+     * Processes every queued buffer and then stops the background
+     * thread.  Does nothing unless started.
+     */
+    void Stop() ;
+
+  private:
+    /** How long the idle background thread sleeps before looking around again */
+    static const u32 IDLE_TIMEOUT_MICROS = 100000;
+
+    // Declare away copy ctor; the background thread holds our address
+    BufferPoolThread(const BufferPoolThread &) ;
+
+    bool m_started;
+    pthread_t m_thread;
+
+    Processor m_processor;
+    void * m_owner;
+
+    /** Indices of buffers ready for Acquire */
+    SPSCQueue<u32, BUFFERS> m_free;
+
+    /** Indices of buffers awaiting the Processor, oldest first */
+    SPSCQueue<u32, BUFFERS> m_queued;
+
+    /** Notified when a buffer is queued, or when stopping */
+    EventCount m_queuedSignal;
+
+    /** Notified when a buffer is released */
+    EventCount m_releasedSignal;
+
+    u32 m_stopping;
+
+    void Run() ;
+
+    static void * ThreadHelper(void * poolPtr) ;
+  };
+}
+
+#include "BufferPoolThread.tcc"
+
+#endif /* BUFFERPOOLTHREAD_H */
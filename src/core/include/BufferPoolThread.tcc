@@ -0,0 +1,115 @@
+/* -*- C++ -*- */
+#include "Fail.h"
+
+namespace MFM
+{
+  template <u32 BUFFERS>
+  BufferPoolThread<BUFFERS>::BufferPoolThread() :
+    m_started(false),
+    m_processor(0),
+    m_owner(0),
+    m_stopping(0)
+  { }
+
+  template <u32 BUFFERS>
+  BufferPoolThread<BUFFERS>::~BufferPoolThread()
+  {
+    Stop();
+  }
+
+  template <u32 BUFFERS>
+  bool BufferPoolThread<BUFFERS>::Start(Processor processor, void * owner)
+  {
+    if (m_started)
+    {
+      FAIL(ILLEGAL_STATE);
+    }
+
+    // The background thread isn't running, so we may play both ends of the queues
+    u32 index;
+    while (m_free.Read(index) || m_queued.Read(index))
+    { }
+    for (u32 i = 0; i < BUFFERS; ++i)
+    {
+      m_free.Write(i);
+    }
+
+    m_processor = processor;
+    m_owner = owner;
+    m_stopping = 0;
+
+    if (pthread_create(&m_thread, NULL, ThreadHelper, this))
+    {
+      return false;
+    }
+    m_started = true;
+    return true;
+  }
+
+  template <u32 BUFFERS>
+  void BufferPoolThread<BUFFERS>::Flush()
+  {
+    if (!m_started)
+    {
+      return;
+    }
+
+    while (true)
+    {
+      const u32 key = m_releasedSignal.PrepareWait();
+      if (m_free.ElementsAvailable() == BUFFERS)
+      {
+        break;
+      }
+      m_releasedSignal.Wait(key, IDLE_TIMEOUT_MICROS);
+    }
+  }
+
+  template <u32 BUFFERS>
+  void BufferPoolThread<BUFFERS>::Stop()
+  {
+    if (!m_started)
+    {
+      return;
+    }
+
+    __atomic_store_n(&m_stopping, 1, __ATOMIC_SEQ_CST);
+    m_queuedSignal.Notify();
+    pthread_join(m_thread, NULL);
+    m_started = false;
+  }
+
+  template <u32 BUFFERS>
+  void BufferPoolThread<BUFFERS>::Run()
+  {
+    while (true)
+    {
+      const u32 key = m_queuedSignal.PrepareWait();
+
+      u32 index;
+      if (m_queued.Read(index))
+      {
+        m_processor(m_owner, index);
+        continue;
+      }
+
+      // Only exit once everything queued before Stop is processed
+      if (__atomic_load_n(&m_stopping, __ATOMIC_SEQ_CST))
+      {
+        break;
+      }
+      m_queuedSignal.Wait(key, IDLE_TIMEOUT_MICROS);
+    }
+  }
+
+  template <u32 BUFFERS>
+  void * BufferPoolThread<BUFFERS>::ThreadHelper(void * poolPtr)
+  {
+    // FAILs outside any unwind_protect abort, as on a Tile thread
+    MFMErrorEnvironmentPointer_t errorEnvironmentStackTop = 0;
+    MFMPtrToErrEnvStackPtr = &errorEnvironmentStackTop;
+
+    ((BufferPoolThread *) poolPtr)->Run();
+    return NULL;
+  }
+}
@@ -28,32 +28,70 @@
 #define CONNECTION_H
 
 #include "ThreadQueue.h"
-#include "Mutex.h"
+#include "SPSCQueue.h"
+#include "Packet.h"
+#include "EventCount.h"
 #include "itype.h"
 #include "Logger.h"
 #include <assert.h>
 
+/**
+ * The number of bytes each direction of a Connection can hold when
+ * built with MFM_LOCKFREE_CONNECTIONS.  Must be a power of two.
+ */
+#define CONNECTION_QUEUE_BYTES 8192
+
 namespace MFM
 {
   /**
    * A construct meant to be used by two threads as a communication
-   * channel, supporting reading and writing on both ends. Only one
-   * thread is able to access the IO of this construct at a time,
-   * allowing for thread safe operation.
+   * channel, supporting reading and writing on both ends.  Each
+   * direction has a single producer, the Tile at one end, and a
+   * single consumer, the Tile at the other, which may write and read
+   * it at the same time without any further locking.  The lock
+   * (see Lock) guards the caches the Tiles share, not the IO.
+   *
+   * Each direction carries a stream of records: each a Packet,
+   * followed, for a PACKET_WRITE_BATCH, by its body of
+   * Packet::GetBatchBodyBytes bytes.  A record is always written in
+   * one queue operation, so a reader that finds a Packet available
+   * finds its whole record.  By default each direction is a
+   * mutex-guarded ThreadQueue; if MFM_LOCKFREE_CONNECTIONS is defined
+   * at compile time, each direction is instead a lock-free SPSCQueue.
    */
+  template <class T>
   class Connection
   {
   private:
 
     /**
-     * A Mutex controlling access to this Connection .
+     * The LockHolder of the end of this Connection whose Tile holds
+     * its lock, or zero if neither does.  The lock is only ever
+     * tried, never waited on, so a single word claimed by
+     * compare-and-swap does everything a Mutex did here, and naming
+     * the holder in it still lets Unlock catch the wrong end.
      */
-    Mutex m_lock;
+    u32 m_lockWord;
 
     /**
-     * The two ThreadQueue constructs used for two way IO .
+     * The value m_lockWord holds while the owning end, or else the
+     * child end, holds the lock.
      */
-    ThreadQueue m_outbuffer, m_inbuffer;
+    static u32 LockHolder(bool child)
+    {
+      return child ? 2 : 1;
+    }
+
+#ifdef MFM_LOCKFREE_CONNECTIONS
+    typedef SPSCQueue<u8, CONNECTION_QUEUE_BYTES> PacketQueue;
+#else
+    typedef ThreadQueue PacketQueue;
+#endif
+
+    /**
+     * The two queues used for two way IO .
+     */
+    PacketQueue m_outbuffer, m_inbuffer;
 
     /**
      * A flag which indicates whether or not this Connection is
@@ -61,19 +99,70 @@ namespace MFM
      */
     bool m_connected;
 
+    /**
+     * Notified whenever Packets are written for the owning end, or
+     * for the child end, to read.  May be NULL.
+     */
+    EventCount * m_ownerArrivals;
+    EventCount * m_childArrivals;
+
+#ifdef MFM_LOCKFREE_CONNECTIONS
+    static void QueueWrite(PacketQueue & queue, const u8 * bytes, u32 length)
+    {
+      queue.Write(bytes, length);
+    }
+
+    static u32 QueueRead(PacketQueue & queue, u8 * bytes, u32 length)
+    {
+      return queue.Read(bytes, length);
+    }
+
+    static void QueuePeekRead(PacketQueue & queue, u8 * bytes, u32 offset, u32 length)
+    {
+      queue.PeekRead(bytes, offset, length);
+    }
+
+    static u32 QueueByteCount(PacketQueue & queue)
+    {
+      return queue.ElementsAvailable();
+    }
+#else
+    static void QueueWrite(PacketQueue & queue, const u8 * bytes, u32 length)
+    {
+      queue.Write((u8*) bytes, length);
+    }
+
+    static u32 QueueRead(PacketQueue & queue, u8 * bytes, u32 length)
+    {
+      return queue.Read(bytes, length);
+    }
+
+    static void QueuePeekRead(PacketQueue & queue, u8 * bytes, u32 offset, u32 length)
+    {
+      queue.PeekRead(bytes, offset, length);
+    }
+
+    static u32 QueueByteCount(PacketQueue & queue)
+    {
+      return queue.BytesAvailable();
+    }
+#endif
+
   public:
 
     /**
-     * Creates a new Connection which is not connected. Also
-     * initializes the internal mutex.
+     * Creates a new Connection which is neither connected nor locked.
      */
-    Connection()
+    Connection() :
+      m_lockWord(0),
+      m_ownerArrivals(0),
+      m_childArrivals(0)
     {
       m_connected = false;
     }
 
     /**
-     * Deconstructs this Connection, freeing the internal mutex.
+     * Deconstructs this Connection.
      */
     ~Connection()
     {
@@ -92,6 +181,21 @@ namespace MFM
       m_connected = value;
     }
 
+    /**
+     * Sets the EventCounts to Notify when Packets become available
+     * to read at each end of this Connection.  Only used when built
+     * with MFM_BLOCKING_FLUSH.
+     *
+     * @param owner Notified on writes for the owning end to read.
+     *
+     * @param child Notified on writes for the child end to read.
+     */
+    void SetArrivalSignals(EventCount * owner, EventCount * child)
+    {
+      m_ownerArrivals = owner;
+      m_childArrivals = child;
+    }
+
     /**
      * Checks whether or not this Connection is able to be used as a
      * communication channel.
@@ -104,146 +208,168 @@ namespace MFM
       return m_connected;
     }
 
-    /** Test if the connection is currently locked by a thread other
-     * than the current thread.
-     *
-     * FAILs with LOCK_FAILURE if the connection is locked by the
-     * current thread.
-     *
-     * @returns true if the lock is currently held by a thread other
-     * than the current thread, and false if the lock is currently
-     * unlocked
-     *
+    /**
+     * Test if either end of this Connection currently holds its lock.
+     * This is only a snapshot; the lock may change hands at any time.
      */
-    bool IsLockedByAnother()
+    bool IsLocked() const
     {
-      return m_lock.IsLockedByAnother();
+      return __atomic_load_n(&m_lockWord, __ATOMIC_ACQUIRE) != 0;
     }
 
-    /** Locks the underlying mutex, allowing for thread-safe execution
-     * along this connection.
+    /**
+     * Tries to take the lock on this Connection, allowing for
+     * thread-safe execution along it.  Never waits; looks before
+     * claiming, so a held lock costs a read rather than a write.
+     *
+     * @param child This should be true if the calling thread is not
+     *              the owner of this Connection.
      *
      * @returns true if the lock was successfully taken, else false.
      */
-    bool Lock()
+    bool Lock(bool child)
     {
-      /*
-      if (m_lock.IHoldThisLock()) {
-        LOG.Debug("Connection %p already owns lock",(void*) this);
+      if (IsLocked())
+      {
         return false;
       }
-      */
-      return m_lock.TryLock();
+      u32 expected = 0;
+      return __atomic_compare_exchange_n(&m_lockWord, &expected, LockHolder(child), false,
+                                         __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
     }
 
     /**
-     * Unlocks the underlying mutex, allowing for another thread to lock
-     * this Connection. DO NOT call this method from a thread which does
-     * not already hold the lock!
+     * Releases the lock on this Connection, allowing the other end
+     * to take it.  FAILs with LOCK_FAILURE, leaving the lock as it
+     * was, unless the calling end holds it.
+     *
+     * @param child As for Lock.
      */
-    void Unlock()
+    void Unlock(bool child)
     {
-      m_lock.Unlock();
+      u32 expected = LockHolder(child);
+      if (!__atomic_compare_exchange_n(&m_lockWord, &expected, 0, false,
+                                       __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+      {
+        FAIL(LOCK_FAILURE);
+      }
     }
 
     /**
-     * Waits until this Connection is not busy, then reads a specified
-     * amount of bytes into a specified buffer. This method blocks the
-     * calling thread until it is able to take control of this
-     * Connection.
+     * Reads the Packet at the front of the corresponding underlying
+     * queue without blocking the calling thread.  If it is a
+     * PACKET_WRITE_BATCH, its body follows; see ReadBody.
      *
-     * @param buffer The buffer to write bytes read from this
-     *               Connection to.
+     * @param child This should be true if the calling thread is not
+     *              the owner of this Connection.
      *
-     * @param length The number of bytes which will be written to \c
-     *               buffer before this method returns.
-     */
-    void ReadBlocking(bool child, u8* buffer, u32 length)
+     * @param packet Overwritten with the Packet read, if any.
+     *
+     * @returns \c true if a Packet was read, \c false if none was
+     *          available.
+     *
+     * @sa Write
+    */
+    bool Read(bool child, Packet<T> & packet)
     {
-      ThreadQueue& queue = child ? m_outbuffer : m_inbuffer;
-
-      queue.ReadBlocking(buffer, length);
+      PacketQueue & queue = child ? m_outbuffer : m_inbuffer;
+      if (QueueByteCount(queue) < sizeof(Packet<T>))
+      {
+        return false;
+      }
+      ReadBody(child, (u8*) &packet, sizeof(Packet<T>));
+      return true;
     }
 
     /**
-     * Reads from the corresponding underlying queue without blocking
-     * the calling thread.
+     * Reads exactly \c length bytes, which must already be available,
+     * from the corresponding underlying queue.  Used to collect the
+     * body of a batch whose header has just been read, since a record
+     * is always written all at once.  FAILs with ILLEGAL_STATE if
+     * fewer than \c length bytes were available.
      *
      * @param child This should be true if the calling thread is not
      *              the owner of this Connection.
      *
-     * @param buffer The location to read bytes into.
+     * @param bytes Overwritten with the \c length bytes read.
      *
-     * @param length The number of bytes to read from the underlying buffer.
-     *               Use 0 if wanting to read as many as possible.
-     *
-     * @returns The number of bytes successfully read from this Connection.
-     *
-     * @sa Write
-    */
-    u32 Read(bool child, u8* buffer, u32 length)
+     * @param length The number of bytes to read.
+     */
+    void ReadBody(bool child, u8 * bytes, u32 length)
     {
-      ThreadQueue& queue = child ? m_outbuffer : m_inbuffer;
-
-      return queue.Read(buffer, length);
+      if (QueueRead(child ? m_outbuffer : m_inbuffer, bytes, length) != length)
+      {
+        FAIL(ILLEGAL_STATE);  /* Record arrived incomplete! */
+      }
     }
 
     /**
-     * Reads a series of bytes from an underlying queue without
-     * blocking the calling thread.  This FAILs with
-     * ARRAY_INDEX_OUT_OF_BOUNDS if reading will go over the bounds of
-     * this ThreadQueue. This does not consume any bytes from the ThreadQueue .
+     * Copies the Packet \c offset bytes from the front of an
+     * underlying queue, which must be where a record starts, without
+     * blocking the calling thread or consuming anything.  The next
+     * record starts Packet::GetRecordBytes later.  FAILs with
+     * ARRAY_INDEX_OUT_OF_BOUNDS if there is no such Packet.
      */
-    void PeekRead(bool output, u8* buffer, u32 index, u32 length)
+    void PeekRead(bool output, Packet<T> & packet, u32 offset)
     {
-      ThreadQueue& queue = output ? m_outbuffer : m_inbuffer;
-
-      queue.PeekRead(buffer, index, length);
+      QueuePeekRead(output ? m_outbuffer : m_inbuffer, (u8*) &packet, offset, sizeof(Packet<T>));
     }
 
     /**
-     * Writes a series of bytes to a specified internal buffer of this
+     * Writes a Packet to a specified internal buffer of this
      * Connection.
      *
      * @param child Selects which internal buffer to write to. If the
      *              calling object created this Connection, use \c
      *              true . If not, use \c false .
      *
-     * @param buffer The buffer containing the bytes to write to this
-     *               Connection.
+     * @param packet The Packet to write to this Connection.
+     */
+    void Write(bool child, const Packet<T> & packet)
+    {
+      Write(child, (const u8*) &packet, sizeof(Packet<T>));
+    }
+
+    /**
+     * Writes a whole record -- a Packet and any body -- to a
+     * specified internal buffer of this Connection, as a single queue
+     * operation, so the reader sees either none or all of it.
+     *
+     * @param child As for Write(bool, const Packet<T>&).
      *
-     * @param length The number of bytes which will be written to this
-     *               Connection from \c buffer before this method
-     *               returns.
+     * @param record The record, starting with its Packet.
+     *
+     * @param length Packet::GetRecordBytes of that Packet.
      */
-    void Write(bool child, u8* buffer, u32 length)
+    void Write(bool child, const u8 * record, u32 length)
     {
-      ThreadQueue& queue = !child ? m_outbuffer : m_inbuffer;
+      QueueWrite(!child ? m_outbuffer : m_inbuffer, record, length);
 
-      queue.Write(buffer, length);
+#ifdef MFM_BLOCKING_FLUSH
+      EventCount * reader = !child ? m_childArrivals : m_ownerArrivals;
+      if (reader)
+      {
+        reader->Notify();
+      }
+#endif
     }
 
     /**
-     * Number of bytes currently in the input buffer of this
-     * connection.
+     * Number of bytes of records currently in the input buffer of
+     * this connection.
      */
     u32 InputByteCount()
     {
-      return m_inbuffer.BytesAvailable();
+      return QueueByteCount(m_inbuffer);
     }
 
     /**
-     * Number of bytes currently in the output buffer of this
-     * connection.
+     * Number of bytes of records currently in the output buffer of
+     * this connection.
      */
     u32 OutputByteCount()
     {
-      return m_outbuffer.BytesAvailable();
-    }
-
-    void LogAllPackets()
-    {
-
+      return QueueByteCount(m_outbuffer);
     }
 
     void ReportConnectionStatus(Logger::Level level, bool owned) ;
@@ -251,4 +377,6 @@ namespace MFM
   };
 }
 
+#include "Connection.tcc"
+
 #endif /* CONNECTION_H */
@@ -0,0 +1,15 @@
+/* -*- C++ -*- */
+
+namespace MFM
+{
+  template <class T>
+  void Connection<T>::ReportConnectionStatus(Logger::Level level, bool owned)
+  {
+    LOG.Log(level,"   =Connection %p (%s)=", (void*) this, owned?"owned":"unowned");
+    LOG.Log(level,"    Connected: %s", m_connected?"true":"false");
+    LOG.Log(level,"    Locked: %s", IsLocked()?"true":"false");
+    LOG.Log(level,"    Input buffer count: %d bytes", InputByteCount());
+    LOG.Log(level,"    Output buffer count: %d bytes", OutputByteCount());
+  }
+
+}
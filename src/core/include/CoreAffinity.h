@@ -0,0 +1,82 @@
+/*                                              -*- mode:C++ -*-
+  CoreAffinity.h Placing threads on particular CPUs
+  Copyright (C) 2014 The Regents of the University of New Mexico.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file CoreAffinity.h Placing threads on particular CPUs
+  \author David H. Ackley.
+  \date (C) 2014 All rights reserved.
+  \lgpl
+ */
+#ifndef COREAFFINITY_H
+#define COREAFFINITY_H
+
+#include "itype.h"
+
+namespace MFM
+{
+  /**
+   * Helpers for laying threads out across the machine, so that
+   * threads working on neighboring Tiles also share a socket (and
+   * so, usually, an L3 cache and a NUMA node).  Everything here is a
+   * no-op returning failure on platforms without CPU affinity.
+   */
+  class CoreAffinity
+  {
+  public:
+    /**
+     * The most CPUs GetCPUsBySocket will report.
+     */
+    static const u32 MAX_CPUS = 256;
+
+    /**
+     * Finds the CPUs this process is allowed to run on, ordered by
+     * socket and then by CPU number, so that CPUs next to each other
+     * in the result share a socket whenever possible.
+     *
+     * @param cpus Filled with up to \c maxCpus CPU numbers.
+     *
+     * @param maxCpus The size of \c cpus.
+     *
+     * @returns The number of CPUs stored in \c cpus; 0 if they could
+     *          not be determined.
+     */
+    static u32 GetCPUsBySocket(u32 * cpus, u32 maxCpus) ;
+
+    /**
+     * Picks one of \c cpuCount CPUs, as ordered by GetCPUsBySocket,
+     * for the item at \c (x,y) of a \c width by \c height grid.  The
+     * grid is walked column by column, snaking up and down, and that
+     * walk is divided into \c cpuCount equal runs.  Neighboring items
+     * thus mostly land on the same or adjacent CPUs.
+     *
+     * @returns An index into the GetCPUsBySocket result.
+     */
+    static u32 IndexForGridLocation(u32 x, u32 y, u32 width, u32 height, u32 cpuCount) ;
+
+    /**
+     * Restricts the calling thread to run only on \c cpu.
+     *
+     * @returns \c true if successful.
+     */
+    static bool PinCurrentThread(u32 cpu) ;
+  };
+}
+
+#endif /* COREAFFINITY_H */
@@ -90,6 +90,12 @@ namespace MFM
      */
     bool m_renderLowlight;
 
+    /**
+     * Whether this Element's behavior runs with its EventWindow
+     * gathered; see SetGathersWindow.
+     */
+    bool m_gathersWindow;
+
     /**
      * The basic, most generic Atom of this Element to be used when
      * placing a new Atom.
@@ -211,6 +217,19 @@ namespace MFM
       m_name = name;
     }
 
+    /**
+     * Sets whether ElementTable::Execute gathers the EventWindow (see
+     * EventWindow::Gather) before this Element's behavior, and
+     * scatters it after.  Gathering copies every site of the window,
+     * so it pays only for behaviors that read most of the window;
+     * otherwise the behavior reads and writes the Tile directly.
+     * Off by default.  Must be set before the Element is Needed.
+     */
+    void SetGathersWindow(bool value)
+    {
+      m_gathersWindow = value;
+    }
+
     /**
      * Diffuses the central Atom of a given EventWindow based on the
      * empty places around the Atom and the odds that the central Atom
@@ -246,6 +265,7 @@ namespace MFM
     Element(const UUID & uuid) : m_UUID(uuid), m_type(0),
                                  m_hasType(false),
                                  m_renderLowlight(false),
+                                 m_gathersWindow(false),
                                  m_atomicSymbol("!!"),
                                  m_name("UNNAMED")
     {
@@ -261,6 +281,18 @@ namespace MFM
     { }
     */
 
+    /**
+     * Gets how many u64's of element-specific data (see ElementTable)
+     * this Element keeps in each Tile.  Grid::Needed allocates that
+     * many in every Tile up front, so the slots sit at the same place
+     * in each one and may be summed across the Grid by offset; see
+     * Grid::SumElementData.  By default, none.
+     */
+    virtual u32 GetElementDataSlotCount() const
+    {
+      return 0;
+    }
+
     /**
      * Assigns the type of this Element using the U16StaticLoader
      * . This type is only assigned if it has not been assigned
@@ -333,6 +365,17 @@ namespace MFM
       /* Default to no description */
     }
 
+    /**
+     * Returns true if this Element's behavior runs with its
+     * EventWindow gathered.
+     *
+     * @sa SetGathersWindow
+     */
+    bool GathersWindow() const
+    {
+      return m_gathersWindow;
+    }
+
     /**
      * Checks to see if this Element is of a specified type.
      *
@@ -87,10 +87,10 @@ namespace MFM
         return;
     }
 
-    T other = window.GetRelativeAtom(sp);
-    const Element * elt = tile.GetElement(other.GetType());
+    const u32 otherType = window.GetRelativeAtom(sp).GetTypeIfSane();
+    const Element * elt;
 
-    if (!other.IsSane() || !(elt = tile.GetElement(other.GetType())))
+    if (otherType == T::INSANE_TYPE || !(elt = tile.GetElement(otherType)))
       return;       // Any confusion, let the engine sort it out first
 
     u32 thisWeight = elt->Diffusability(window, sp, SPoint(0,0));
@@ -0,0 +1,138 @@
+/*                                              -*- mode:C++ -*-
+  ElementDispatch.h Flat type-to-Element table for event dispatch
+  Copyright (C) 2014 The Regents of the University of New Mexico.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file ElementDispatch.h Flat type-to-Element table for event dispatch
+  \author David H. Ackley.
+  \date (C) 2014 All rights reserved.
+  \lgpl
+ */
+#ifndef ELEMENTDISPATCH_H
+#define ELEMENTDISPATCH_H
+
+#include "itype.h"
+#include "Fail.h"
+#include "Util.h"   /* For CACHE_LINE_BYTES */
+
+namespace MFM
+{
+  template <class CC> class Element; // FORWARD
+
+  /**
+   * Maps Atom types straight to their Elements, for ElementTable::
+   * Execute, with no hashing or probing.  Element types are assigned
+   * across the whole 16-bit type space (see StaticLoader), so a
+   * one-byte index per possible type selects a small, dense array of
+   * Entry's; an event reads one byte of the index and one Entry.
+   *
+   * A Grid builds one ElementDispatch as Elements are Needed, and
+   * all of its Tiles read it.  It must be changed only while the Grid
+   * is paused.
+   */
+  template <class CC>
+  class ElementDispatch
+  {
+  public:
+    /**
+     * The number of distinct types an ElementDispatch can map.
+     */
+    static const u32 TYPE_COUNT = 1u << 16;
+
+    /**
+     * The most Elements an ElementDispatch can hold.
+     */
+    static const u32 MAX_ENTRIES = 255;
+
+    /**
+     * Entry flag: Atoms of this type have no behavior to run.
+     */
+    static const u32 FLAG_SKIP = 1u << 0;
+
+    /**
+     * Entry flag: gather the EventWindow for this Element's behavior.
+     *
+     * @sa Element::SetGathersWindow
+     */
+    static const u32 FLAG_GATHER = 1u << 1;
+
+    struct Entry
+    {
+      const Element<CC> * m_element;
+      u32 m_flags;
+    };
+
+    ElementDispatch()
+    {
+      Clear();
+    }
+
+    /**
+     * Forgets all Elements.
+     */
+    void Clear() ;
+
+    /**
+     * Maps the type of \c theElement to it.  Inserting an Element
+     * again is harmless.  FAILs with DUPLICATE_ENTRY if another
+     * Element has the same type, and with OUT_OF_ROOM if MAX_ENTRIES
+     * Elements are already held.
+     */
+    void Insert(const Element<CC> & theElement) ;
+
+    /**
+     * Gets the Entry for \c type.  The Entry for an unknown type has
+     * a null m_element and no flags.
+     */
+    const Entry & GetEntry(u32 type) const
+    {
+      return m_entries[type < TYPE_COUNT ? m_index[type] : 0];
+    }
+
+    /**
+     * Gets the Element of type \c type, or NULL if there is none.
+     */
+    const Element<CC> * Lookup(u32 type) const
+    {
+      return GetEntry(type).m_element;
+    }
+
+    /**
+     * Gets the number of Elements held.
+     */
+    u32 GetEntryCount() const
+    {
+      return m_entryCount;
+    }
+
+  private:
+    /** Entry 0 is for all unknown types */
+    Entry m_entries[MAX_ENTRIES + 1] __attribute__ ((aligned (CACHE_LINE_BYTES)));
+
+    /** The index in m_entries of each type's Entry */
+    u8 m_index[TYPE_COUNT] __attribute__ ((aligned (CACHE_LINE_BYTES)));
+
+    u32 m_entryCount;
+  };
+
+} /* namespace MFM */
+
+#include "ElementDispatch.tcc"
+
+#endif /*ELEMENTDISPATCH_H*/
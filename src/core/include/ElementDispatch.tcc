@@ -0,0 +1,55 @@
+/* -*- C++ -*- */
+#include <string.h>   /* For memset */
+#include "Element.h"
+#include "Element_Empty.h"
+
+namespace MFM {
+
+  template <class CC>
+  void ElementDispatch<CC>::Clear()
+  {
+    memset(m_index, 0, sizeof(m_index));
+    m_entries[0].m_element = 0;
+    m_entries[0].m_flags = 0;
+    m_entryCount = 0;
+  }
+
+  template <class CC>
+  void ElementDispatch<CC>::Insert(const Element<CC> & theElement)
+  {
+    const u32 type = theElement.GetType();
+    if (type >= TYPE_COUNT)
+    {
+      FAIL(ILLEGAL_ARGUMENT);
+    }
+
+    const u32 index = m_index[type];
+    if (index != 0)
+    {
+      if (m_entries[index].m_element != &theElement)
+      {
+        FAIL(DUPLICATE_ENTRY);
+      }
+      return;
+    }
+
+    if (m_entryCount >= MAX_ENTRIES)
+    {
+      FAIL(OUT_OF_ROOM);
+    }
+
+    Entry & entry = m_entries[++m_entryCount];
+    entry.m_element = &theElement;
+    entry.m_flags = 0;
+    if (&theElement == &Element_Empty<CC>::THE_INSTANCE)
+    {
+      entry.m_flags |= FLAG_SKIP;
+    }
+    if (theElement.GathersWindow())
+    {
+      entry.m_flags |= FLAG_GATHER;
+    }
+    m_index[type] = (u8) m_entryCount;
+  }
+
+} /* namespace MFM */
@@ -34,7 +34,9 @@
 #include "itype.h"
 #include "Element.h"
 #include "Element_Empty.h"
+#include "ElementDispatch.h"
 #include "UsageTimer.h"
+#include "Util.h"       /* For CACHE_LINE_BYTES */
 
 namespace MFM
 {
@@ -52,6 +54,12 @@ namespace MFM
     enum { R = P::EVENT_WINDOW_RADIUS};
     enum { ELEMENT_DATA_SLOTS = P::ELEMENT_DATA_SLOTS};
 
+    // m_elementData fills whole cache lines, so nothing else shares them
+    enum { SLOTS_PER_CACHE_LINE = CACHE_LINE_BYTES / sizeof(u64) };
+    enum { ELEMENT_DATA_ARRAY_SLOTS =
+           (ELEMENT_DATA_SLOTS + SLOTS_PER_CACHE_LINE - 1) / SLOTS_PER_CACHE_LINE
+           * SLOTS_PER_CACHE_LINE };
+
   public:
     // -3 to avoid 2**k and 2**k-1 sizes; they seem to beat against type assignments
     static const u32 SIZE = (1u<<B) - 3;
@@ -124,11 +132,26 @@ namespace MFM
      * Executes the behavior method of the Element in the center of a
      * specified EventWindow. This method finds the central Element by
      * the type of the Atom located there, then executes its behavior.
+     * If the Element GathersWindow, the behavior runs with \c window
+     * gathered (see EventWindow::Gather), and if it FAILs, the caller
+     * must EventWindow::Scatter whatever it wrote.
      *
      * @param window The EventWindow to execute an event upon.
      */
     void Execute(EventWindow<CC>& window) ;
 
+    /**
+     * Has Execute find Elements through \c dispatch, which must stay
+     * valid while this ElementTable is in use, rather than through
+     * this ElementTable's own hash table.  Types \c dispatch does not
+     * know are still looked up here.  A NULL \c dispatch reverts to
+     * using only this ElementTable.  Reinit does not change this.
+     */
+    void SetDispatch(const ElementDispatch<CC> * dispatch)
+    {
+      m_dispatch = dispatch;
+    }
+
     /**
      * Inserts an Element into this ElementTable.
      *
@@ -162,8 +185,7 @@ namespace MFM
      *   element-specific data but now has SLOTS of element-specific
      *   data allocated for it, as a result of this call.
      *
-     * In the case of a true return, note that the resulting slots
-     * have no particular values.
+     * Newly allocated slots start at 0.
      */
     bool AllocateElementDataSlots(const Element<CC>& e, u32 slots) ;
 
@@ -190,8 +212,63 @@ namespace MFM
 
     u64 * GetDataAndRegister(const u32 elementType, u32 slots) ;
 
+    /**
+     * Gets the number of element-specific data slots currently
+     * allocated for the element of type \c elementType, or 0 if it is
+     * unregistered or has no data slots.
+     */
+    u32 GetElementDataSlotCount(const u32 elementType) const ;
+
     u64 * GetDataIfRegistered(const u32 elementType, u32 slots) ;
 
+    /**
+     * Gets where slot \c slot of the \c slots element-specific data
+     * slots of the element of type \c elementType lives, for
+     * ReadElementData and TakeElementData, or -1 if it has no such
+     * slot.  Allocated data never moves until Reinit, so the offset
+     * may be kept instead of looking the element up again.
+     */
+    s32 GetElementDataOffset(const u32 elementType, const u32 slots, const u32 slot) const ;
+
+    /**
+     * Reads the element-specific data slot at \c offset, as given by
+     * GetElementDataOffset, while the owning Tile may be updating it
+     * with AddElementData.
+     */
+    u64 ReadElementData(const u32 offset) const
+    {
+      if (offset >= ELEMENT_DATA_SLOTS)
+      {
+        FAIL(ARRAY_INDEX_OUT_OF_BOUNDS);
+      }
+      return __atomic_load_n(&m_elementData[offset], __ATOMIC_RELAXED);
+    }
+
+    /**
+     * Reads and zeroes the element-specific data slot at \c offset,
+     * as one step, so no concurrent AddElementData is lost.
+     */
+    u64 TakeElementData(const u32 offset)
+    {
+      if (offset >= ELEMENT_DATA_SLOTS)
+      {
+        FAIL(ARRAY_INDEX_OUT_OF_BOUNDS);
+      }
+      return __atomic_exchange_n(&m_elementData[offset], 0, __ATOMIC_RELAXED);
+    }
+
+    /**
+     * Adds \c delta to \c datum, one of the slots returned by
+     * GetDataAndRegister and friends.  Elements count with this rather
+     * than ++, so that other threads using ReadElementData or
+     * TakeElementData see neither torn nor lost updates.  It orders
+     * nothing else, so on x86 it costs one locked add.
+     */
+    static void AddElementData(u64 & datum, const u64 delta)
+    {
+      __atomic_fetch_add(&datum, delta, __ATOMIC_RELAXED);
+    }
+
   private:
 
     /**
@@ -218,9 +295,17 @@ namespace MFM
     } m_hash[SIZE];
     u32 m_hashSlotsInUse;
 
-    u64 m_elementData[ELEMENT_DATA_SLOTS];
     u32 m_nextFreeElementDataIndex;
 
+    const ElementDispatch<CC> * m_dispatch;
+
+    /**
+     * Element-specific data, on cache lines of its own: other threads
+     * read it while our Tile's events update it, and that traffic
+     * should not touch the hash table beside it.
+     */
+    u64 m_elementData[ELEMENT_DATA_ARRAY_SLOTS] __attribute__ ((aligned (CACHE_LINE_BYTES)));
+
   };
 
 } /* namespace MFM */
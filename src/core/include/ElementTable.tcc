@@ -54,15 +54,24 @@ namespace MFM {
   template <class CC>
   const Element<CC> * ElementTable<CC>::Lookup(u32 elementType) const
   {
+    if (m_dispatch)
+    {
+      const Element<CC> * elt = m_dispatch->Lookup(elementType);
+      if (elt)
+      {
+        return elt;
+      }
+    }
     return m_hash[SlotFor(elementType)].m_element;
   }
 
   template <class CC>
   void ElementTable<CC>::Execute(EventWindow<CC>& window)
   {
-    T atom = window.GetCenterAtom();
-    if (!atom.IsSane())
+    u32 type = window.GetCenterAtom().GetTypeIfSane();
+    if (type == T::INSANE_TYPE)
     {
+      T atom = window.GetCenterAtom();
       if (atom.HasBeenRepaired())
       {
         window.SetCenterAtom(atom);
@@ -71,13 +80,42 @@ namespace MFM {
       {
         FAIL(INCONSISTENT_ATOM);
       }
+      type = atom.GetType();
+    }
+    if (m_dispatch)
+    {
+      const typename ElementDispatch<CC>::Entry & entry = m_dispatch->GetEntry(type);
+      if (entry.m_flags & ElementDispatch<CC>::FLAG_SKIP)
+      {
+        return;
+      }
+      if (entry.m_flags & ElementDispatch<CC>::FLAG_GATHER)
+      {
+        window.Gather();
+        entry.m_element->Behavior(window);
+        window.Scatter();
+        return;
+      }
+      if (entry.m_element)
+      {
+        entry.m_element->Behavior(window);
+        return;
+      }
     }
-    u32 type = atom.GetType();
     if(type != Element_Empty<CC>::THE_INSTANCE.GetType())
     {
       const Element<CC> * elt = Lookup(type);
       if (elt == 0) FAIL(UNKNOWN_ELEMENT);
-      elt->Behavior(window);
+      if (elt->GathersWindow())
+      {
+        window.Gather();
+        elt->Behavior(window);
+        window.Scatter();
+      }
+      else
+      {
+        elt->Behavior(window);
+      }
     }
   }
 
@@ -89,7 +127,7 @@ namespace MFM {
   }
 
   template <class CC>
-  ElementTable<CC>::ElementTable()
+  ElementTable<CC>::ElementTable() : m_dispatch(0)
   {
     Reinit();
   }
@@ -116,6 +154,8 @@ namespace MFM {
 
       m_hash[index].m_elementDataLength = slots;
       m_hash[index].m_elementDataStart = m_nextFreeElementDataIndex;
+      for (u32 i = 0; i < slots; ++i)
+        m_elementData[m_nextFreeElementDataIndex + i] = 0;
       m_nextFreeElementDataIndex += slots;
     }
 
@@ -140,6 +180,15 @@ namespace MFM {
     return & m_elementData[m_hash[index].m_elementDataStart];
   }
 
+  template <class CC>
+  u32 ElementTable<CC>::GetElementDataSlotCount(const u32 elementType) const
+  {
+    s32 index = GetIndex(elementType);
+    if (index < 0) return 0;
+
+    return m_hash[index].m_elementDataLength;
+  }
+
   template <class CC>
   u64 * ElementTable<CC>::GetDataAndRegister(const u32 elementType, u32 slots)
   {
@@ -160,14 +209,22 @@ namespace MFM {
       datap = GetElementDataSlotsFromType(elementType, slots);
       if (!datap)
         FAIL(ILLEGAL_STATE);
-
-      // Init newly registered slots
-      for (u32 i = 0; i < slots; ++i)
-        datap[i] = 0;
     }
     return datap;
   }
 
+  template <class CC>
+  s32 ElementTable<CC>::GetElementDataOffset(const u32 elementType, const u32 slots,
+                                             const u32 slot) const
+  {
+    s32 index = GetIndex(elementType);
+    if (index < 0) return -1;
+
+    if (slot >= slots) return -1;
+    if (m_hash[index].m_elementDataLength != slots) return -1;
+    return m_hash[index].m_elementDataStart + slot;
+  }
+
   template <class CC>
   u64 * ElementTable<CC>::GetDataIfRegistered(const u32 elementType, u32 slots)
   {
@@ -0,0 +1,92 @@
+/*                                              -*- mode:C++ -*-
+  EventCount.h Lightweight wait-for-something-to-happen signal
+  Copyright (C) 2014 The Regents of the University of New Mexico.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file EventCount.h Lightweight wait-for-something-to-happen signal
+  \author David H. Ackley.
+  \date (C) 2014 All rights reserved.
+  \lgpl
+ */
+#ifndef EVENTCOUNT_H
+#define EVENTCOUNT_H
+
+#include "itype.h"
+
+namespace MFM
+{
+  /**
+   * An eventcount: a counter that producers bump whenever 'something
+   * happened', and that a consumer can sleep on until it moves.  The
+   * consumer takes a key with PrepareWait, then checks whatever
+   * condition it cares about, then -- only if still unsatisfied --
+   * calls Wait with that key.  Any Notify after PrepareWait makes
+   * that Wait return at once, so no wakeup can be lost between the
+   * check and the sleep.
+   *
+   * On Linux, waiting blocks on a futex, and Notify makes no system
+   * call at all unless someone is actually waiting.  Elsewhere, Wait
+   * merely sleeps for its timeout.
+   */
+  class EventCount
+  {
+  private:
+    /**
+     * Incremented by every Notify.  Doubles as the futex word.
+     */
+    u32 m_sequence;
+
+    /**
+     * The number of threads currently inside Wait.
+     */
+    u32 m_waiters;
+
+    // Declare away copy ctor; waiters may hold our address
+    EventCount(const EventCount &) ;
+
+  public:
+
+    EventCount() : m_sequence(0), m_waiters(0)
+    { }
+
+    /**
+     * Gets the key to pass to a subsequent Wait.  Call this before
+     * checking the awaited condition.
+     */
+    u32 PrepareWait() const
+    {
+      return __atomic_load_n(&m_sequence, __ATOMIC_ACQUIRE);
+    }
+
+    /**
+     * Blocks the calling thread until a Notify has happened since the
+     * PrepareWait that returned \c key, or until \c timeoutMicros
+     * have elapsed, whichever comes first.  May also return early
+     * spuriously, so callers must recheck their condition.
+     */
+    void Wait(u32 key, u32 timeoutMicros) ;
+
+    /**
+     * Records that something happened, waking all threads in Wait.
+     */
+    void Notify() ;
+  };
+}
+
+#endif /* EVENTCOUNT_H */
@@ -32,6 +32,8 @@
 #include "itype.h"
 #include "MDist.h"  /* for EVENT_WINDOW_SITES */
 #include "PSym.h"   /* For PointSymmetry, Map */
+#include "BitVector.h"
+#include "Util.h"   /* For COMPILATION_REQUIREMENT */
 
 namespace MFM
 {
@@ -56,12 +58,77 @@ namespace MFM
     enum { W = P::TILE_WIDTH };
     enum { B = P::ELEMENT_TABLE_BITS };
 
+    enum { SITES = EVENT_WINDOW_SITES(R) };
+
     Tile<CC> & m_tile;
 
     SPoint m_center;
 
     PointSymmetry m_sym;
 
+    /**
+     * The MDist indices of the sites of this EventWindow as seen
+     * through m_sym; see MDist::GetSymmetricIndices.
+     */
+    const u8 * m_symIndices;
+
+    /**
+     * The inverse of m_symIndices; see
+     * MDist::GetInverseSymmetricIndices.
+     */
+    const u8 * m_inverseSymIndices;
+
+    /**
+     * True between Gather and Scatter, while the Atoms of this
+     * EventWindow are read and written in m_atoms rather than in
+     * m_tile.
+     */
+    bool m_gathered;
+
+    /**
+     * While gathered, copies of the Atoms of this EventWindow,
+     * indexed by MDist index in untransformed Tile orientation.
+     */
+    T m_atoms[SITES];
+
+    /**
+     * While gathered, one bit per site of m_atoms, set for each site
+     * that Tile::IsLiveSite.
+     */
+    BitVector<SITES> m_liveSites;
+
+    /**
+     * While gathered, one bit per site of m_atoms, set for each site
+     * that has been written, to be placed back in m_tile by Scatter.
+     */
+    BitVector<SITES> m_writtenSites;
+
+    /**
+     * While gathered, the types of the Atoms of this EventWindow,
+     * indexed by MDist index as seen through m_sym, packed for
+     * GetTypeSiteMask to compare all at once.
+     */
+    u16 m_types[SITES];
+
+    /**
+     * While gathered, one bit per live site of this EventWindow, bit
+     * \c i for MDist index \c i as seen through m_sym.
+     */
+    u64 m_liveMask;
+
+    /**
+     * Rebuilds m_types and m_liveMask from m_atoms and m_liveSites,
+     * as seen through m_sym.
+     */
+    void ResolveSiteTypes() ;
+
+    /**
+     * One bit per site of this EventWindow, indexed by MDist index in
+     * untransformed Tile orientation, set for each site whose Atom
+     * has actually changed since the last ClearDirtySites.
+     */
+    BitVector<SITES> m_dirtySites;
+
     /**
      * Low-level, private because this does not guarantee loc is in
      * the window!
@@ -71,6 +138,59 @@ namespace MFM
       return Map(loc,m_sym,loc)+m_center;
     }
 
+    /**
+     * Gets the untransformed MDist index of the site at \c offset as
+     * seen through m_sym, or -1 if \c offset is not in this
+     * EventWindow.
+     */
+    s32 MapToIndex(const SPoint & offset) const
+    {
+      s32 idx = MDist<R>::get().FromPoint(offset, R);
+      return idx < 0 ? idx : m_symIndices[idx];
+    }
+
+    /**
+     * FAIL(ILLEGAL_ARGUMENT) if offset is not in the event window
+     */
+    u32 MapToIndexValid(const SPoint & offset) const
+    {
+      s32 idx = MapToIndex(offset);
+      if (idx < 0) FAIL(ILLEGAL_ARGUMENT);
+      return (u32) idx;
+    }
+
+    /**
+     * FAIL(ILLEGAL_ARGUMENT) if siteIndex is not in the event window
+     */
+    u32 MapSiteIndexValid(u32 siteIndex) const
+    {
+      if (siteIndex >= SITES) FAIL(ILLEGAL_ARGUMENT);
+      return m_symIndices[siteIndex];
+    }
+
+    SPoint IndexToTile(u32 idx) const
+    {
+      return MDist<R>::get().GetPoint(idx) + m_center;
+    }
+
+    const T & ReadAtom(u32 idx) const
+    {
+      return m_gathered ? m_atoms[idx] : *m_tile.GetAtom(IndexToTile(idx));
+    }
+
+    bool IsLiveIndex(u32 idx) const
+    {
+      return m_gathered ? m_liveSites.ReadBit(idx) : m_tile.IsLiveSite(IndexToTile(idx));
+    }
+
+    /**
+     * Writes \c atom at untransformed MDist index \c idx, unless that
+     * site is not live.
+     *
+     * @returns \c true if \c atom was written.
+     */
+    bool WriteAtom(u32 idx, const T & atom) ;
+
   public:
 
     /**
@@ -109,7 +229,13 @@ namespace MFM
      */
     void SetSymmetry(const PointSymmetry psym)
     {
+      m_symIndices = MDist<R>::get().GetSymmetricIndices(psym);
+      m_inverseSymIndices = MDist<R>::get().GetInverseSymmetricIndices(psym);
       m_sym = psym;
+      if (m_gathered)
+      {
+        ResolveSiteTypes();
+      }
     }
 
     /**
@@ -147,16 +273,62 @@ namespace MFM
      */
     bool IsLiveSite(const SPoint & location) const
     {
-      return m_tile.IsLiveSite(MapToTile(location));
+      s32 idx = MapToIndex(location);
+      if (idx < 0)
+      {
+        return m_tile.IsLiveSite(MapToTile(location));
+      }
+      return IsLiveIndex((u32) idx);
     }
 
+    /**
+     * Checks to see if the site with a particular MDist index, as
+     * seen through the current PointSymmetry, may be used during
+     * event execution.  Like IsLiveSite(MDist<R>::get().GetPoint(siteIndex)),
+     * but cheaper.
+     *
+     * @param siteIndex The MDist index of the site to check.  If this
+     *                  is not less than GetAtomCount(), will FAIL with
+     *                  ILLEGAL_ARGUMENT .
+     *
+     * @returns \c true if this site may be reached during event
+     *          execution, else \c false .
+     */
+    bool IsLiveSiteIndex(u32 siteIndex) const
+    {
+      return IsLiveIndex(MapSiteIndexValid(siteIndex));
+    }
+
+    /**
+     * Gets the live sites of this EventWindow as a bit mask, with bit
+     * \c i set if the site with MDist index \c i, as seen through the
+     * current PointSymmetry, IsLiveSiteIndex.
+     */
+    u64 GetLiveSiteMask() const ;
+
+    /**
+     * Gets the live sites of this EventWindow that hold Atoms of a
+     * given type, as a bit mask like GetLiveSiteMask.  While gathered
+     * this compares a packed array of types rather than reading each
+     * Atom, so whole-window searches (see WindowScanner) reduce to
+     * masking and counting bits.
+     *
+     * @param type The type of Atom to look for.
+     */
+    u64 GetTypeSiteMask(u32 type) const ;
+
     /**
      * Constructs a new EventWindow which takes place on a specified
      * Tile with the default PointSymmetry of PSYM_NORMAL .
      *
      * @param tile The Tile which this EventWindow will take place in.
      */
-    EventWindow(Tile<CC> & tile) : m_tile(tile), m_sym(PSYM_NORMAL)
+    EventWindow(Tile<CC> & tile) :
+      m_tile(tile),
+      m_sym(PSYM_NORMAL),
+      m_symIndices(MDist<R>::get().GetSymmetricIndices(PSYM_NORMAL)),
+      m_inverseSymIndices(MDist<R>::get().GetInverseSymmetricIndices(PSYM_NORMAL)),
+      m_gathered(false)
     { }
 
     /**
@@ -182,6 +354,71 @@ namespace MFM
       return m_center;
     }
 
+    /**
+     * Copies the Atoms of this EventWindow, and which of its sites
+     * are live, out of GetTile, so that until Scatter, reading and
+     * writing Atoms through this EventWindow is just indexing an
+     * array.  The PointSymmetry is resolved through a table rather
+     * than by mapping each offset.  Writes do not reach GetTile
+     * until Scatter.
+     */
+    void Gather() ;
+
+    /**
+     * Places every Atom written since Gather back into GetTile, via
+     * Tile::PlaceAtom, which marks the sites that actually changed
+     * dirty.  Afterwards Atoms are again read and written directly
+     * in GetTile.  Does nothing unless gathered.
+     */
+    void Scatter() ;
+
+    /**
+     * Returns true between Gather and Scatter.
+     */
+    bool IsGathered() const
+    {
+      return m_gathered;
+    }
+
+    /**
+     * Forgets all record of changed sites, in preparation for a new
+     * event.
+     */
+    void ClearDirtySites()
+    {
+      m_dirtySites.Clear();
+    }
+
+    /**
+     * Records that the Atom at a Tile location has changed.  Locations
+     * outside this EventWindow are ignored.
+     *
+     * @param tileLoc The changed location, in untransformed Tile
+     *                coordinates.
+     */
+    void MarkSiteDirty(const SPoint& tileLoc)
+    {
+      s32 idx = MDist<R>::get().FromPoint(tileLoc - m_center, R);
+      if (idx >= 0)
+      {
+        m_dirtySites.SetBit((u32) idx);
+      }
+    }
+
+    /**
+     * Checks whether a site of this EventWindow has changed since the
+     * last ClearDirtySites.
+     *
+     * @param siteIndex The MDist index of the site, in untransformed
+     *                  Tile orientation.
+     *
+     * @returns \c true if the Atom at \c siteIndex has changed.
+     */
+    bool IsSiteDirty(u32 siteIndex) const
+    {
+      return m_dirtySites.ReadBit(siteIndex);
+    }
+
     /**
      * Deconstructs this EventWindow.
      */
@@ -208,7 +445,7 @@ namespace MFM
      */
     const T& GetCenterAtom() const
     {
-      return *m_tile.GetAtom(m_center);
+      return ReadAtom(0);
     }
 
     /**
@@ -219,7 +456,7 @@ namespace MFM
      */
     void SetCenterAtom(const T& atom)
     {
-      return m_tile.PlaceAtom(atom, m_center);
+      WriteAtom(0, atom);
     }
 
     /**
@@ -247,6 +484,23 @@ namespace MFM
      */
     const T& GetRelativeAtom(const Dir mooreOffset) const;
 
+    /**
+     * Gets the Atom at the site with a particular MDist index, as
+     * seen through the current PointSymmetry.  Like
+     * GetRelativeAtom(MDist<R>::get().GetPoint(siteIndex)), but
+     * cheaper, for Elements that walk the whole window.
+     *
+     * @param siteIndex The MDist index of the Atom to be retrieved.
+     *                  If this is not less than GetAtomCount(), will
+     *                  FAIL with ILLEGAL_ARGUMENT .
+     *
+     * @returns The Atom at \c siteIndex .
+     */
+    const T& GetSiteAtom(u32 siteIndex) const
+    {
+      return ReadAtom(MapSiteIndexValid(siteIndex));
+    }
+
     /**
      * Sets an Atom residing at a specified location in this
      * EventWindow to a specified Atom .
@@ -262,6 +516,23 @@ namespace MFM
      */
     bool SetRelativeAtom(const SPoint& offset, const T & atom);
 
+    /**
+     * Sets the Atom at the site with a particular MDist index, as
+     * seen through the current PointSymmetry, if that site is live.
+     *
+     * @param siteIndex The MDist index of the Atom to be set.  If this
+     *                  is not less than GetAtomCount(), will FAIL with
+     *                  ILLEGAL_ARGUMENT .
+     *
+     * @param atom The Atom to place in this EventWindow .
+     *
+     * @returns \c true if the site was live and so was set.
+     */
+    bool SetSiteAtom(u32 siteIndex, const T & atom)
+    {
+      return WriteAtom(MapSiteIndexValid(siteIndex), atom);
+    }
+
     /**
      * Takes the Atom in a specified location and swaps it with an
      * Atom in another location.
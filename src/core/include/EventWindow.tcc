@@ -11,21 +11,158 @@ namespace MFM
     return MapToTile(offset);
   }
 
+  template <class CC>
+  bool EventWindow<CC>::WriteAtom(u32 idx, const T & atom)
+  {
+    if (!IsLiveIndex(idx))
+    {
+      return false;
+    }
+
+    if (m_gathered)
+    {
+      m_atoms[idx] = atom;
+      m_types[m_inverseSymIndices[idx]] = (u16) atom.GetType();
+      m_writtenSites.SetBit(idx);
+    }
+    else
+    {
+      m_tile.PlaceAtom(atom, IndexToTile(idx));
+    }
+    return true;
+  }
+
+  template <class CC>
+  void EventWindow<CC>::Gather()
+  {
+    const MDist<R> & md = MDist<R>::get();
+
+    // No site is in the cache, so all are live, unless the window
+    // reaches within R of the Tile edge
+    const u32 x = (u32) m_center.GetX();
+    const u32 y = (u32) m_center.GetY();
+    const bool allLive = x >= 2 * R && x < W - 2 * R && y >= 2 * R && y < W - 2 * R;
+
+    m_liveSites.Clear();
+    m_writtenSites.Clear();
+    for (u32 i = 0; i < SITES; ++i)
+    {
+      const SPoint loc = md.GetPoint(i) + m_center;
+      m_atoms[i] = *m_tile.GetAtom(loc);
+      if (allLive || m_tile.IsLiveSite(loc))
+      {
+        m_liveSites.SetBit(i);
+      }
+    }
+    ResolveSiteTypes();
+    m_gathered = true;
+  }
+
+  template <class CC>
+  void EventWindow<CC>::ResolveSiteTypes()
+  {
+    COMPILATION_REQUIREMENT<SITES <= 64>();
+
+    m_liveMask = 0;
+    for (u32 i = 0; i < SITES; ++i)
+    {
+      const u32 idx = m_symIndices[i];
+      m_types[i] = (u16) m_atoms[idx].GetType();
+      if (m_liveSites.ReadBit(idx))
+      {
+        m_liveMask |= ((u64) 1) << i;
+      }
+    }
+  }
+
+  template <class CC>
+  u64 EventWindow<CC>::GetLiveSiteMask() const
+  {
+    COMPILATION_REQUIREMENT<SITES <= 64>();
+
+    if (m_gathered)
+    {
+      return m_liveMask;
+    }
+
+    u64 mask = 0;
+    for (u32 i = 0; i < SITES; ++i)
+    {
+      if (IsLiveIndex(m_symIndices[i]))
+      {
+        mask |= ((u64) 1) << i;
+      }
+    }
+    return mask;
+  }
+
+  template <class CC>
+  u64 EventWindow<CC>::GetTypeSiteMask(u32 type) const
+  {
+    COMPILATION_REQUIREMENT<SITES <= 64>();
+
+    u64 mask = 0;
+    if (m_gathered)
+    {
+      if (type > 0xffff)
+      {
+        return 0;  // No Atom type is that wide
+      }
+
+      // Branch-free, so the compiler may compare several at once
+      const u16 want = (u16) type;
+      for (u32 i = 0; i < SITES; ++i)
+      {
+        mask |= ((u64) (m_types[i] == want)) << i;
+      }
+      return mask & m_liveMask;
+    }
+
+    for (u32 i = 0; i < SITES; ++i)
+    {
+      const u32 idx = m_symIndices[i];
+      if (IsLiveIndex(idx) && m_tile.GetAtomType(IndexToTile(idx)) == type)
+      {
+        mask |= ((u64) 1) << i;
+      }
+    }
+    return mask;
+  }
+
+  template <class CC>
+  void EventWindow<CC>::Scatter()
+  {
+    if (!m_gathered)
+    {
+      return;
+    }
+
+    m_gathered = false;
+    for (u32 i = 0; i < SITES; ++i)
+    {
+      if (m_writtenSites.ReadBit(i))
+      {
+        m_tile.PlaceAtom(m_atoms[i], IndexToTile(i));
+      }
+    }
+  }
+
   template <class CC>
   bool EventWindow<CC>::SetRelativeAtom(const SPoint& offset, const T & atom)
   {
-    if (IsLiveSite(offset))
+    s32 idx = MapToIndex(offset);
+    if (idx < 0)
     {
-      m_tile.PlaceAtom(atom, MapToTileValid(offset));
-      return true;
+      if (IsLiveSite(offset)) FAIL(ILLEGAL_ARGUMENT);
+      return false;
     }
-    return false;
+    return WriteAtom((u32) idx, atom);
   }
 
   template <class CC>
   const typename CC::ATOM_TYPE& EventWindow<CC>::GetRelativeAtom(const SPoint& offset) const
   {
-    return *m_tile.GetAtom(MapToTileValid(offset));
+    return ReadAtom(MapToIndexValid(offset));
   }
 
   template <class CC>
@@ -39,13 +176,13 @@ namespace MFM
   template <class CC>
   void EventWindow<CC>::SwapAtoms(const SPoint& locA, const SPoint& locB)
   {
-    SPoint arrLocA(MapToTileValid(locA));
-    SPoint arrLocB(MapToTileValid(locB));
+    u32 idxA = MapToIndexValid(locA);
+    u32 idxB = MapToIndexValid(locB);
 
-    T a = *m_tile.GetAtom(arrLocA);
-    T b = *m_tile.GetAtom(arrLocB);
-    m_tile.PlaceAtom(b, arrLocA);
-    m_tile.PlaceAtom(a, arrLocB);
+    T a = ReadAtom(idxA);
+    T b = ReadAtom(idxB);
+    WriteAtom(idxA, b);
+    WriteAtom(idxB, a);
   }
 
   template <class CC>
@@ -34,6 +34,7 @@
 #include "Point.h"
 #include "Random.h"
 #include "Dirs.h"
+#include "PSym.h"   /* For PointSymmetry, Map */
 
 namespace MFM
 {
@@ -148,6 +149,37 @@ namespace MFM
      */
     s32 FromPoint(const Point<s32>& offset, u32 radius) const;
 
+    /**
+     * Gets the MDist indices of the points of the event window as
+     * seen through a PointSymmetry: entry \c i is the index of
+     * Map(GetPoint(i), psym).
+     *
+     * \param psym The PointSymmetry to look through.
+     */
+    const u8 * GetSymmetricIndices(const PointSymmetry psym) const
+    {
+      if ((u32) psym >= PSYM_SYMMETRY_COUNT)
+      {
+        FAIL(ILLEGAL_ARGUMENT);
+      }
+      return m_symmetricIndices[psym];
+    }
+
+    /**
+     * Inverts GetSymmetricIndices: entry \c j is the index \c i for
+     * which Map(GetPoint(i), psym) is GetPoint(j).
+     *
+     * \param psym The PointSymmetry to look through.
+     */
+    const u8 * GetInverseSymmetricIndices(const PointSymmetry psym) const
+    {
+      if ((u32) psym >= PSYM_SYMMETRY_COUNT)
+      {
+        FAIL(ILLEGAL_ARGUMENT);
+      }
+      return m_inverseSymmetricIndices[psym];
+    }
+
     /*
      * Fills pt with the point represented by bits.
      * Uses a 4-bit rep if maxRadius less than 3
@@ -173,6 +205,10 @@ namespace MFM
     void InitHorizonsByDirTable();
     u8 m_horizonsByDirection[Dirs::DIR_COUNT][ARRAY_LENGTH];
 
+    void InitSymmetricIndicesTable();
+    u8 m_symmetricIndices[PSYM_SYMMETRY_COUNT][ARRAY_LENGTH];
+    u8 m_inverseSymmetricIndices[PSYM_SYMMETRY_COUNT][ARRAY_LENGTH];
+
   };
 } /* namespace MFM */
 
@@ -56,6 +56,26 @@ namespace MFM {
 
     InitEscapesByDirTable();
     InitHorizonsByDirTable();
+    InitSymmetricIndicesTable();
+  }
+
+  template<u32 R>
+  void MDist<R>::InitSymmetricIndicesTable()
+  {
+    for (u32 s = 0; s < PSYM_SYMMETRY_COUNT; ++s)
+    {
+      for (u32 idx = 0; idx < ARRAY_LENGTH; ++idx)
+      {
+        const SPoint mapped = Map(m_indexToPoint[idx], (PointSymmetry) s, m_indexToPoint[idx]);
+        const s32 mappedIdx = FromPoint(mapped, R);
+        if (mappedIdx < 0)
+        {
+          FAIL(ILLEGAL_STATE);  // A symmetry left the window?
+        }
+        m_symmetricIndices[s][idx] = (u8) mappedIdx;
+        m_inverseSymmetricIndices[s][mappedIdx] = (u8) idx;
+      }
+    }
   }
 
   template<u32 R>
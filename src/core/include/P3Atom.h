@@ -114,19 +114,43 @@ namespace MFM {
       SetType(type);
     }
 
+    /**
+     * Gets the ECC and type bits.  The fixed header always lies in
+     * the first unit of m_bits, so this is one load, shift, and mask,
+     * for any BITS.
+     */
+    u32 GetFixedHeader() const
+    {
+      return this->m_bits.template
+        ReadWithinUnit<P3_FIXED_HEADER_POS, P3_FIXED_HEADER_LEN>();
+    }
+
     u32 GetTypeImpl() const {
-      return AFTypeBits::Read(this->m_bits);
+      return this->m_bits.template
+        ReadWithinUnit<P3_TYPE_BITS_POS, P3_TYPE_BITS_LEN>();
     }
 
     bool IsSaneImpl() const
     {
-      u32 fixedHeader = AFFixedHeader::Read(this->m_bits);
-      return Parity2D_4x4::Check2DParity(fixedHeader);
+      return Parity2D_4x4::Check2DParity(GetFixedHeader());
+    }
+
+    /**
+     * Gets the type of this P3Atom if its header parity checks, or
+     * Atom::INSANE_TYPE if not, with one read of the header and one
+     * parity table lookup.  Hides Atom::GetTypeIfSane.
+     */
+    u32 GetTypeIfSane() const
+    {
+      const u32 fixedHeader = GetFixedHeader();
+      const u32 type = fixedHeader & Parity2D_4x4::INDEX_MASK;
+      const u32 eccBits = fixedHeader >> Parity2D_4x4::DATA_BITS;
+      return Parity2D_4x4::Compute2DParity(type) == eccBits ? type : (u32) this->INSANE_TYPE;
     }
 
     bool HasBeenRepairedImpl()
     {
-      u32 fixedHeader = AFFixedHeader::Read(this->m_bits);
+      u32 fixedHeader = GetFixedHeader();
       u32 repairedHeader =
         Parity2D_4x4::Correct2DParityIfPossible(fixedHeader);
 
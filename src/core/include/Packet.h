@@ -40,8 +40,10 @@ namespace MFM
   typedef enum
     {
       /**
-       * This PacketType describes a Tile's intent to write an atom to
-       * a specific location.
+       * This PacketType described a Tile's intent to write an atom to
+       * a specific location.  Atoms now only travel in a
+       * PACKET_WRITE_BATCH, so none is ever sent, and a Tile receiving
+       * one FAILs with INCOMPLETE_CODE.
        */
       PACKET_WRITE = 0,
 
@@ -59,13 +61,27 @@ namespace MFM
        * of this PacketType should be sent immediately upon receipt
        * of a PACKET_EVENT_COMPLETE Packet.
        */
-      PACKET_EVENT_ACKNOWLEDGE
+      PACKET_EVENT_ACKNOWLEDGE,
+
+      /**
+       * This PacketType heads a batch of atom writes from a single
+       * event.  Its location is the event window center, in the
+       * receiving Tile's coordinates, and its batch count is the
+       * number of sites written.  It is immediately followed in the
+       * same queue by a body of that many Atoms, then that many u8
+       * MDist indices of their sites relative to the center; see
+       * GetBatchBodyBytes.
+       */
+      PACKET_WRITE_BATCH
 
     }PacketType;
 
   /**
    * An inter-Tile communication object which holds any and all
-   * information that Tiles need to pass to one another.
+   * information that Tiles need to pass to one another, apart from
+   * the Atoms themselves.  Those only travel in the body following
+   * a PACKET_WRITE_BATCH, so this header stays a few bytes long and
+   * T only sizes that body.
    */
   template <class T>
   class Packet
@@ -89,24 +105,37 @@ namespace MFM
     u8 m_generation;
 
     /**
-     * Used to describe a location during Tile communication.
+     * For a PACKET_WRITE_BATCH, the number of sites its body
+     * describes.  Unused otherwise.
      */
-    SSPoint m_edgeLoc;
+    u8 m_batchCount;
 
     /**
-     * Used to describe an Atom during Tile communication.
+     * Used to describe a location during Tile communication.
      */
-    T m_atom;
+    SSPoint m_edgeLoc;
 
   public:
 
+    /**
+     * Constructs a new PACKET_WRITE Packet of generation 0, so that
+     * Packets can be held by value in arrays and queues.
+     */
+    Packet() :
+      m_type(PACKET_WRITE),
+      m_toNeighbor(Dirs::DIR_COUNT), // Init invalid
+      m_generation(0),
+      m_batchCount(0)
+    { }
+
     /**
      * Constructs a new Packet of a given PacketType.
      */
     Packet(PacketType type, u8 generation) :
       m_type(type),
       m_toNeighbor(Dirs::DIR_COUNT), // Init invalid
-      m_generation(generation)
+      m_generation(generation),
+      m_batchCount(0)
     { }
 
     const char* GetTypeString()
@@ -116,6 +145,7 @@ namespace MFM
       case PACKET_WRITE: return "Write";
       case PACKET_EVENT_COMPLETE: return "Event Complete";
       case PACKET_EVENT_ACKNOWLEDGE: return "Event Acknowledge";
+      case PACKET_WRITE_BATCH: return "Write Batch";
       }
       return "INVALID";
     }
@@ -140,17 +170,6 @@ namespace MFM
       m_type = type;
     }
 
-    /**
-     * Sets this Packet's held Atom.
-     *
-     * @param atom The Atom to copy into this Packet. A reference is
-     *             not kept to this Atom.
-     */
-    void SetAtom(const T& atom)
-    {
-      m_atom = atom;
-    }
-
     /**
      * Sets this Packet's held EuclidDir neighbor field.
      *
@@ -171,16 +190,6 @@ namespace MFM
       return m_toNeighbor;
     }
 
-    /**
-     * Gets a reference to this Packet's held Atom.
-     *
-     * @returns A reference to this Packet's held Atom.
-     */
-    T& GetAtom()
-    {
-      return m_atom;
-    }
-
     /**
      * Sets this Packet's held location.
      *
@@ -201,6 +210,43 @@ namespace MFM
       return SPoint(m_edgeLoc.GetX(), m_edgeLoc.GetY());
     }
 
+    /**
+     * Sets the number of sites in the body following this
+     * PACKET_WRITE_BATCH.
+     */
+    void SetBatchCount(u32 count)
+    {
+      m_batchCount = (u8) count;
+    }
+
+    /**
+     * Gets the number of sites in the body following this
+     * PACKET_WRITE_BATCH.
+     */
+    u32 GetBatchCount() const
+    {
+      return m_batchCount;
+    }
+
+    /**
+     * Gets the size of the body of a PACKET_WRITE_BATCH of \c count
+     * sites: an Atom and a one-byte site index apiece.
+     */
+    static u32 GetBatchBodyBytes(u32 count)
+    {
+      return count * (sizeof(T) + 1);
+    }
+
+    /**
+     * Gets the size of the whole record this Packet heads on a
+     * Connection: itself, plus any PACKET_WRITE_BATCH body.
+     */
+    u32 GetRecordBytes() const
+    {
+      return sizeof(Packet) +
+        (m_type == PACKET_WRITE_BATCH ? GetBatchBodyBytes(m_batchCount) : 0);
+    }
+
     /**
      * Gets this Packet's generation.
      *
@@ -18,7 +18,6 @@ namespace MFM
     Packet<T>& writePack = m_buffer[m_heldPackets++];
 
     writePack.SetType(packet.GetType());
-    writePack.SetAtom(packet.GetAtom());
     writePack.SetReceivingNeighbor(packet.GetReceivingNeighbor());
     writePack.SetLocation(packet.GetLocation());
   }
@@ -30,7 +30,6 @@
 
 #include "ByteSerializable.h"
 #include "Packet.h"
-#include "AtomSerializer.h"
 
 namespace MFM
 {
@@ -52,15 +51,14 @@ namespace MFM
     virtual Result PrintTo(ByteSink& byteSink, s32 argument = 0)
     {
       SPoint loc = m_packet.GetLocation();
-      AtomSerializer<CC> atom(m_packet.GetAtom());
-      byteSink.Printf("Pkt%d{%d/%s, gen:%d, nghb:%d, (%d, %d), %@}",
+      byteSink.Printf("Pkt%d{%d/%s, gen:%d, nghb:%d, (%d, %d), n:%d}",
                       sizeof(Packet<T>),
                       (u32) m_packet.GetType(),
                       m_packet.GetTypeString(),
                       m_packet.GetGeneration(),
                       m_packet.GetReceivingNeighbor(),
                       loc.GetX(), loc.GetY(),
-                      &atom);
+                      m_packet.GetBatchCount());
 
       return SUCCESS;
     }
@@ -56,13 +56,17 @@
 #ifndef _RANDMT_H_
 #define _RANDMT_H_
 
+#include "itype.h"
+
 namespace MFM {
 
 typedef unsigned long uint32;
 
 class RandMT {
-
+public:
   static const int N =          624;                // length of state vector
+  static const int STATE_WORDS = N + 4;             // words used by Save/LoadState
+private:
   static const int M =          397;                // a period parameter
   static const uint32 K =       0x9908B0DFU;        // a magic constant
 
@@ -102,6 +106,10 @@ public:
   // ACKLEYHAX: This seeding function hacked for MFM
   void seedMT_MFM(uint32 s) ;
 
+  // Copy the complete generator state to or from STATE_WORDS words
+  void SaveState(u32 * words) const ;
+  void LoadState(const u32 * words) ;
+
 };
 
 inline uint32 RandMT::randomMT(void) {
@@ -0,0 +1,149 @@
+/*                                              -*- mode:C++ -*-
+  RandXoshiro.h Small fast xoshiro128** pseudo-random number generator
+  Copyright (C) 2014 The Regents of the University of New Mexico.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file RandXoshiro.h Small fast xoshiro128** pseudo-random number generator
+  \lgpl
+ */
+#ifndef RANDXOSHIRO_H
+#define RANDXOSHIRO_H
+
+#include "itype.h"
+#include "Util.h"
+
+namespace MFM
+{
+  /**
+   * The xoshiro128** generator of Blackman and Vigna: 32 bit outputs
+   * from 128 bits of state, a few shifts, rotates and xors apiece,
+   * with a period of 2**128-1.  Its whole state fits in 16 bytes,
+   * against about 2.5KB for RandMT, so a Tile's generator shares a
+   * cache line with its other hot fields.
+   *
+   * Seeds are expanded into state by splitmix64, so nearby seeds,
+   * such as the ones Grid hands its Tiles, give unrelated sequences.
+   */
+  class RandXoshiro
+  {
+  public:
+    /**
+     * The number of u32's used by SaveState and LoadState.
+     */
+    static const u32 STATE_WORDS = 4;
+
+    RandXoshiro()
+    {
+      Seed(0);
+    }
+
+    void Seed(u32 seed)
+    {
+      u64 x = seed;
+      const u64 a = SplitMix64(x);
+      const u64 b = SplitMix64(x);
+      m_state[0] = (u32) a;
+      m_state[1] = (u32) (a >> 32);
+      m_state[2] = (u32) b;
+      m_state[3] = (u32) (b >> 32);
+
+      // The all-zero state is a fixed point
+      if ((m_state[0] | m_state[1] | m_state[2] | m_state[3]) == 0)
+      {
+        m_state[0] = 1;
+      }
+    }
+
+    u32 Next()
+    {
+      return Step(m_state[0], m_state[1], m_state[2], m_state[3]);
+    }
+
+    /**
+     * Stores the next \c count outputs into \c words, as \c count
+     * calls to Next would, but keeping the state in registers.
+     */
+    void Fill(u32 * words, u32 count)
+    {
+      u32 s0 = m_state[0], s1 = m_state[1], s2 = m_state[2], s3 = m_state[3];
+      for (u32 i = 0; i < count; ++i)
+      {
+        words[i] = Step(s0, s1, s2, s3);
+      }
+      m_state[0] = s0;
+      m_state[1] = s1;
+      m_state[2] = s2;
+      m_state[3] = s3;
+    }
+
+    void SaveState(u32 * words) const
+    {
+      for (u32 i = 0; i < STATE_WORDS; ++i)
+      {
+        words[i] = m_state[i];
+      }
+    }
+
+    void LoadState(const u32 * words)
+    {
+      for (u32 i = 0; i < STATE_WORDS; ++i)
+      {
+        m_state[i] = words[i];
+      }
+      if ((m_state[0] | m_state[1] | m_state[2] | m_state[3]) == 0)
+      {
+        m_state[0] = 1;   // Damaged; avoid the fixed point
+      }
+    }
+
+  private:
+    u32 m_state[STATE_WORDS];
+
+    static u32 Rotl(const u32 x, const u32 k)
+    {
+      return (x << k) | (x >> (32 - k));
+    }
+
+    static u32 Step(u32 & s0, u32 & s1, u32 & s2, u32 & s3)
+    {
+      const u32 result = Rotl(s1 * 5, 7) * 9;
+      const u32 t = s1 << 9;
+
+      s2 ^= s0;
+      s3 ^= s1;
+      s1 ^= s2;
+      s0 ^= s3;
+      s2 ^= t;
+      s3 = Rotl(s3, 11);
+
+      return result;
+    }
+
+    static u64 SplitMix64(u64 & x)
+    {
+      x += HexU64(0x9e3779b9, 0x7f4a7c15);
+      u64 z = x;
+      z = (z ^ (z >> 30)) * HexU64(0xbf58476d, 0x1ce4e5b9);
+      z = (z ^ (z >> 27)) * HexU64(0x94d049bb, 0x133111eb);
+      return z ^ (z >> 31);
+    }
+  };
+} /* namespace MFM */
+
+#endif /* RANDXOSHIRO_H */
@@ -32,6 +32,7 @@
 
 #include "itype.h"
 #include "RandMT.h"
+#include "RandXoshiro.h"
 #include "BitVector.h"
 #include "FXP.h"
 #include "Fail.h"
@@ -41,6 +42,10 @@ namespace MFM
 
   /**
    * An interface for easy PRNG interaction.
+   *
+   * The underlying generator is RandMT, or, when compiled with
+   * MFM_FAST_RANDOM, the much smaller and faster RandXoshiro.  The two
+   * produce different sequences from the same seed.
    */
   class Random
   {
@@ -68,6 +73,12 @@ namespace MFM
      */
     u32 Create() ;
 
+    /**
+     * Stores \c count words of pseudo-random bits into \c words, as
+     * \c count calls to Create() would.
+     */
+    void Fill(u32 * words, u32 count) ;
+
     /**
      * Gets a uniform pseudo-random number from 0..max-1.  FAILs
      * ILLEGAL_ARGUMENT if max==0.
@@ -146,11 +157,52 @@ namespace MFM
      */
     void SetSeed(u32 seed)
     {
+#ifdef MFM_FAST_RANDOM
+      _generator.Seed(seed);
+#else
       _generator.seedMT_MFM(seed);
+#endif
+    }
+
+#ifdef MFM_FAST_RANDOM
+    typedef RandXoshiro Generator;
+
+    /**
+     * Distinguishes the states of the generators Random may be built
+     * with, so a saved state is never loaded into the wrong one.
+     */
+    static const u32 GENERATOR_ID = 2;
+#else
+    typedef RandMT Generator;
+    static const u32 GENERATOR_ID = 1;
+#endif
+
+    /**
+     * The number of u32's needed to hold the complete state of a
+     * Random, as used by SaveState and LoadState.
+     */
+    static const u32 STATE_WORDS = Generator::STATE_WORDS;
+
+    /**
+     * Copies the complete state of this Random into \c words, which
+     * must have room for STATE_WORDS values.  A Random given that
+     * state by LoadState will produce the same sequence as this one.
+     */
+    void SaveState(u32 * words) const
+    {
+      _generator.SaveState(words);
+    }
+
+    /**
+     * Restores a state previously copied out by SaveState.
+     */
+    void LoadState(const u32 * words)
+    {
+      _generator.LoadState(words);
     }
 
   private:
-    RandMT _generator;
+    Generator _generator;
 
   };
 
@@ -160,24 +212,45 @@ namespace MFM
 
   inline u32 Random::Create()
   {
+#ifdef MFM_FAST_RANDOM
+    return _generator.Next();
+#else
     return _generator.randomMT();
+#endif
+  }
+
+  inline void Random::Fill(u32 * words, u32 count)
+  {
+#ifdef MFM_FAST_RANDOM
+    _generator.Fill(words, count);
+#else
+    for (u32 i = 0; i < count; ++i)
+    {
+      words[i] = _generator.randomMT();
+    }
+#endif
   }
 
-  // Avoid modulus artifacts by sampling from round powers of 2 and rejecting
+  // Scale by multiplying rather than dividing, and reject the few
+  // low products that would bias the result (Lemire 2019)
   inline u32 Random::Create(const u32 maxval)
   {
     if (maxval==0)
     {
       FAIL(ILLEGAL_ARGUMENT);
     }
-    int bitmask = _getNextPowerOf2(maxval)-1;
-    u32 ret;
-    do
-    {  // loop executes less than two times on average
-      ret = Create()&bitmask;
-    } while (ret >= maxval);
-
-    return ret;
+    u64 product = (u64) Create() * maxval;
+    u32 low = (u32) product;
+    if (low < maxval)
+    {
+      const u32 threshold = (0u - maxval) % maxval;
+      while (low < threshold)
+      {  // taken with odds of at most maxval in 2**32
+        product = (u64) Create() * maxval;
+        low = (u32) product;
+      }
+    }
+    return (u32) (product >> 32);
   }
 
   inline bool Random::OddsOf(u32 thisMany, u32 outOfThisMany)
@@ -0,0 +1,254 @@
+/*                                              -*- mode:C++ -*-
+  SPSCQueue.h Lock-free single-producer single-consumer ring
+  Copyright (C) 2014 The Regents of the University of New Mexico.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file SPSCQueue.h Lock-free single-producer single-consumer ring
+  \author David H. Ackley.
+  \date (C) 2014 All rights reserved.
+  \lgpl
+ */
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <string.h>  /* For memcpy */
+#include "itype.h"
+#include "Fail.h"
+#include "Util.h"   /* For CACHE_LINE_BYTES */
+#include "Logger.h"
+
+namespace MFM
+{
+  /**
+   * A lock-free queue of fixed-size elements of type E, for use by
+   * exactly one producer thread and exactly one consumer thread.  The
+   * producer is the only writer of the write index and the consumer
+   * is the only writer of the read index, so the two sides
+   * synchronize purely with acquire/release loads and stores of
+   * those indices -- no mutex, no condition variable.  The indices
+   * live on separate cache lines so the two threads do not
+   * ping-pong a shared line on every operation.
+   *
+   * CAPACITY must be a power of two.  The indices run freely and
+   * are reduced modulo CAPACITY only when addressing m_slots.  E
+   * must be plain data, since elements are copied in and out by
+   * memcpy.
+   */
+  template <class E, u32 CAPACITY>
+  class SPSCQueue
+  {
+  private:
+    enum { MASK = CAPACITY - 1 };
+
+    /**
+     * Written only by the producer: the total number of elements
+     * ever written.
+     */
+    u32 m_writeIndex;
+
+    u8 m_pad0[CACHE_LINE_BYTES - sizeof(u32)];
+
+    /**
+     * Written only by the consumer: the total number of elements
+     * ever read.
+     */
+    u32 m_readIndex;
+
+    u8 m_pad1[CACHE_LINE_BYTES - sizeof(u32)];
+
+    /**
+     * The ring storage itself.
+     */
+    E m_slots[CAPACITY];
+
+    static u32 LoadAcquire(const u32 & idx)
+    {
+      return __atomic_load_n(&idx, __ATOMIC_ACQUIRE);
+    }
+
+    static void StoreRelease(u32 & idx, u32 value)
+    {
+      __atomic_store_n(&idx, value, __ATOMIC_RELEASE);
+    }
+
+    /**
+     * Copies \c count elements starting at free-running index \c
+     * from out to \c elts, as (at most) two memcpy runs rather than
+     * element by element.
+     */
+    void CopyOut(E * elts, u32 from, u32 count) const
+    {
+      const u32 start = from & MASK;
+      const u32 first = MIN(count, CAPACITY - start);
+      memcpy(elts, &m_slots[start], first * sizeof(E));
+      memcpy(elts + first, &m_slots[0], (count - first) * sizeof(E));
+    }
+
+  public:
+
+    /**
+     * Constructs a new, empty SPSCQueue.
+     */
+    SPSCQueue() : m_writeIndex(0), m_readIndex(0)
+    {
+      COMPILATION_REQUIREMENT<CAPACITY != 0 && (CAPACITY & (CAPACITY - 1)) == 0>();
+    }
+
+    /**
+     * Gets the maximum number of elements this SPSCQueue can hold.
+     */
+    u32 GetCapacity() const
+    {
+      return CAPACITY;
+    }
+
+    /**
+     * Appends \c count elements, taken from \c elts, to this
+     * SPSCQueue.  All \c count elements become visible to the
+     * consumer at the same instant.  Producer side only.  FAILs with
+     * OUT_OF_RESOURCES if there is not room for all of them.
+     *
+     * @param elts The elements to copy into this SPSCQueue.
+     *
+     * @param count The number of elements at \c elts.
+     */
+    void Write(const E * elts, u32 count)
+    {
+      const u32 w = m_writeIndex;  // Only we write this
+      if (count > CAPACITY - (w - LoadAcquire(m_readIndex)))
+      {
+        LOG.Error("ERROR: SPSCQUEUE OVERLOAD!\n");
+        FAIL(OUT_OF_RESOURCES);
+      }
+
+      const u32 start = w & MASK;
+      const u32 first = MIN(count, CAPACITY - start);
+      memcpy(&m_slots[start], elts, first * sizeof(E));
+      memcpy(&m_slots[0], elts + first, (count - first) * sizeof(E));
+      StoreRelease(m_writeIndex, w + count);
+    }
+
+    /**
+     * Appends a single element to this SPSCQueue.  Producer side
+     * only.  FAILs with OUT_OF_RESOURCES if this SPSCQueue is full.
+     */
+    void Write(const E & elt)
+    {
+      Write(&elt, 1);
+    }
+
+    /**
+     * Removes the oldest element from this SPSCQueue, if any, without
+     * blocking.  Consumer side only.
+     *
+     * @param elt Overwritten with the element read, if any.
+     *
+     * @returns \c true if an element was read, \c false if this
+     *          SPSCQueue was empty.
+     */
+    bool Read(E & elt)
+    {
+      const u32 r = m_readIndex;  // Only we write this
+      if (r == LoadAcquire(m_writeIndex))
+      {
+        return false;
+      }
+      elt = m_slots[r & MASK];
+      StoreRelease(m_readIndex, r + 1);
+      return true;
+    }
+
+    /**
+     * Removes up to \c maxCount of the oldest elements from this
+     * SPSCQueue, without blocking.  Consumer side only.
+     *
+     * @param elts Overwritten with the elements read, if any.
+     *
+     * @param maxCount The most elements to read.
+     *
+     * @returns The number of elements read.
+     */
+    u32 Read(E * elts, u32 maxCount)
+    {
+      const u32 r = m_readIndex;  // Only we write this
+      u32 count = LoadAcquire(m_writeIndex) - r;
+      if (count > maxCount)
+      {
+        count = maxCount;
+      }
+      CopyOut(elts, r, count);
+      StoreRelease(m_readIndex, r + count);
+      return count;
+    }
+
+    /**
+     * Copies the element \c index places from the front of this
+     * SPSCQueue into \c elt, without consuming anything.  Intended
+     * for diagnostics from the consumer side or while both ends are
+     * quiescent.  FAILs with ARRAY_INDEX_OUT_OF_BOUNDS if fewer than
+     * \c index + 1 elements are held.
+     */
+    void PeekRead(E & elt, u32 index) const
+    {
+      const u32 r = LoadAcquire(m_readIndex);
+      if (index >= LoadAcquire(m_writeIndex) - r)
+      {
+        FAIL(ARRAY_INDEX_OUT_OF_BOUNDS);
+      }
+      elt = m_slots[(r + index) & MASK];
+    }
+
+    /**
+     * Copies the \c count elements starting \c index places from the
+     * front of this SPSCQueue into \c elts, without consuming
+     * anything; otherwise as PeekRead(E &, u32).
+     */
+    void PeekRead(E * elts, u32 index, u32 count) const
+    {
+      const u32 r = LoadAcquire(m_readIndex);
+      if (index + count > LoadAcquire(m_writeIndex) - r)
+      {
+        FAIL(ARRAY_INDEX_OUT_OF_BOUNDS);
+      }
+      CopyOut(elts, r + index, count);
+    }
+
+    /**
+     * Gets the number of elements currently held.  Exact only when
+     * called from one of the two ends; from elsewhere it is merely a
+     * recent value.
+     */
+    u32 ElementsAvailable() const
+    {
+      return LoadAcquire(m_writeIndex) - LoadAcquire(m_readIndex);
+    }
+
+    /**
+     * Discards all held elements.  As with ThreadQueue::Flush, this
+     * is only for erroneous cases, and must only be called when the
+     * producer is known not to be writing.
+     */
+    void Flush()
+    {
+      StoreRelease(m_readIndex, LoadAcquire(m_writeIndex));
+    }
+  };
+}
+
+#endif /* SPSCQUEUE_H */
@@ -36,6 +36,8 @@
 #include "EventWindow.h"
 #include "ElementTable.h"
 #include "Connection.h"
+#include "EventCount.h"
+#include "CoreAffinity.h"
 #include "ThreadPauser.h"
 #include "OverflowableCharBufferByteSink.h"  /* for OString16 */
 
@@ -108,6 +110,30 @@ namespace MFM
      */
     static const u32 OWNED_SIDE = TILE_WIDTH-2*R;
 
+    /**
+     * A consistent copy of a Tile's Atoms and counters, published by
+     * the thread running the Tile so that others may read them while
+     * the Tile keeps running.
+     *
+     * @sa RequestSnapshot
+     */
+    struct Snapshot
+    {
+      /** The Tile's Atoms, caches included */
+      T m_atoms[TILE_WIDTH][TILE_WIDTH];
+
+      /** Events since each owned site last changed, as by
+          GetUncachedWriteAge */
+      u32 m_writeAges[OWNED_SIDE][OWNED_SIDE];
+
+      /** Indexed like the Tile's own atom counts */
+      s32 m_atomCount[ELEMENT_TABLE_SIZE];
+
+      u64 m_eventsExecuted;
+      SPoint m_lastExecutedAtom;
+      bool m_executingOwnEvents;
+    };
+
   private:
     /**
      * A brief name or label for this Tile, for reporting and debugging
@@ -173,6 +199,19 @@ namespace MFM
     u64 m_lockAttempts;
     u64 m_lockAttemptsSucceeded;
 
+    /**
+     * Per region Dir, the LockRegion attempts that failed, whether a
+     * needed Connection was seen held or was lost in a race.
+     */
+    u64 m_lockFailures[Dirs::DIR_COUNT];
+
+    /**
+     * Per corner Dir, the TryLockCorner attempts that saw all three
+     * Connections free but then lost one of them to the neighbor
+     * before claiming it.  Only these undo locks already taken.
+     */
+    u64 m_lockContention[Dirs::DIR_COUNT];
+
     /**
      * The number of events which have occurred in every individual
      * site. Indexed as m_siteEvents[x][y], x,y : 0..OWNED_SIDE-1.
@@ -185,17 +224,83 @@ namespace MFM
      */
     u64 m_lastChangedEventNumber[OWNED_SIDE][OWNED_SIDE];
 
+    /** Marks an owned site absent from m_activeSites */
+    static const u16 INACTIVE_SITE = 0xffff;
+
+    /**
+     * The owned sites holding anything but Element_Empty, each as
+     * x*OWNED_SIDE+y with x,y : 0..OWNED_SIDE-1, in no particular
+     * order.  The first m_activeSiteCount entries are valid.
+     */
+    u16 m_activeSites[OWNED_SIDE * OWNED_SIDE];
+
+    /**
+     * For each owned site, numbered as in m_activeSites, its index in
+     * m_activeSites, or INACTIVE_SITE.
+     */
+    u16 m_activeSiteIndices[OWNED_SIDE * OWNED_SIDE];
+
+    u32 m_activeSiteCount;
+
+    /**
+     * If true, events are only run at active sites; see
+     * SetSparseEvents.
+     */
+    bool m_sparseEvents;
+
+    /**
+     * How many events this Tile's thread runs between checks of its
+     * ThreadPauser; see SetEventBatchSize.
+     */
+    u32 m_eventBatchSize;
+
+    /**
+     * Events skipped over empty sites by sparse event selection, in
+     * units of 1/m_activeSiteCount of an event, not yet added to
+     * m_eventsExecuted.
+     */
+    u32 m_skippedEventCredit;
+
     friend class EventWindow<CC>;
 
     /** The Atoms currently held by this Tile, including caches. */
     T m_atoms[TILE_WIDTH][TILE_WIDTH];
 
+#ifdef MFM_TYPE_PLANE
+    /** The type of each Atom in m_atoms, row by row (m_types[y][x]),
+        truncated to 16 bits as in EventWindow, so that whole-Tile
+        scans read two bytes a site rather than a whole Atom.  Element
+        types are allocated within 16 bits (see StaticLoader), so only
+        damaged Atoms lose any.  Kept current by every write to
+        m_atoms; see SetAtomType. */
+    u16 m_types[TILE_WIDTH][TILE_WIDTH];
+#endif
+
     /** An index of the number of each type of Atom currently held
         within this Tile.*/
     s32 m_atomCount[ELEMENT_TABLE_SIZE];
 
-    /** Set to true if an impossible count is detected */
-    bool m_needRecount;
+    /** Nonzero when this Tile should recount its Atoms in its own
+        thread, before its next event: set by RequestRecount, or when
+        an impossible count is detected */
+    u32 m_needRecount;
+
+    /** Recounts that found the incremental atom counts wrong */
+    u32 m_countRepairs;
+
+    /** Bumped whenever any site of this Tile, caches included,
+        changes; never reset, so any difference means a change */
+    u32 m_atomChanges;
+
+    /** Two Snapshots: the published one, and one to fill next; null
+        until StartPublishingSnapshots, as most Tiles never need them */
+    Snapshot * m_snapshots;
+
+    /** The index of the published Snapshot in m_snapshots */
+    u32 m_publishedSnapshot;
+
+    /** Nonzero when a new Snapshot should be published */
+    u32 m_snapshotRequested;
 
     /** A count of corrupted atoms for which an element could not be
         found */
@@ -208,9 +313,38 @@ namespace MFM
     /** The only EventWindow to exist in this tile. */
     EventWindow<CC> m_executingWindow;
 
+    /** The most sites a PACKET_WRITE_BATCH can describe: the whole
+        event window. */
+    static const u32 MAX_BATCH_SITES = EVENT_WINDOW_SITES(R);
+
+    /** Scratch space for assembling an outgoing PACKET_WRITE_BATCH
+        record: its Packet, then its body. */
+    u8 m_batchRecord[sizeof(Packet<T>) + MAX_BATCH_SITES * (sizeof(T) + 1)];
+
+    /** Scratch space for collecting the body of an incoming
+        PACKET_WRITE_BATCH: its Atoms, then their site indices. */
+    T m_batchAtoms[MAX_BATCH_SITES];
+    u8 m_batchSites[MAX_BATCH_SITES];
+
     /** Pointers to Connections to each of this Tile's neighbors,
         indexed by EuclidDir. */
-    Connection* m_connections[8];
+    Connection<T>* m_connections[8];
+
+    /** The neighboring Tiles themselves, indexed by EuclidDir, or
+        NULL where there is no neighbor.  Used only when this Tile is
+        externally scheduled. */
+    Tile<CC>* m_neighborTiles[8];
+
+    /** True if this Tile is run by an outside scheduler, via
+        ExecuteEvents, rather than by its own thread.  Such a Tile
+        answers for its neighbors when waiting on them.  */
+    bool m_externallyScheduled;
+
+    /** True if this Tile writes its shared atoms straight into its
+        neighbors' caches, rather than sending them Packets.  Only
+        for externally scheduled Tiles run one event at a time
+        grid-wide, since no locks are taken either. */
+    bool m_directCacheUpdates;
 
     /** True if this tile currently holds the lock on the associated
         Connection. */
@@ -221,6 +355,34 @@ namespace MFM
     u32 m_curFnWingDirWaitWord;
     u32 m_origFnWingDirWaitWord;
 
+    /** Notified whenever a neighbor writes Packets for this Tile to
+        read. */
+    EventCount m_packetArrivals;
+
+    /** The fewest, initial, and most polling passes (each followed
+        by a yield) that FlushAndWaitOnAllBuffers makes before
+        blocking, under MFM_BLOCKING_FLUSH. */
+    static const u32 FLUSH_SPIN_MIN = 4;
+    static const u32 FLUSH_SPIN_START = 64;
+    static const u32 FLUSH_SPIN_MAX = 1024;
+
+    /** The longest FlushAndWaitOnAllBuffers blocks before polling
+        again regardless, under MFM_BLOCKING_FLUSH. */
+    static const u32 FLUSH_BLOCK_TIMEOUT_MICROS = 1000;
+
+    /** The current number of polling passes before blocking; grows
+        when acknowledgments arrive while spinning, shrinks when they
+        don't. */
+    u32 m_flushSpinLimit;
+
+    /** How many FlushAndWaitOnAllBuffers calls had to wait at all,
+        how many times they blocked (or slept), and the time spent
+        polling and blocked. */
+    u64 m_flushWaits;
+    u64 m_flushBlocks;
+    u64 m_flushSpinNanos;
+    u64 m_flushBlockNanos;
+
     /** True if this tile is currently in trying to advance to pause ready. */
     bool m_isA2PRed;
 
@@ -231,7 +393,7 @@ namespace MFM
      * The real Connections to half of this Tile's neighbors. Indexing
      * begins at EUDIR_EAST and ends at EUDIR_SOUTHWEST .
      */
-    Connection m_ownedConnections[4];
+    Connection<T> m_ownedConnections[4];
 
     /**
      * The pthread_t which will run when this Tile is started.
@@ -246,6 +408,14 @@ namespace MFM
      */
     bool m_threadInitialized;
 
+    /**
+     * The CPU to pin m_thread to when it starts, or -1 to leave it
+     * wherever the OS likes.
+     *
+     * @sa SetPinnedCPU
+     */
+    s32 m_pinnedCPU;
+
     /**
      * Returns true if this Tile is paused, or if the accessing thread
      * is this Tile's owner.
@@ -306,6 +476,36 @@ namespace MFM
      */
     void CreateRandomWindow();
 
+    /**
+     * Sets \c center to an owned site chosen uniformly at random.
+     */
+    void ChooseRandomSite(SPoint & center);
+
+    /**
+     * Sets \c center to an active owned site chosen uniformly at
+     * random, and adds to m_eventsExecuted the events that
+     * CreateRandomWindow would have spent, on average, on empty sites
+     * in the meantime.  If there are no active sites, instead counts
+     * the one event that would have found an empty site and returns
+     * false.
+     */
+    bool ChooseActiveSite(SPoint & center);
+
+    /**
+     * Sets \c center to where the next event should happen: any
+     * owned site, or, under SetSparseEvents, an active one.
+     *
+     * @returns false if there is nowhere to run an event.
+     */
+    bool ChooseEventCenter(SPoint & center);
+
+    /**
+     * Adds or removes the owned site (x,y), x,y : 0..OWNED_SIDE-1,
+     * from m_activeSites according to whether \c type is
+     * Element_Empty's.
+     */
+    void UpdateActiveSite(u32 x, u32 y, u32 type);
+
     /**
      * Sets m_executingWindow to a specified location in this Tile. After
      * calling, m_executingWindow is ready for execution.
@@ -315,9 +515,9 @@ namespace MFM
     void CreateWindowAt(const SPoint& pt);
 
     /**
-     * Populates m_outgoingPackets with all Packets describing the state of
-     * this Tile's caches. All Packets created by this method are ready to
-     * be output to other Tiles.
+     * Sends, to each neighbor that caches them, the sites of the
+     * executing EventWindow that changed during the event just
+     * executed.  Unchanged sites are not sent.
      *
      * @returns a bitfield describing which neighbors need to be
      *          waited on for receipt of an acknowledgement
@@ -355,18 +555,19 @@ namespace MFM
     static SPoint GetNeighborLoc(Dir neighbor, const SPoint& atomLoc);
 
     /**
-     * Creates a single Packet describing an Atom placement on this
-     * Tile's cache, therefore describing an Atom placement on another
-     * Tile's main memory. This Packet is placed in m_outgoingPackets,
-     * ready to be sent.
+     * Sends one PACKET_WRITE_BATCH record, describing the Atoms at
+     * some sites of the executing EventWindow, to a neighboring Tile
+     * whose main memory those sites of this Tile's cache represent.
      *
      * @param neighbor The EuclidDir direction of the cache which should
-     *                 recieve the generated Packet.
+     *                 recieve the batch.
+     *
+     * @param siteIndices The MDist indices, within the executing
+     *                    EventWindow, of the sites to send.
      *
-     * @param atomLoc  The current location of the Atom which should be
-     *                 written to the destination Tile.
+     * @param count The number of sites at \c siteIndices .
      */
-    void SendAtom(Dir neighbor, SPoint& atomLoc);
+    void SendAtomBatch(Dir neighbor, const u8 * siteIndices, u32 count);
 
     /**
      * Attempt to lock the specified Connection, if it is in use. This
@@ -383,8 +584,10 @@ namespace MFM
     /**
      * Attempt to lock the specified Connection, along with the
      * Connections to its left and to its right. This will return
-     * immediately regardless of acquiring said locks, and will unlock
-     * all regions if any locks cannot be acquired.
+     * immediately regardless of acquiring said locks.  It first looks
+     * at all three, failing without claiming any if one is held; only
+     * if the neighbor takes one in the meantime does it unlock the
+     * ones it already claimed.
      *
      * @param cornerDir The center EuclidDir to target locking of.
      *
@@ -467,7 +670,11 @@ namespace MFM
     inline bool IsInHidden(const SPoint& pt);
 
     /**
-     * Performs a single Event on the generated EventWindow .
+     * Performs a single Event on the generated EventWindow .  If \c
+     * locked, the caller holds the lock on \c lockRegion, and
+     * releases it afterwards.  Events in the hidden region neither
+     * send nor receive Packets; the caller must
+     * FlushAndWaitOnAllBuffers(0) after a run of them.
      */
     void DoEvent(bool locked, Dir lockRegion);
 
@@ -496,6 +703,8 @@ namespace MFM
      */
     Tile();
 
+    ~Tile();
+
     /**
      * Sets a value in this Tile corresponding to its tolerance of
      * threading problems.
@@ -567,7 +776,7 @@ namespace MFM
      * @returns a pointer to the held connection, or NULL if there is
      *          none.
      */
-    Connection* GetConnection(Dir cache);
+    Connection<T>* GetConnection(Dir cache);
 
     /**
      * Gets the number of sites in this Tile in sites, excluding caches.
@@ -719,6 +928,65 @@ namespace MFM
       return m_eventsExecuted;
     }
 
+    /**
+     * Gets a counter that changes whenever any Atom in this Tile,
+     * caches included, does.  If two calls return the same value, no
+     * Atom changed in between (barring 2**32 changes).
+     */
+    u32 GetAtomChangeCount() const
+    {
+      return m_atomChanges;
+    }
+
+    /**
+     * Allocates this Tile's Snapshots, if not done already, and
+     * publishes one.  Must be called while this Tile is paused, and
+     * before any other Snapshot function.
+     */
+    void StartPublishingSnapshots() ;
+
+    /**
+     * Asks whichever thread runs this Tile to publish a new Snapshot
+     * at its next opportunity between events.  Must not be called
+     * while any reference from GetSnapshot is still in use, since the
+     * Snapshot that will be overwritten may be the one it refers to.
+     */
+    void RequestSnapshot()
+    {
+      __atomic_store_n(&m_snapshotRequested, 1, __ATOMIC_RELEASE);
+    }
+
+    /**
+     * Returns true if a Snapshot has been requested but not yet
+     * published.
+     */
+    bool IsSnapshotRequested() const
+    {
+      return __atomic_load_n(&m_snapshotRequested, __ATOMIC_ACQUIRE) != 0;
+    }
+
+    /**
+     * Copies this Tile's current state into a new Snapshot and
+     * publishes it.  Called between events by the thread running this
+     * Tile, or by anyone while this Tile is paused.
+     */
+    void PublishSnapshot() ;
+
+    /**
+     * Gets the most recently published Snapshot of this Tile.  Its
+     * contents stay unchanged until after the next RequestSnapshot.
+     */
+    const Snapshot & GetSnapshot() const
+    {
+      return m_snapshots[__atomic_load_n(&m_publishedSnapshot, __ATOMIC_ACQUIRE)];
+    }
+
+    /**
+     * Gets the number of Atoms of type \c atomType as of the most
+     * recently published Snapshot.
+     */
+    u32 GetSnapshotAtomCount(ElementType atomType) const ;
+
     /**
      * Checks to see if a specified SPoint is in a given region of this
      * Tile (i.e. cache, shared, visible, or hidden).
@@ -837,7 +1105,7 @@ namespace MFM
      *          place where Atoms are unique, we need to be able to
      *          access them in a writable way. Therefore, we have this
      *          non-const accessor. Use GetAtom if not writing to this
-     *          Atom.
+     *          Atom, and call RecountAtoms after changing its type.
      */
     T* GetWritableAtom(s32 x, s32 y)
     {
@@ -845,9 +1113,52 @@ namespace MFM
       {
         FAIL(ARRAY_INDEX_OUT_OF_BOUNDS);
       }
+      ++m_atomChanges;  // Assume the worst
       return &m_atoms[x][y];
     }
 
+    /**
+     * Gets the type of the Atom at (\c x, \c y) in this Tile, caches
+     * included, as by GetAtom(x, y)->GetType() but, if built with
+     * MFM_TYPE_PLANE, without reading the Atom itself.  Says nothing
+     * about whether the Atom is sane.
+     */
+    u32 GetAtomType(s32 x, s32 y) const
+    {
+      if (((u32) x) >= TILE_WIDTH || ((u32) y) >= TILE_WIDTH)
+      {
+        FAIL(ARRAY_INDEX_OUT_OF_BOUNDS);
+      }
+#ifdef MFM_TYPE_PLANE
+      return m_types[y][x];
+#else
+      return m_atoms[x][y].GetType();
+#endif
+    }
+
+    u32 GetAtomType(const SPoint& pt) const
+    {
+      return GetAtomType(pt.GetX(), pt.GetY());
+    }
+
+    /**
+     * Gets all of this Tile's Atoms, caches included, as
+     * TILE_WIDTH*TILE_WIDTH contiguous Atoms ordered by x and then y,
+     * for copying out wholesale.
+     */
+    const T* GetAtomArray() const
+    {
+      return &m_atoms[0][0];
+    }
+
+    /**
+     * Replaces all of this Tile's Atoms, caches included, with the
+     * TILE_WIDTH*TILE_WIDTH Atoms at \c atoms, laid out as by
+     * GetAtomArray, and recounts them.  The caller must ensure the
+     * result is consistent with this Tile's neighbors.
+     */
+    void LoadAtomArray(const T* atoms);
+
     /**
      * Gets an Atom from a specified point in this Tile.  Indexing
      * ignores the cache boundary, so possible range is (0,0) to
@@ -929,8 +1240,15 @@ namespace MFM
      * Packet semantics.
      *
      * @param packet The Packet which this Tile will process.
+     *
+     * @param batchAtoms If \c packet is a PACKET_WRITE_BATCH, the
+     *                   packet.GetBatchCount() Atoms of its body.
+     *                   Ignored otherwise.
+     *
+     * @param batchSites Likewise, the MDist indices of their sites.
      */
-    void ReceivePacket(Packet<T>& packet);
+    void ReceivePacket(Packet<T>& packet, const T* batchAtoms = 0,
+                       const u8* batchSites = 0);
 
 #if 0 /* Doesn't exist? */
     /**
@@ -1023,10 +1341,20 @@ namespace MFM
     }
 
     /**
-     * Executes a single new EventWindow at a randomly chosen location.
+     * Runs this Tile's own thread loop, until its thread is stopped.
      */
     void Execute();
 
+    /**
+     * Executes up to \c count (at most MAX_EVENT_BATCH) new
+     * EventWindows at randomly chosen locations.  All the locations
+     * are chosen first; then the events in the hidden region run
+     * back to back, and the rest run grouped by the region they must
+     * lock, each lock held across its group.  An event whose lock
+     * can't be had is skipped.
+     */
+    void ExecuteOwnEvents(u32 count);
+
     /**
      * Used during thread execution to call the execution loop.
      *
@@ -1058,6 +1386,17 @@ namespace MFM
      */
     void InternalPutAtom(const T & atom, s32 x, s32 y);
 
+    /**
+     * Brings the type plane, if built with MFM_TYPE_PLANE, up to date
+     * with the Atom at (\c x, \c y), which must be in range.
+     */
+    void SetAtomType(u32 x, u32 y)
+    {
+#ifdef MFM_TYPE_PLANE
+      m_types[y][x] = (u16) m_atoms[x][y].GetType();
+#endif
+    }
+
     /**
      * Sets the internal count of Atoms of a specified ElementType.
      *
@@ -1084,6 +1423,81 @@ namespace MFM
      */
     void Pause();
 
+    /**
+     * Sets the CPU this Tile's thread will be pinned to when it is
+     * first Started, or -1 (the default) for no pinning.  FAILs with
+     * ILLEGAL_STATE if the thread has already started.
+     */
+    void SetPinnedCPU(s32 cpu)
+    {
+      if (m_threadInitialized)
+      {
+        FAIL(ILLEGAL_STATE);
+      }
+      m_pinnedCPU = cpu;
+    }
+
+    s32 GetPinnedCPU() const
+    {
+      return m_pinnedCPU;
+    }
+
+    /**
+     * Returns true once Start has created this Tile's own thread,
+     * which then runs for the life of the process.
+     */
+    bool IsThreadStarted() const
+    {
+      return m_threadInitialized;
+    }
+
+    /**
+     * Marks this Tile as run by an outside scheduler rather than by
+     * its own thread.  Must be set before the Tile is ever Started,
+     * and while it is paused.
+     *
+     * @sa ExecuteEvents
+     */
+    void SetExternallyScheduled(bool value)
+    {
+      if (m_threadInitialized)
+      {
+        FAIL(ILLEGAL_STATE);
+      }
+      m_externallyScheduled = value;
+    }
+
+    bool IsExternallyScheduled() const
+    {
+      return m_externallyScheduled;
+    }
+
+    /**
+     * Makes this Tile update its neighbors' caches directly, with no
+     * region locking, Packets, or acknowledgments.  Only safe when a
+     * single thread runs every event in the Grid.  FAILs with
+     * ILLEGAL_STATE unless this Tile is externally scheduled.
+     */
+    void SetDirectCacheUpdates(bool value)
+    {
+      if (!m_externallyScheduled)
+      {
+        FAIL(ILLEGAL_STATE);
+      }
+      m_directCacheUpdates = value;
+    }
+
+    /**
+     * Executes up to \c count events on this Tile, on the calling
+     * thread.  For externally scheduled Tiles only: the caller must
+     * have exclusive use of this Tile and all its neighbors for the
+     * duration, since their sides of each event are processed here
+     * as well.
+     *
+     * @param count The number of events to attempt.
+     */
+    void ExecuteEvents(u32 count);
+
     /**
      * Sees if this Tile is ready to be run.  We let all tiles respond
      * to a RunRequest before moving on to actually running, so this
@@ -1136,14 +1550,37 @@ namespace MFM
     void AssertValidAtomCounts() const;
 
     /**
-     * Calls RecountAtoms if anybody has signaled a need to do so.
-     * this tile.
+     * Calls RecountAtoms if anybody has signaled a need to do so,
+     * logging and counting any difference from the incremental
+     * counts.  Only called by whoever is running this Tile's events.
      */
     void RecountAtomsIfNeeded();
 
+    /**
+     * Has whoever runs this Tile's events recount its Atoms, and
+     * check the result against the counts kept as Atoms are placed,
+     * before its next event rather than on the caller's thread.  Safe
+     * to call from any thread at any time.
+     */
+    void RequestRecount()
+    {
+      __atomic_store_n(&m_needRecount, 1, __ATOMIC_RELEASE);
+    }
+
+    /**
+     * Gets how many recounts have found this Tile's incremental atom
+     * counts wrong.
+     */
+    u32 GetCountRepairs() const
+    {
+      return m_countRepairs;
+    }
+
     /**
      * Resets all atom counts and refreshes the atoms counts inside
-     * this tile.
+     * this tile.  Reads the Atoms themselves, not the type plane,
+     * which it rebuilds, so it also catches types changed through
+     * GetWritableAtom.
      */
     void RecountAtoms();
 
@@ -1175,6 +1612,60 @@ namespace MFM
       m_backgroundRadiationEnabled = value;
     }
 
+    /**
+     * Sets whether this Tile runs events only at owned sites holding
+     * something other than Element_Empty, which would do nothing
+     * anyway.  Each such event then also counts, in
+     * GetEventsExecuted, the events that picking sites uniformly
+     * would have spent on empty sites meanwhile, so AEPS stays
+     * comparable.  Per-site event counts include only the events
+     * actually run.
+     */
+    void SetSparseEvents(bool value)
+    {
+      m_sparseEvents = value;
+    }
+
+    bool IsSparseEvents() const
+    {
+      return m_sparseEvents;
+    }
+
+    /**
+     * The largest number of events that may be batched together.
+     */
+    static const u32 MAX_EVENT_BATCH = 128;
+
+    /**
+     * Sets how many events this Tile runs as a batch (see
+     * ExecuteOwnEvents), both on its own thread, between checks for
+     * pause requests, and within ExecuteEvents.  The default, 1,
+     * runs each event as soon as its location is chosen.  FAILs with
+     * ILLEGAL_ARGUMENT unless \c size is 1..MAX_EVENT_BATCH.
+     */
+    void SetEventBatchSize(u32 size)
+    {
+      if (size == 0 || size > MAX_EVENT_BATCH)
+      {
+        FAIL(ILLEGAL_ARGUMENT);
+      }
+      m_eventBatchSize = size;
+    }
+
+    u32 GetEventBatchSize() const
+    {
+      return m_eventBatchSize;
+    }
+
+    /**
+     * Gets the number of owned sites holding anything but
+     * Element_Empty.
+     */
+    u32 GetActiveSiteCount() const
+    {
+      return m_activeSiteCount;
+    }
+
     /**
      * XRays a single randomly chosen Atom in this Tile, with the odds
      * of flipping a bit being BACKGROUND_RADIATION_BIT_ODDS .
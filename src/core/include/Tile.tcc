@@ -5,6 +5,7 @@
 #include "AtomSerializer.h"
 #include "PacketSerializer.h"
 #include "Util.h"
+#include <string.h>  /* For memcpy, memcmp */
 
 namespace MFM
 {
@@ -15,9 +16,30 @@ namespace MFM
     m_generation(0)
   {
     m_lockAttempts = m_lockAttemptsSucceeded = 0;
+    for(u32 i = 0; i < Dirs::DIR_COUNT; i++)
+    {
+      m_lockFailures[i] = m_lockContention[i] = 0;
+    }
+    m_externallyScheduled = false;
+    m_directCacheUpdates = false;
+    m_pinnedCPU = -1;
+    m_atomChanges = 0;
+    m_snapshots = 0;
+    m_publishedSnapshot = 0;
+    m_snapshotRequested = 0;
+
+    // Owned site numbers must fit in m_activeSites
+    COMPILATION_REQUIREMENT< (OWNED_SIDE * OWNED_SIDE < INACTIVE_SITE) >();
+
     Reinit();
   }
 
+  template <class CC>
+  Tile<CC>::~Tile()
+  {
+    delete [] m_snapshots;
+  }
+
   template <class CC>
   void Tile<CC>::SetIgnoreThreadingProblems(bool value)
   {
@@ -47,10 +69,18 @@ namespace MFM
 
     m_eventsExecuted = 0;
 
+    m_flushSpinLimit = FLUSH_SPIN_START;
+    m_flushWaits = m_flushBlocks = 0;
+    m_flushSpinNanos = m_flushBlockNanos = 0;
+
     m_executeOwnEvents = true;
 
     m_backgroundRadiationEnabled = false;
 
+    m_sparseEvents = false;
+    m_skippedEventCredit = 0;
+    m_eventBatchSize = 1;
+
     /* Set up our connection pointers. Some of these may remain NULL, */
     /* symbolizing a dead edge.       */
     u32 edges = 0;
@@ -60,6 +90,9 @@ namespace MFM
       /* We have nothing locked */
       m_iLocked[i] = false;
 
+      /* And know no one, until the grid connects us */
+      m_neighborTiles[i] = NULL;
+
       if(IS_OWNED_CONNECTION(i))
       {
         /* We own this one! Hook it up. */
@@ -91,7 +124,8 @@ namespace MFM
       }
     }
 
-    m_needRecount = false;
+    m_needRecount = 0;
+    m_countRepairs = 0;
     m_threadInitialized = false;
     //    m_threadPaused = false;
   }
@@ -105,6 +139,7 @@ namespace MFM
     assert(IsPausedOrOwner());
 
     m_illegalAtomCount = 0;
+    ++m_atomChanges;
 
     for(u32 x = 0; x < TILE_WIDTH; x++)
     {
@@ -117,6 +152,19 @@ namespace MFM
     RecountAtoms();
   }
 
+  template <class CC>
+  void Tile<CC>::LoadAtomArray(const T* atoms)
+  {
+    assert(IsPausedOrOwner());
+
+    m_illegalAtomCount = 0;
+    ++m_atomChanges;
+
+    memcpy((void *) &m_atoms[0][0], atoms, sizeof(m_atoms));
+
+    RecountAtoms();
+  }
+
   /* Definitely not thread safe. Make sure to pause and join this Tile
      before calling this from the outside. */
   template <class CC>
@@ -169,8 +217,10 @@ namespace MFM
   template <class CC>
   void Tile<CC>::Connect(Tile<CC>& other, Dir toCache)
   {
+    m_neighborTiles[toCache] = &other;
     if(IS_OWNED_CONNECTION(toCache))
     {
+      m_connections[toCache]->SetArrivalSignals(&m_packetArrivals, &other.m_packetArrivals);
       m_connections[toCache]->SetConnected(true);
     }
     else
@@ -182,7 +232,7 @@ namespace MFM
   }
 
   template <class CC>
-  Connection* Tile<CC>::GetConnection(Dir cache)
+  Connection<typename CC::ATOM_TYPE>* Tile<CC>::GetConnection(Dir cache)
   {
     return m_connections[cache];
   }
@@ -222,6 +272,7 @@ namespace MFM
       FAIL(ARRAY_INDEX_OUT_OF_BOUNDS);
     }
     m_atoms[x][y] = atom;
+    SetAtomType(x, y);
   }
 
   template <class CC>
@@ -232,13 +283,12 @@ namespace MFM
     Packet<T> sendout(PACKET_EVENT_ACKNOWLEDGE, packet.GetGeneration());
     sendout.SetReceivingNeighbor(from);
 
-    m_connections[from]->Write(!IS_OWNED_CONNECTION(from),
-                               (u8*)&sendout,
-                               sizeof(Packet<T>));
+    m_connections[from]->Write(!IS_OWNED_CONNECTION(from), sendout);
   }
 
   template <class CC>
-  void Tile<CC>::ReceivePacket(Packet<T>& packet)
+  void Tile<CC>::ReceivePacket(Packet<T>& packet, const T* batchAtoms,
+                               const u8* batchSites)
   {
     //bool isObsolete = packet.IsObsolete(m_generation);
     bool isObsolete = packet.GetGeneration() != m_generation;
@@ -249,20 +299,27 @@ namespace MFM
 
     switch(packet.GetType())
     {
-    case PACKET_WRITE:
+    case PACKET_WRITE_BATCH:
       if (!isObsolete)
       {
-        if(packet.GetAtom().IsSane())
+        const SPoint center = packet.GetLocation();
+        const u32 count = packet.GetBatchCount();
+        SPoint loc;
+        for (u32 i = 0; i < count; ++i)
         {
-          PlaceAtom(packet.GetAtom(), packet.GetLocation());
-        }
-        else
-        {
-          LOG.Debug("%s received insane atom for (%d,%d), discarding",
-                    this->GetLabel(),
-                    packet.GetLocation().GetX(),
-                    packet.GetLocation().GetY());
-          PlaceAtom(Element_Empty<CC>::THE_INSTANCE.GetDefaultAtom(), packet.GetLocation());
+          MDist<R>::get().FillFromBits(loc, batchSites[i], R);
+          loc.Add(center);
+
+          if(batchAtoms[i].IsSane())
+          {
+            PlaceAtom(batchAtoms[i], loc);
+          }
+          else
+          {
+            LOG.Debug("%s received insane atom for (%d,%d), discarding",
+                      this->GetLabel(), loc.GetX(), loc.GetY());
+            PlaceAtom(Element_Empty<CC>::THE_INSTANCE.GetDefaultAtom(), loc);
+          }
         }
       }
       break;
@@ -286,13 +343,75 @@ namespace MFM
 
   template <class CC>
   void Tile<CC>::CreateRandomWindow()
+  {
+    SPoint pt;
+    ChooseRandomSite(pt);
+    m_executingWindow.SetCenterInTile(pt);
+  }
+
+  template <class CC>
+  void Tile<CC>::ChooseRandomSite(SPoint & center)
   {
     /* Make sure not to be created in the cache */
     int maxval = TILE_WIDTH - (EVENT_WINDOW_RADIUS << 1);
-    SPoint pt(GetRandom(), maxval, maxval);
-    pt.Add(EVENT_WINDOW_RADIUS, EVENT_WINDOW_RADIUS);
+    center = SPoint(GetRandom(), maxval, maxval);
+    center.Add(EVENT_WINDOW_RADIUS, EVENT_WINDOW_RADIUS);
+  }
 
-    m_executingWindow.SetCenterInTile(pt);
+  template <class CC>
+  bool Tile<CC>::ChooseEventCenter(SPoint & center)
+  {
+    if (!m_sparseEvents)
+    {
+      ChooseRandomSite(center);
+      return true;
+    }
+    return ChooseActiveSite(center);
+  }
+
+  template <class CC>
+  bool Tile<CC>::ChooseActiveSite(SPoint & center)
+  {
+    const u32 active = m_activeSiteCount;
+    if (active == 0)
+    {
+      ++m_eventsExecuted;  // As if CreateRandomWindow had hit empty
+      return false;
+    }
+
+    // Uniform picks take OWNED_SIDE^2/active tries, on average, to
+    // hit an active site; count the misses in whole events
+    m_skippedEventCredit += OWNED_SIDE * OWNED_SIDE - active;
+    const u32 skipped = m_skippedEventCredit / active;
+    m_skippedEventCredit -= skipped * active;
+    m_eventsExecuted += skipped;
+
+    const u32 site = m_activeSites[m_random.Create(active)];
+    center.Set(site / OWNED_SIDE + R, site % OWNED_SIDE + R);
+    return true;
+  }
+
+  template <class CC>
+  void Tile<CC>::UpdateActiveSite(u32 x, u32 y, u32 type)
+  {
+    const u32 site = x * OWNED_SIDE + y;
+    const u32 index = m_activeSiteIndices[site];
+    if (type != Element_Empty<CC>::THE_INSTANCE.GetType())
+    {
+      if (index == INACTIVE_SITE)
+      {
+        m_activeSiteIndices[site] = m_activeSiteCount;
+        m_activeSites[m_activeSiteCount++] = site;
+      }
+    }
+    else if (index != INACTIVE_SITE)
+    {
+      // Move the last active site into the hole
+      const u32 last = m_activeSites[--m_activeSiteCount];
+      m_activeSites[index] = last;
+      m_activeSiteIndices[last] = index;
+      m_activeSiteIndices[site] = INACTIVE_SITE;
+    }
   }
 
   template <class CC>
@@ -379,7 +498,8 @@ namespace MFM
     {
       InternalPutAtom(Element_Empty<CC>::THE_INSTANCE.GetDefaultAtom(),
                       pt.GetX(), pt.GetY());
-      RecountAtoms();
+      m_executingWindow.MarkSiteDirty(pt);
+      RequestRecount();
       LOG.Warning("Failure during PlaceAtom, erased (%2d,%2d) of %s",
                   pt.GetX(), pt.GetY(), this->GetLabel());
     },
@@ -404,6 +524,9 @@ namespace MFM
       bool owned = IsOwnedSite(pt);
       if (oldAtom != newAtom)
       {
+        m_executingWindow.MarkSiteDirty(pt);
+        ++m_atomChanges;
+
         if (owned)
         {
           const SPoint opt = pt - SPoint(R,R); // Really no routine to map into owned coords?
@@ -418,6 +541,9 @@ namespace MFM
           // atom with a newType atom
           IncrAtomCount(oldType, -1);
           IncrAtomCount(newType, 1);
+
+          const SPoint opt = pt - SPoint(R,R);
+          UpdateActiveSite(opt.GetX(), opt.GetY(), newType);
         }
 
         InternalPutAtom(newAtom,pt.GetX(),pt.GetY());
@@ -453,28 +579,58 @@ namespace MFM
   }
 
   template <class CC>
-  void Tile<CC>::SendAtom(Dir neighbor, SPoint& atomLoc)
+  void Tile<CC>::SendAtomBatch(Dir neighbor, const u8 * siteIndices, u32 count)
   {
-    if(IsConnected(neighbor))
+    if(IsConnected(neighbor) && count > 0)
     {
-      SPoint remoteLoc(GetNeighborLoc(neighbor,atomLoc));
-
-      Packet<T> sendout(PACKET_WRITE, m_generation);
+      const SPoint & ewCenter = m_executingWindow.GetCenterInTile();
+      SPoint atomLoc;
 
-      /* Did this atom get corrupted? Destroy it! */
-      if(!GetAtom(atomLoc)->IsSane())
+      if (m_directCacheUpdates)
       {
-        PlaceAtom(Element_Empty<CC>::THE_INSTANCE.GetDefaultAtom(), atomLoc);
+        /* No one else is running; just write into their cache */
+        Tile<CC> & other = *m_neighborTiles[neighbor];
+        for(u32 i = 0; i < count; ++i)
+        {
+          MDist<R>::get().FillFromBits(atomLoc, siteIndices[i], R);
+          atomLoc.Add(ewCenter);
+
+          if(!GetAtom(atomLoc)->IsSane())
+          {
+            PlaceAtom(Element_Empty<CC>::THE_INSTANCE.GetDefaultAtom(), atomLoc);
+          }
+          other.PlaceAtom(*GetAtom(atomLoc), GetNeighborLoc(neighbor, atomLoc));
+        }
+        return;
       }
 
-      sendout.SetLocation(remoteLoc);
-      sendout.SetAtom(*GetAtom(atomLoc));
-      sendout.SetReceivingNeighbor(neighbor);
+      Packet<T> header(PACKET_WRITE_BATCH, m_generation);
+      header.SetReceivingNeighbor(neighbor);
+      header.SetLocation(GetNeighborLoc(neighbor, ewCenter));
+      header.SetBatchCount(count);
+      memcpy(m_batchRecord, &header, sizeof(header));
+
+      /* The body: count Atoms, then their count site indices */
+      u8 * atoms = m_batchRecord + sizeof(header);
+      memcpy(atoms + count * sizeof(T), siteIndices, count);
+
+      for(u32 i = 0; i < count; ++i)
+      {
+        MDist<R>::get().FillFromBits(atomLoc, siteIndices[i], R);
+        atomLoc.Add(ewCenter);
+
+        /* Did this atom get corrupted? Destroy it! */
+        if(!GetAtom(atomLoc)->IsSane())
+        {
+          PlaceAtom(Element_Empty<CC>::THE_INSTANCE.GetDefaultAtom(), atomLoc);
+        }
+
+        memcpy(atoms + i * sizeof(T), GetAtom(atomLoc), sizeof(T));
+      }
 
-      /* Send out the serialized version of the packet */
+      /* Send out the whole record at once */
       m_connections[neighbor]->Write(!IS_OWNED_CONNECTION(neighbor),
-                                     (u8*)&sendout,
-                                     sizeof(Packet<T>));
+                                     m_batchRecord, header.GetRecordBytes());
     }
   }
 
@@ -530,8 +686,7 @@ namespace MFM
         sendout.SetReceivingNeighbor(dir);
 
         /* We don't care about what other kind of stuff is in the Packet */
-        m_connections[dir]->Write(!IS_OWNED_CONNECTION(dir),
-                                  (u8*)&sendout, sizeof(Packet<T>));
+        m_connections[dir]->Write(!IS_OWNED_CONNECTION(dir), sendout);
       }
 
       dir = Dirs::CWDir(dir);
@@ -549,6 +704,9 @@ namespace MFM
 
     u32 dirBitfield = 0;
 
+    u8 dirSites[Dirs::DIR_COUNT][EVENT_WINDOW_SITES(R)];
+    u32 dirSiteCounts[Dirs::DIR_COUNT] = { 0 };
+
     const s32 r2 = R * 2;
     ewCenter = m_executingWindow.GetCenterInTile();
 
@@ -557,57 +715,69 @@ namespace MFM
       MDist<R>::get().FillFromBits(localLoc, i, R);
       localLoc.Add(ewCenter);
 
-      /* Send to West neighbor? */
+      u32 siteDirs = 0;
+
+      /* Visible to West neighbor? */
       if(IsConnected(Dirs::WEST) && localLoc.GetX() < r2)
       {
-        SendAtom(Dirs::WEST, localLoc);
-        dirBitfield = Dirs::AddDirToMask(dirBitfield, Dirs::WEST);
+        siteDirs = Dirs::AddDirToMask(siteDirs, Dirs::WEST);
         if(IsConnected(Dirs::NORTH) && localLoc.GetY() < r2)
         {
-          SendAtom(Dirs::NORTHWEST, localLoc);
-          SendAtom(Dirs::NORTH, localLoc);
-          dirBitfield = Dirs::AddDirToMask(dirBitfield, Dirs::NORTHWEST);
-          dirBitfield = Dirs::AddDirToMask(dirBitfield, Dirs::NORTH);
+          siteDirs = Dirs::AddDirToMask(siteDirs, Dirs::NORTHWEST);
+          siteDirs = Dirs::AddDirToMask(siteDirs, Dirs::NORTH);
         }
         else if(IsConnected(Dirs::SOUTH) && localLoc.GetY() >= P::TILE_WIDTH - r2)
         {
-          SendAtom(Dirs::SOUTHWEST, localLoc);
-          SendAtom(Dirs::SOUTH, localLoc);
-          dirBitfield = Dirs::AddDirToMask(dirBitfield, Dirs::SOUTHWEST);
-          dirBitfield = Dirs::AddDirToMask(dirBitfield, Dirs::SOUTH);
+          siteDirs = Dirs::AddDirToMask(siteDirs, Dirs::SOUTHWEST);
+          siteDirs = Dirs::AddDirToMask(siteDirs, Dirs::SOUTH);
         }
       }
       /*East neighbor?*/
       else if(IsConnected(Dirs::EAST) && localLoc.GetX() >= P::TILE_WIDTH - r2)
       {
-        SendAtom(Dirs::EAST, localLoc);
-        dirBitfield = Dirs::AddDirToMask(dirBitfield, Dirs::EAST);
+        siteDirs = Dirs::AddDirToMask(siteDirs, Dirs::EAST);
         if(IsConnected(Dirs::NORTH) && localLoc.GetY() < r2)
         {
-          SendAtom(Dirs::NORTHEAST, localLoc);
-          SendAtom(Dirs::NORTH, localLoc);
-          dirBitfield = Dirs::AddDirToMask(dirBitfield, Dirs::NORTHEAST);
-          dirBitfield = Dirs::AddDirToMask(dirBitfield, Dirs::NORTH);
+          siteDirs = Dirs::AddDirToMask(siteDirs, Dirs::NORTHEAST);
+          siteDirs = Dirs::AddDirToMask(siteDirs, Dirs::NORTH);
         }
         if(IsConnected(Dirs::SOUTH) && localLoc.GetY() >= P::TILE_WIDTH - r2)
         {
-          SendAtom(Dirs::SOUTHEAST, localLoc);
-          SendAtom(Dirs::SOUTH, localLoc);
-          dirBitfield = Dirs::AddDirToMask(dirBitfield, Dirs::SOUTHEAST);
-          dirBitfield = Dirs::AddDirToMask(dirBitfield, Dirs::SOUTH);
+          siteDirs = Dirs::AddDirToMask(siteDirs, Dirs::SOUTHEAST);
+          siteDirs = Dirs::AddDirToMask(siteDirs, Dirs::SOUTH);
         }
       }
       else if(IsConnected(Dirs::NORTH) && localLoc.GetY() < r2)
       {
-        SendAtom(Dirs::NORTH, localLoc);
-        dirBitfield = Dirs::AddDirToMask(dirBitfield, Dirs::NORTH);
+        siteDirs = Dirs::AddDirToMask(siteDirs, Dirs::NORTH);
       }
       else if(IsConnected(Dirs::SOUTH) && localLoc.GetY() >= P::TILE_WIDTH - r2)
       {
-        SendAtom(Dirs::SOUTH, localLoc);
-        dirBitfield = Dirs::AddDirToMask(dirBitfield, Dirs::SOUTH);
+        siteDirs = Dirs::AddDirToMask(siteDirs, Dirs::SOUTH);
+      }
+
+      /* Everyone who can see the window must get an end-of-event
+         packet, but only changed sites need to travel */
+      dirBitfield |= siteDirs;
+
+      if(siteDirs && m_executingWindow.IsSiteDirty(i))
+      {
+        for(Dir dir = 0; dir < Dirs::DIR_COUNT; ++dir)
+        {
+          if(Dirs::TestDirInMask(siteDirs, dir))
+          {
+            dirSites[dir][dirSiteCounts[dir]++] = (u8) i;
+          }
+        }
       }
     }
+
+    /* One batch per neighbor that has anything to hear about */
+    for(Dir dir = 0; dir < Dirs::DIR_COUNT; ++dir)
+    {
+      SendAtomBatch(dir, dirSites[dir], dirSiteCounts[dir]);
+    }
+
     return dirBitfield;
   }
 
@@ -620,7 +790,7 @@ namespace MFM
     {
       return true;
     }
-    if (!m_connections[connectionDir]->Lock())
+    if (!m_connections[connectionDir]->Lock(!IS_OWNED_CONNECTION(connectionDir)))
     {
       return false;
     }
@@ -631,25 +801,26 @@ namespace MFM
   template <class CC>
   bool Tile<CC>::TryLockCorner(Dir cornerDir)
   {
-    u32 locked = 0;
+    const Dir dirs[3] = { Dirs::CCWDir(cornerDir), cornerDir, Dirs::CWDir(cornerDir) };
 
-    /* Go back one, then wind until we lock all three. */
-    cornerDir = Dirs::CCWDir(cornerDir);
+    /* Look at all three first, so a held lock costs no claims to undo */
     for(u32 i = 0; i < 3; i++)
     {
-      if(TryLock(cornerDir))
+      if(IsConnected(dirs[i]) && m_connections[dirs[i]]->IsLocked())
       {
-        locked++;
-        cornerDir = Dirs::CWDir(cornerDir);
+        return false;
       }
-      /* If we can't hit one, rewind, unlocking all held locks. */
-      else
+    }
+
+    for(u32 i = 0; i < 3; i++)
+    {
+      /* Lost a race for one; give back those we won. */
+      if(!TryLock(dirs[i]))
       {
-        for(u32 j = 0; j < locked; j++)
+        ++m_lockContention[cornerDir];
+        while(i > 0)
         {
-          cornerDir = Dirs::CCWDir(cornerDir);
-
-          UnlockDir(cornerDir);
+          UnlockDir(dirs[--i]);
         }
         return false;
       }
@@ -711,6 +882,10 @@ namespace MFM
     {
       ++m_lockAttemptsSucceeded;
     }
+    else
+    {
+      ++m_lockFailures[regionDir];
+    }
     const u32 MILLION = 1000000;
     if ((m_lockAttempts % (1*MILLION)) == 0)
     {
@@ -741,7 +916,7 @@ namespace MFM
     {
       assert(m_iLocked[dir]);
 
-      m_connections[dir]->Unlock();
+      m_connections[dir]->Unlock(!IS_OWNED_CONNECTION(dir));
 
       m_iLocked[dir] = false;
     }
@@ -823,17 +998,20 @@ namespace MFM
       if(IsConnected(dir))
       {
         u32 threadTag = (((u32) pthread_self())>>8)&0xffff;
-        if (m_connections[dir]->InputByteCount() != 0)
+        const u32 inputBytes = m_connections[dir]->InputByteCount();
+        if (inputBytes != 0)
         {
           LOG.Warning("NON-EMPTY INPUT BUFFER (%d bytes) IN %s%04x. Packets:",
-                      m_connections[dir]->InputByteCount(),
+                      inputBytes,
                       this->GetLabel(),
                       threadTag);
 
-          for(u32 i = 0; i + sizeof(Packet<T>) <= m_connections[dir]->InputByteCount(); i += sizeof(Packet<T>))
+          u32 i = 0;
+          for(u32 offset = 0; offset + sizeof(Packet<T>) <= inputBytes; ++i)
           {
             Packet<T> buffer((PacketType) 0xff, 0xff);  // Deliberately invalid initialization
-            m_connections[dir]->PeekRead(false, (u8*) &buffer, i, sizeof(Packet<T>));
+            m_connections[dir]->PeekRead(false, buffer, offset);
+            offset += buffer.GetRecordBytes();
 
             PacketSerializer<CC> serializer(buffer);
 
@@ -863,12 +1041,22 @@ namespace MFM
     m_isFnWing = true;  // Track where we are
 
     Packet<T> readPack(PACKET_WRITE, m_generation);
-    u32 readBytes;
     u32 locksStillHeld = 0;
     u32 loops = 0;
+    u64 waitStart = 0;
+    u64 blockNanos = 0;
+#ifdef MFM_BLOCKING_FLUSH
+    u32 spins = 0;
+#else
     s32 sleepTimer = m_random.Create(10000);
+#endif
     do
     {
+#ifdef MFM_BLOCKING_FLUSH
+      /* Take the key before looking, so no arrival can slip by */
+      const u32 arrivalKey = m_packetArrivals.PrepareWait();
+#endif
+
       locksStillHeld = 0; // Assume this
 
       /* Flush out all packet buffers */
@@ -877,18 +1065,15 @@ namespace MFM
         if(IsConnected(dir))
         {
 
-          if (m_iLocked[dir] || m_connections[dir]->IsLockedByAnother())
+          // (When externally scheduled, the other holder may be run by our own thread)
+          if (m_iLocked[dir] ||
+              (!m_externallyScheduled && m_connections[dir]->IsLocked()))
           {
             ++locksStillHeld;
           }
 
-          while((readBytes = m_connections[dir]->Read(!IS_OWNED_CONNECTION(dir),
-                                                      (u8*)&readPack, sizeof(Packet<T>))))
+          while(m_connections[dir]->Read(!IS_OWNED_CONNECTION(dir), readPack))
           {
-            if(readBytes != sizeof(Packet<T>))
-            {
-              FAIL(ILLEGAL_STATE);  /* Didn't read enough for a full packet! */
-            }
             if(dirWaitWord & (1 << dir))
             {
               if(readPack.GetType() == PACKET_EVENT_ACKNOWLEDGE)
@@ -901,13 +1086,28 @@ namespace MFM
                 FAIL(ILLEGAL_STATE);  /* Didn't get an acknowledgment right away */
               }
             }
-            ReceivePacket(readPack);
+
+            if(readPack.GetType() == PACKET_WRITE_BATCH)
+            {
+              /* The whole record was written at once, so it's all here */
+              const u32 count = readPack.GetBatchCount();
+              if (count > MAX_BATCH_SITES)
+              {
+                FAIL(ILLEGAL_STATE);
+              }
+              m_connections[dir]->ReadBody(!IS_OWNED_CONNECTION(dir),
+                                           (u8*) m_batchAtoms, count * sizeof(T));
+              m_connections[dir]->ReadBody(!IS_OWNED_CONNECTION(dir),
+                                           m_batchSites, count);
+            }
+            ReceivePacket(readPack, m_batchAtoms, m_batchSites);
           }
 
         }
         /* Have we waited long enough without a response? Let's disconnect that tile. */
 
       }
+
       if (++loops >= 100000000)
       {
         LOG.Error("Tile %s flush looped %d times, but dirWaitWord (0x%x) still not 0, and %d locks held",
@@ -915,19 +1115,75 @@ namespace MFM
         FAIL(LOCK_FAILURE);  // Not really, but it's a marker
       }
 
+      if (dirWaitWord && waitStart == 0)
+      {
+        waitStart = GetNanoseconds();
+        ++m_flushWaits;
+      }
+
+      if (m_externallyScheduled)
+      {
+        // Our neighbors have no threads of their own.  Answer for
+        // whoever we are still waiting on, and go look again.
+        for(Dir dir = Dirs::NORTH; dir < Dirs::DIR_COUNT; ++dir)
+        {
+          if(dirWaitWord & (1 << dir))
+          {
+            m_neighborTiles[dir]->FlushAndWaitOnAllBuffers(0);
+          }
+        }
+        continue;
+      }
+
+#ifdef MFM_BLOCKING_FLUSH
+      if (!dirWaitWord || spins++ < m_flushSpinLimit)
+      {
+        pthread_yield();
+      }
+      else
+      {
+        // Spun long enough; sleep until a neighbor writes to us
+        const u64 blockStart = GetNanoseconds();
+        m_packetArrivals.Wait(arrivalKey, FLUSH_BLOCK_TIMEOUT_MICROS);
+        blockNanos += GetNanoseconds() - blockStart;
+        ++m_flushBlocks;
+      }
+#else
       if (--sleepTimer < 0)
       {
         // Try sleeping every once in a while
+        const u64 blockStart = GetNanoseconds();
         Sleep(0, loops);
+        blockNanos += GetNanoseconds() - blockStart;
+        ++m_flushBlocks;
         sleepTimer = m_random.Create(250);
       }
       else
       {
         pthread_yield();
       }
+#endif
 
     } while(dirWaitWord);
 
+    if (waitStart != 0)
+    {
+      m_flushBlockNanos += blockNanos;
+      m_flushSpinNanos += GetNanoseconds() - waitStart - blockNanos;
+
+#ifdef MFM_BLOCKING_FLUSH
+      // Spin longer next time if spinning paid off, shorter if not
+      if (blockNanos == 0)
+      {
+        m_flushSpinLimit = MIN(FLUSH_SPIN_MAX, m_flushSpinLimit + m_flushSpinLimit / 8 + 1);
+      }
+      else
+      {
+        m_flushSpinLimit = MAX(FLUSH_SPIN_MIN, m_flushSpinLimit / 2);
+      }
+#endif
+    }
+
     m_isFnWing = false;
 
     return locksStillHeld > 0;
@@ -937,6 +1193,7 @@ namespace MFM
   void Tile<CC>::DoEvent(bool locked, Dir lockRegion)
   {
     u32 dirWaitWord = 0;
+    m_executingWindow.ClearDirtySites();
     unwind_protect(
       {
         ++m_eventsFailed;
@@ -958,6 +1215,9 @@ namespace MFM
 
 
         m_executingWindow.SetCenterAtom(Element_Empty<CC>::THE_INSTANCE.GetDefaultAtom());
+
+        // Keep whatever the failed behavior wrote, as if unbuffered
+        m_executingWindow.Scatter();
       },
       {
         elementTable.Execute(m_executingWindow);
@@ -967,11 +1227,18 @@ namespace MFM
 
     m_lastExecutedAtom = m_executingWindow.GetCenterInTile();
 
-    dirWaitWord = SendRelevantAtoms();
+    // No neighbor can see anything a hidden event touched
+    if (!IsInHidden(m_executingWindow.GetCenterInTile()))
+    {
+      dirWaitWord = SendRelevantAtoms();
 
-    SendEndEventPackets(dirWaitWord);
+      if (!m_directCacheUpdates)
+      {
+        SendEndEventPackets(dirWaitWord);
 
-    FlushAndWaitOnAllBuffers(dirWaitWord);
+        FlushAndWaitOnAllBuffers(dirWaitWord);
+      }
+    }
 
 
     ++m_eventsExecuted;
@@ -982,8 +1249,6 @@ namespace MFM
 
     if(locked)
     {
-      UnlockRegion(lockRegion);
-
       switch(lockRegion)
       {
       case Dirs::NORTH: case Dirs::SOUTH:
@@ -1022,32 +1287,14 @@ namespace MFM
         break;
 
       case THREADSTATE_RUNNING:
+        if (IsSnapshotRequested())
+        {
+          PublishSnapshot();
+        }
         if (m_executeOwnEvents)
         {
           // It's showtime!
-          bool locked = false;
-          Dir lockRegion = Dirs::NORTH;
-          /*
-          UsageTimer execTimer = UsageTimer::NowThread();
-          */
-
-          CreateRandomWindow();
-
-          if (IsInHidden(m_executingWindow.GetCenterInTile()) ||
-               !HasAnyConnections(lockRegion = VisibleAt(m_executingWindow.GetCenterInTile())) ||
-               (locked = LockRegion(lockRegion)))
-          {
-            DoEvent(locked, lockRegion);
-          }
-
-          /*
-          u32 ms = (UsageTimer::NowThread() - execTimer).TotalMicroseconds();
-          if(ms > 1)
-          {
-            LOG.Debug("Atom (type 0x%x) took longer 1 ms to execute: %d ms",
-                      m_executingWindow.GetCenterAtom().GetType(), ms);
-          }
-          */
+          ExecuteOwnEvents(m_eventBatchSize);
         }
         else
         {
@@ -1082,11 +1329,200 @@ namespace MFM
     }
   }
 
+  template <class CC>
+  void Tile<CC>::ExecuteOwnEvents(u32 count)
+  {
+    if (count > MAX_EVENT_BATCH)
+    {
+      FAIL(ILLEGAL_ARGUMENT);
+    }
+
+    // Choose every center first, noting the region each must lock,
+    // or NO_LOCK
+    const u32 NO_LOCK = Dirs::DIR_COUNT;
+    SPoint centers[MAX_EVENT_BATCH];
+    u8 regions[MAX_EVENT_BATCH];
+    u32 regionCounts[NO_LOCK + 1] = { 0 };
+    u32 chosen = 0;
+    bool sawNothing = false;
+
+    for (u32 i = 0; i < count; ++i)
+    {
+      SPoint & center = centers[chosen];
+      if (!ChooseEventCenter(center))
+      {
+        sawNothing = true;
+        continue;
+      }
+
+      Dir lockRegion = Dirs::NORTH;
+      const bool unlocked =
+        m_directCacheUpdates ||    // No one else to lock out
+        IsInHidden(center) ||
+        !HasAnyConnections(lockRegion = VisibleAt(center));
+
+      regions[chosen] = unlocked ? NO_LOCK : lockRegion;
+      ++regionCounts[regions[chosen]];
+      ++chosen;
+    }
+
+    // Order them unlocked first, then by lock region
+    u8 order[MAX_EVENT_BATCH];
+    u32 starts[NO_LOCK + 1];
+    starts[NO_LOCK] = 0;
+    u32 next = regionCounts[NO_LOCK];
+    for (u32 r = 0; r < NO_LOCK; ++r)
+    {
+      starts[r] = next;
+      next += regionCounts[r];
+    }
+    for (u32 i = 0; i < chosen; ++i)
+    {
+      order[starts[regions[i]]++] = i;
+    }
+
+    u32 held = NO_LOCK;
+    bool needFlush = sawNothing;
+    for (u32 i = 0; i < chosen; ++i)
+    {
+      const u32 e = order[i];
+      const u32 region = regions[e];
+      m_executingWindow.SetCenterInTile(centers[e]);
+
+      if (region == NO_LOCK)
+      {
+        needFlush = needFlush || IsInHidden(centers[e]);
+        DoEvent(false, Dirs::NORTH);
+        continue;
+      }
+
+      if (needFlush)
+      {
+        FlushAndWaitOnAllBuffers(0);  // Catch up after the hidden run
+        needFlush = false;
+      }
+
+      if (held != region)
+      {
+        if (held != NO_LOCK)
+        {
+          UnlockRegion((Dir) held);
+          held = NO_LOCK;
+        }
+        if (!LockRegion((Dir) region))
+        {
+          continue;
+        }
+        held = region;
+      }
+
+      DoEvent(true, (Dir) region);
+    }
+
+    if (held != NO_LOCK)
+    {
+      UnlockRegion((Dir) held);
+    }
+
+    if (needFlush && !m_directCacheUpdates)
+    {
+      FlushAndWaitOnAllBuffers(0);  // Serve our neighbors
+    }
+  }
+
+  template <class CC>
+  void Tile<CC>::ExecuteEvents(u32 count)
+  {
+    if (!m_externallyScheduled)
+    {
+      FAIL(ILLEGAL_STATE);
+    }
+
+    RecountAtomsIfNeeded();
+
+    if (IsSnapshotRequested())
+    {
+      PublishSnapshot();
+    }
+
+    if (!m_executeOwnEvents)
+    {
+      return;
+    }
+
+    while (count > 0)
+    {
+      const u32 batch = MIN(count, m_eventBatchSize);
+      ExecuteOwnEvents(batch);
+      count -= batch;
+    }
+  }
+
+  template <class CC>
+  void Tile<CC>::StartPublishingSnapshots()
+  {
+    if (!m_snapshots)
+    {
+      m_snapshots = new Snapshot[2];
+    }
+    PublishSnapshot();
+  }
+
+  template <class CC>
+  void Tile<CC>::PublishSnapshot()
+  {
+    if (!m_snapshots)
+    {
+      FAIL(ILLEGAL_STATE);
+    }
+
+    const u32 next = 1 - m_publishedSnapshot;
+    Snapshot & snap = m_snapshots[next];
+
+    memcpy((void*) &snap.m_atoms[0][0], &m_atoms[0][0], sizeof(m_atoms));
+    memcpy(snap.m_atomCount, m_atomCount, sizeof(m_atomCount));
+
+    for (u32 x = 0; x < OWNED_SIDE; ++x)
+    {
+      for (u32 y = 0; y < OWNED_SIDE; ++y)
+      {
+        snap.m_writeAges[x][y] = (u32) (m_eventsExecuted - m_lastChangedEventNumber[x][y]);
+      }
+    }
+
+    snap.m_eventsExecuted = m_eventsExecuted;
+    snap.m_lastExecutedAtom = m_lastExecutedAtom;
+    snap.m_executingOwnEvents = m_executeOwnEvents;
+
+    __atomic_store_n(&m_publishedSnapshot, next, __ATOMIC_RELEASE);
+    __atomic_store_n(&m_snapshotRequested, 0, __ATOMIC_RELEASE);
+  }
+
+  template <class CC>
+  u32 Tile<CC>::GetSnapshotAtomCount(ElementType atomType) const
+  {
+    s32 idx = elementTable.GetIndex(atomType);
+    if (idx < 0)
+    {
+      return 0;
+    }
+    return GetSnapshot().m_atomCount[idx];
+  }
+
   template <class CC>
   void* Tile<CC>::ExecuteThreadHelper(void* arg)
   {
     Tile* tilePtr = (Tile*) arg;
     MFMPtrToErrEnvStackPtr = &(tilePtr->m_errorEnvironmentStackTop);
+
+    if (tilePtr->m_pinnedCPU >= 0)
+    {
+      if (!CoreAffinity::PinCurrentThread(tilePtr->m_pinnedCPU))
+      {
+        LOG.Warning("Tile %s could not be pinned to CPU %d",
+                    tilePtr->GetLabel(), tilePtr->m_pinnedCPU);
+      }
+    }
     tilePtr->Execute();
     return NULL;
   }
@@ -1120,11 +1556,16 @@ namespace MFM
   template <class CC>
   void Tile<CC>::Start()
   {
+    if (m_externallyScheduled)
+    {
+      FAIL(ILLEGAL_STATE);  // Someone else runs our events
+    }
+
     if(!m_threadInitialized)
     {
-      // Possible xrays before start means we can't assert even here
-      //      AssertValidAtomCounts();
-      RecountAtoms();
+      // Possible xrays before start means we can't assert even here,
+      // so check the counts, but on our own thread
+      RequestRecount();
       m_threadInitialized = true;
       if (pthread_create(&m_thread, NULL, ExecuteThreadHelper, this))
         FAIL(ILLEGAL_STATE);
@@ -1171,7 +1612,7 @@ namespace MFM
     {
       LOG.Warning("LOST ATOMS %x %d %d (Tile %s) - requesting recount",
                   (int) atomType,delta,m_atomCount[idx],this->GetLabel());
-      m_needRecount = true;
+      RequestRecount();
       return;
     }
 
@@ -1193,6 +1634,7 @@ namespace MFM
     LOG.Log(level,"  ==Tile %s Global==", m_label.GetZString());
     LOG.Log(level,"   Address: %p", (void*) this);
     LOG.Log(level,"   Thread id: %p", (void*) m_thread);
+    LOG.Log(level,"   Pinned CPU: %d", m_pinnedCPU);
     LOG.Log(level,"   Error stack top: %p", (void*) m_errorEnvironmentStackTop);
     LOG.Log(level,"   Background radiation: %s", m_backgroundRadiationEnabled?"true":"false");
 
@@ -1206,6 +1648,7 @@ namespace MFM
 
     LOG.Log(level,"  ==Tile %s Atomic==", m_label.GetZString());
     LOG.Log(level,"   Recount needed: %s", m_needRecount?"true":"false");
+    LOG.Log(level,"   Count repairs: %d", m_countRepairs);
     LOG.Log(level,"   Illegal atom count: %d", m_illegalAtomCount);
     LOG.Log(level,"   Last executed atom at: (%d, %d)", m_lastExecutedAtom.GetX(), m_lastExecutedAtom.GetY());
 
@@ -1226,8 +1669,17 @@ namespace MFM
       }
       LOG.Log(level,"   Events: %dM (%s)", (u32) (m_regionEvents[r] / ONE_MILLION), lab);
     }
+    LOG.Log(level,"   Flush waits: %d (spin limit %d)", (u32) m_flushWaits, m_flushSpinLimit);
+    LOG.Log(level,"    Flush blocks: %d", (u32) m_flushBlocks);
+    LOG.Log(level,"    Flush ms spinning: %d", (u32) (m_flushSpinNanos / ONE_MILLION));
+    LOG.Log(level,"    Flush ms blocked: %d", (u32) (m_flushBlockNanos / ONE_MILLION));
     LOG.Log(level,"   Event locks attempted: %dM", (u32) (m_lockAttempts / ONE_MILLION));
     LOG.Log(level,"   Event locks succeeded: %dM", (u32) (m_lockAttemptsSucceeded / ONE_MILLION));
+    for (u32 r = 0; r < Dirs::DIR_COUNT; ++r)
+    {
+      LOG.Log(level,"    %s locks failed: %d (lost races %d)", Dirs::GetName(r),
+              (u32) m_lockFailures[r], (u32) m_lockContention[r]);
+    }
 
     for (u32 r = 0; r < LOCKTYPE_COUNT; ++r)
     {
@@ -1253,7 +1705,7 @@ namespace MFM
     for (u32 r = 0; r < Dirs::DIR_COUNT; ++r)
     {
       const char * lab = Dirs::GetName(r);
-      Connection * c = m_connections[r];
+      Connection<T> * c = m_connections[r];
       if (!c)
       {
         LOG.Log(level,"   %s: No connection", lab);
@@ -1308,11 +1760,21 @@ namespace MFM
   template <class CC>
   void Tile<CC>::RecountAtomsIfNeeded()
   {
-    if (m_needRecount)
+    // Cleared first, so a request arriving mid-recount isn't lost
+    if (!__atomic_exchange_n(&m_needRecount, 0, __ATOMIC_ACQ_REL))
+    {
+      return;
+    }
+
+    s32 counted[ELEMENT_TABLE_SIZE];
+    memcpy(counted, m_atomCount, sizeof(m_atomCount));
+
+    RecountAtoms();
+
+    if (memcmp(counted, m_atomCount, sizeof(m_atomCount)))
     {
-      LOG.Message("Recounting atoms (Tile %s)", this->GetLabel());
-      RecountAtoms();
-      m_needRecount = false;
+      ++m_countRepairs;
+      LOG.Warning("Repaired atom counts (Tile %s)", this->GetLabel());
     }
   }
 
@@ -1327,10 +1789,19 @@ namespace MFM
     // Not clear that anybody cares about this, but
     m_illegalAtomCount = 0;
 
+    m_activeSiteCount = 0;
+    for(u32 i = 0; i < OWNED_SIDE * OWNED_SIDE; i++)
+    {
+      m_activeSiteIndices[i] = INACTIVE_SITE;
+    }
+
     for(u32 x = 0; x < TILE_WIDTH; x++)
     {
       for(u32 y = 0; y < TILE_WIDTH; y++)
       {
+        // Writable Atoms may have left the plane behind
+        SetAtomType(x, y);
+
         const SPoint pt(x,y);
 
         if (IsInCache(pt))
@@ -1338,7 +1809,9 @@ namespace MFM
           continue;
         }
 
-        IncrAtomCount(m_atoms[x][y].GetType(), 1);
+        const u32 type = m_atoms[x][y].GetType();
+        IncrAtomCount(type, 1);
+        UpdateActiveSite(x - R, y - R, type);
       }
     }
   }
@@ -1353,6 +1826,12 @@ namespace MFM
   void Tile<CC>::SingleXRay(u32 x, u32 y)
   {
     m_atoms[x][y].XRay(m_random, BACKGROUND_RADIATION_BIT_ODDS);
+    SetAtomType(x, y);
+    if (IsOwnedSite(SPoint(x, y)))
+    {
+      // Damage must stay findable by sparse events
+      UpdateActiveSite(x - R, y - R, GetAtomType(x, y));
+    }
   }
 
   template <class CC>
@@ -1365,6 +1844,11 @@ namespace MFM
         if(m_random.OneIn(siteOdds))
         {
           m_atoms[x][y].XRay(m_random, bitOdds);
+          SetAtomType(x, y);
+          if (IsOwnedSite(SPoint(x, y)))
+          {
+            UpdateActiveSite(x - R, y - R, GetAtomType(x, y));
+          }
         }
       }
     }
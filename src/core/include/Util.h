@@ -35,6 +35,12 @@ namespace MFM {
 
 #define MARK_USED(X) ((void)(&(X)))
 
+  /**
+   * The assumed size of a cache line, for padding structures that
+   * are written by different threads onto separate lines.
+   */
+#define CACHE_LINE_BYTES 64
+
   template <const bool mustBeTrue>
   inline void COMPILATION_REQUIREMENT()
   {
@@ -322,6 +328,15 @@ namespace MFM {
    */
   extern void Sleep(u32 seconds, u64 nanos) ;
 
+  /**
+   * Reads a monotonic clock, for measuring short intervals.  The
+   * zero point is arbitrary, so only differences between readings
+   * are meaningful.
+   *
+   * @returns The current monotonic clock reading, in nanoseconds.
+   */
+  extern u64 GetNanoseconds() ;
+
 }
 
 #endif /* UTIL_H */
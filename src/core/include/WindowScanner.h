@@ -35,6 +35,10 @@ namespace MFM
   /**
    * A wrapper for the EventWindow class which allows for EventWindow
    * searching and other powerful EventWindow modifications.
+   *
+   * Searches work on the bit masks of EventWindow::GetTypeSiteMask,
+   * one bit per site: counting is a popcount, and a random match is
+   * picked with a single random draw rather than one per match.
    */
   template <class CC>
   class WindowScanner
@@ -549,6 +553,31 @@ namespace MFM
    private:
 
     void FindRandomAtoms(const u32 radius, const u32 count, va_list& list) const;
+
+    /**
+     * Gets a site mask of the held EventWindow from distance 1 out to
+     * \c radius, FAILing with ILLEGAL_ARGUMENT if \c radius is 0 or
+     * greater than R.
+     */
+    u64 GetRadiusMask(const u32 radius) const;
+
+    u64 GetNeighborhoodMask(const Dir* neighborhood, const u32 dirCount) const;
+
+    u64 GetSubWindowMask(const SPoint* subWindow, const u32 subCount) const;
+
+    static u32 CountSites(u64 mask)
+    {
+      return (u32) __builtin_popcountll(mask);
+    }
+
+    /**
+     * Fills \c outPoint with the location of a site of \c mask,
+     * chosen uniformly at random.
+     *
+     * @returns The number of sites in \c mask ; if \c 0 , \c
+     *          outPoint is untouched.
+     */
+    u32 PickRandomSite(u64 mask, SPoint& outPoint) const;
   };
 
   const Dir MooreNeighborhood[8] =
@@ -52,7 +52,7 @@ namespace MFM
   }
 
   template <class CC>
-  bool WindowScanner<CC>::CanSeeAtomOfType(const u32 type, const u32 radius) const
+  u64 WindowScanner<CC>::GetRadiusMask(const u32 radius) const
   {
     const MDist<R>& md = MDist<R>::get();
 
@@ -61,41 +61,73 @@ namespace MFM
       FAIL(ILLEGAL_ARGUMENT);
     }
 
-    for(u32 i = md.GetFirstIndex(1); i <= md.GetLastIndex(radius); i++)
-    {
-      if(m_win.IsLiveSite(md.GetPoint(i)))
-      {
-        if(m_win.GetRelativeAtom(md.GetPoint(i)).GetType() == type)
-        {
-          return true;
-        }
-      }
-    }
-    return false;
+    // Indices run outward, so this is one contiguous range of bits
+    const u64 inside = (((u64) 2) << md.GetLastIndex(radius)) - 1;
+    return inside & ~((((u64) 1) << md.GetFirstIndex(1)) - 1);
   }
 
   template <class CC>
-  u32 WindowScanner<CC>::CountAtomsOfType(const u32 type, const u32 radius) const
+  u64 WindowScanner<CC>::GetNeighborhoodMask(const Dir* neighborhood,
+                                             const u32 dirCount) const
   {
     const MDist<R>& md = MDist<R>::get();
-    u32 atomCount = 0;
-
-    if(radius == 0 || radius > R)
+    SPoint searchPt;
+    u64 mask = 0;
+    for(u32 i = 0; i < dirCount; i++)
     {
-      FAIL(ILLEGAL_ARGUMENT);
+      Dirs::FillDir(searchPt, neighborhood[i]);
+      mask |= ((u64) 1) << md.FromPoint(searchPt, R);
     }
+    return mask;
+  }
 
-    for(u32 i = md.GetFirstIndex(1); i <= md.GetLastIndex(radius); i++)
+  template <class CC>
+  u64 WindowScanner<CC>::GetSubWindowMask(const SPoint* subWindow,
+                                          const u32 subCount) const
+  {
+    const MDist<R>& md = MDist<R>::get();
+    u64 mask = 0;
+    for(u32 i = 0; i < subCount; i++)
     {
-      if(m_win.IsLiveSite(md.GetPoint(i)))
+      s32 idx = md.FromPoint(subWindow[i], R);
+      if(idx < 0)
       {
-        if(m_win.GetRelativeAtom(md.GetPoint(i)).GetType() == type)
+        if(m_win.IsLiveSite(subWindow[i]))
         {
-          atomCount++;
+          FAIL(ILLEGAL_ARGUMENT);  // As GetRelativeAtom would
         }
+        continue;
+      }
+      mask |= ((u64) 1) << idx;
+    }
+    return mask;
+  }
+
+  template <class CC>
+  u32 WindowScanner<CC>::PickRandomSite(u64 mask, SPoint& outPoint) const
+  {
+    const u32 count = CountSites(mask);
+    if(count > 0)
+    {
+      for(u32 skip = m_rand.Create(count); skip > 0; --skip)
+      {
+        mask &= mask - 1;  // Drop the lowest site
       }
+      outPoint.Set(MDist<R>::get().GetPoint((u32) __builtin_ctzll(mask)));
     }
-    return atomCount;
+    return count;
+  }
+
+  template <class CC>
+  bool WindowScanner<CC>::CanSeeAtomOfType(const u32 type, const u32 radius) const
+  {
+    return (m_win.GetTypeSiteMask(type) & GetRadiusMask(radius)) != 0;
+  }
+
+  template <class CC>
+  u32 WindowScanner<CC>::CountAtomsOfType(const u32 type, const u32 radius) const
+  {
+    return CountSites(m_win.GetTypeSiteMask(type) & GetRadiusMask(radius));
   }
 
   template <class CC>
@@ -109,19 +141,8 @@ namespace MFM
                                                   const Dir* neighborhood,
                                                   const u32 dirCount) const
   {
-    SPoint searchPt;
-    for(u32 i = 0; i < dirCount; i++)
-    {
-      Dirs::FillDir(searchPt, neighborhood[i]);
-      if(m_win.IsLiveSite(searchPt))
-      {
-        if(m_win.GetRelativeAtom(searchPt).GetType() == type)
-        {
-          return true;
-        }
-      }
-    }
-    return false;
+    return (m_win.GetTypeSiteMask(type) &
+            GetNeighborhoodMask(neighborhood, dirCount)) != 0;
   }
 
   template <class CC>
@@ -145,21 +166,8 @@ namespace MFM
                                            const Dir* neighborhood,
                                            const u32 dirCount) const
   {
-    SPoint searchPt;
-    u32 atomCount = 0;
-    for(u32 i = 0; i < dirCount; i++)
-    {
-      Dirs::FillDir(searchPt, neighborhood[i]);
-
-      if(m_win.IsLiveSite(searchPt))
-      {
-        if(m_win.GetRelativeAtom(searchPt).GetType() == type)
-        {
-          atomCount++;
-        }
-      }
-    }
-    return atomCount;
+    return CountSites(m_win.GetTypeSiteMask(type) &
+                      GetNeighborhoodMask(neighborhood, dirCount));
   }
 
   template <class CC>
@@ -189,51 +197,15 @@ namespace MFM
                                                   const u32 radius,
                                                   SPoint& outPoint) const
   {
-    const MDist<R>& md = MDist<R>::get();
-    u32 foundPts = 0;
-
-    if(radius == 0 || radius > R)
-    {
-      FAIL(ILLEGAL_ARGUMENT);
-    }
-
-    for(u32 i = md.GetFirstIndex(1); i <= md.GetLastIndex(radius); i++)
-    {
-      if(m_win.IsLiveSite(md.GetPoint(i)))
-      {
-        if(m_win.GetRelativeAtom(md.GetPoint(i)).GetType() == type)
-        {
-          foundPts++;
-          if(m_rand.OneIn(foundPts))
-          {
-            outPoint.Set(md.GetPoint(i));
-          }
-        }
-      }
-    }
-  return foundPts;
+    return PickRandomSite(m_win.GetTypeSiteMask(type) & GetRadiusMask(radius), outPoint);
   }
 
   template <class CC>
   u32 WindowScanner<CC>::FindRandomInSubWindow(const u32 type, const SPoint* subWindow,
                                                const u32 subCount, SPoint& outPoint) const
   {
-    u32 atomCount = 0;
-    for(u32 i = 0; i < subCount; i++)
-    {
-      if(m_win.IsLiveSite(subWindow[i]))
-      {
-        if(m_win.GetRelativeAtom(subWindow[i]).GetType() == type)
-        {
-          atomCount++;
-          if(m_rand.OneIn(atomCount))
-          {
-            outPoint.Set(subWindow[i].GetX(), subWindow[i].GetY());
-          }
-        }
-      }
-    }
-    return atomCount;
+    return PickRandomSite(m_win.GetTypeSiteMask(type) &
+                          GetSubWindowMask(subWindow, subCount), outPoint);
   }
 
   template <class CC>
@@ -249,25 +221,8 @@ namespace MFM
                                                   const u32 dirCount,
                                                   SPoint& outPoint) const
   {
-    SPoint searchPt;
-    u32 ptsFound = 0;
-    for(u32 i = 0; i < dirCount; i++)
-    {
-      Dirs::FillDir(searchPt, dirs[i]);
-
-      if(m_win.IsLiveSite(searchPt))
-      {
-        if(m_win.GetRelativeAtom(searchPt).GetType() == type)
-        {
-          ptsFound++;
-          if(m_rand.OneIn(ptsFound))
-          {
-            Dirs::FillDir(outPoint, dirs[i]);
-          }
-        }
-      }
-    }
-    return ptsFound;
+    return PickRandomSite(m_win.GetTypeSiteMask(type) &
+                          GetNeighborhoodMask(dirs, dirCount), outPoint);
   }
 
   template <class CC>
@@ -371,8 +326,6 @@ namespace MFM
       FAIL(ILLEGAL_ARGUMENT);
     }
 
-    const MDist<R>& md = MDist<R>::get();
-    Random& rand = m_win.GetRandom();
     SPoint* outPts[SITES];
     u32 types[SITES];
     u32* outCounts[SITES];
@@ -382,27 +335,13 @@ namespace MFM
       outPts[i] = (SPoint*)va_arg(list, SPoint*);
       types[i] = (u32)va_arg(list, u32);
       outCounts[i] = (u32*)va_arg(list, u32*);
-
-      *outCounts[i] = 0;
     }
 
-    for(u32 i = md.GetFirstIndex(1); i <= md.GetLastIndex(radius); i++)
+    const u64 radiusMask = GetRadiusMask(radius);
+    for(u32 j = 0; j < count; j++)
     {
-      SPoint pt = md.GetPoint(i);
-      if(m_win.IsLiveSite(pt))
-      {
-        for(u32 j = 0; j < count; j++)
-        {
-          if(m_win.GetRelativeAtom(pt).GetType() == types[j])
-          {
-            (*(outCounts[j]))++;
-            if(rand.OneIn(*(outCounts[j])))
-            {
-              outPts[j]->Set(pt.GetX(), pt.GetY());
-            }
-          }
-        }
-      }
+      *outCounts[j] = PickRandomSite(m_win.GetTypeSiteMask(types[j]) & radiusMask,
+                                     *outPts[j]);
     }
   }
 }
@@ -0,0 +1,86 @@
+#include "CoreAffinity.h"
+
+#ifdef __linux__
+#include <pthread.h>   /* For pthread_setaffinity_np */
+#include <sched.h>     /* For sched_getaffinity, cpu_set_t */
+#include <stdio.h>     /* For fopen, fscanf */
+#endif
+
+namespace MFM
+{
+#ifdef __linux__
+  static s32 SocketOfCPU(u32 cpu)
+  {
+    char path[100];
+    snprintf(path, sizeof(path),
+             "/sys/devices/system/cpu/cpu%u/topology/physical_package_id", cpu);
+    FILE * fp = fopen(path, "r");
+    if (!fp)
+    {
+      return 0;  // Unknown; pretend there's just one socket
+    }
+    s32 socket = 0;
+    if (fscanf(fp, "%d", &socket) != 1)
+    {
+      socket = 0;
+    }
+    fclose(fp);
+    return socket;
+  }
+#endif
+
+  u32 CoreAffinity::GetCPUsBySocket(u32 * cpus, u32 maxCpus)
+  {
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed))
+    {
+      return 0;
+    }
+
+    s32 sockets[MAX_CPUS];
+    u32 count = 0;
+    for (u32 cpu = 0; cpu < CPU_SETSIZE && count < maxCpus && count < MAX_CPUS; ++cpu)
+    {
+      if (!CPU_ISSET(cpu, &allowed))
+      {
+        continue;
+      }
+
+      // Insertion sort by socket; CPU numbers arrive in order already
+      const s32 socket = SocketOfCPU(cpu);
+      u32 i = count++;
+      while (i > 0 && sockets[i - 1] > socket)
+      {
+        sockets[i] = sockets[i - 1];
+        cpus[i] = cpus[i - 1];
+        --i;
+      }
+      sockets[i] = socket;
+      cpus[i] = cpu;
+    }
+    return count;
+#else
+    return 0;
+#endif
+  }
+
+  u32 CoreAffinity::IndexForGridLocation(u32 x, u32 y, u32 width, u32 height, u32 cpuCount)
+  {
+    const u32 step = x * height + ((x & 1) ? height - 1 - y : y);
+    return (u32) ((u64) step * cpuCount / (width * height));
+  }
+
+  bool CoreAffinity::PinCurrentThread(u32 cpu)
+  {
+#ifdef __linux__
+    cpu_set_t only;
+    CPU_ZERO(&only);
+    CPU_SET(cpu, &only);
+    return pthread_setaffinity_np(pthread_self(), sizeof(only), &only) == 0;
+#else
+    return false;
+#endif
+  }
+}
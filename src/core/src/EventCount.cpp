@@ -0,0 +1,49 @@
+#include "EventCount.h"
+#include "Util.h"    /* For Sleep */
+
+#ifdef __linux__
+#include <unistd.h>        /* For syscall */
+#include <sys/syscall.h>   /* For SYS_futex */
+#include <linux/futex.h>   /* For FUTEX_WAIT_PRIVATE etc */
+#include <time.h>          /* For struct timespec */
+#include <limits.h>        /* For INT_MAX */
+#endif
+
+namespace MFM
+{
+  void EventCount::Wait(u32 key, u32 timeoutMicros)
+  {
+    __atomic_add_fetch(&m_waiters, 1, __ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n(&m_sequence, __ATOMIC_SEQ_CST) == key)
+    {
+#ifdef __linux__
+      struct timespec tspec;
+      tspec.tv_sec = timeoutMicros / 1000000;
+      tspec.tv_nsec = (timeoutMicros % 1000000) * 1000;
+
+      /* Returns at once if m_sequence no longer equals key */
+      syscall(SYS_futex, &m_sequence, FUTEX_WAIT_PRIVATE, key, &tspec, NULL, 0);
+#else
+      Sleep(timeoutMicros / 1000000, (u64) (timeoutMicros % 1000000) * 1000);
+#endif
+    }
+
+    __atomic_sub_fetch(&m_waiters, 1, __ATOMIC_SEQ_CST);
+  }
+
+  void EventCount::Notify()
+  {
+    __atomic_add_fetch(&m_sequence, 1, __ATOMIC_SEQ_CST);
+
+    /* Our increment and a waiter's are both sequentially consistent,
+       so either we see its registration here or it sees our new
+       sequence before it sleeps. */
+    if (__atomic_load_n(&m_waiters, __ATOMIC_SEQ_CST) != 0)
+    {
+#ifdef __linux__
+      syscall(SYS_futex, &m_sequence, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#endif
+    }
+  }
+}
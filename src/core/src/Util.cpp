@@ -1,5 +1,5 @@
 #include "Util.h"
-#include <time.h>  /* For nanosleep */
+#include <time.h>  /* For nanosleep, clock_gettime */
 
 namespace MFM
 {
@@ -43,4 +43,12 @@ namespace MFM
 
     nanosleep(&tspec, NULL);
   }
+
+  u64 GetNanoseconds()
+  {
+    struct timespec tspec;
+    clock_gettime(CLOCK_MONOTONIC, &tspec);
+
+    return ((u64) tspec.tv_sec) * 1000000000 + tspec.tv_nsec;
+  }
 }
@@ -156,6 +156,24 @@ void RandMT::seedMT(uint32 seed) {
   for(*s++=x, j=N; --j; *s++ = (x*=69069U) & 0xFFFFFFFFU);
 }
 
+void RandMT::SaveState(u32 * words) const {
+  for(int i = 0; i <= N; ++i)
+    words[i] = (u32) state[i];
+  words[N+1] = (left > 0) ? (u32) (next - state) : 0;
+  words[N+2] = (u32) initseed;
+  words[N+3] = (u32) left;
+}
+
+void RandMT::LoadState(const u32 * words) {
+  for(int i = 0; i <= N; ++i)
+    state[i] = words[i];
+  next = state + (words[N+1] <= (u32) N ? words[N+1] : 0);
+  initseed = words[N+2];
+  left = (s32) words[N+3];
+  if (left > 0 && next + left > state + N)
+    left = 0;     // Inconsistent; force a reload on next use
+}
+
 uint32 RandMT::reloadMT(void) {
   register uint32 *p0=state, *p2=state+2, *pM=state+M, s0, s1;
   register int    j;
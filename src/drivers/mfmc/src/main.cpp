@@ -68,15 +68,39 @@ namespace MFM
       this->NeedElement(&Element_Eraser<CC>::THE_INSTANCE);
     }
 
+    static void CheckTileWidthFromArgs(const char* widthStr, void* driverptr)
+    {
+      MFMCDriver& driver = *((MFMCDriver*)driverptr);
+
+      // main picked our model by this already; just make sure it fit
+      const s32 ourWidth = CC::PARAM_CONFIG::TILE_WIDTH;
+      const s32 width = atoi(widthStr);
+      if (width != ourWidth)
+      {
+        driver.GetVArguments().Die("Tile width must be 32, 40, or 48, not %d", width);
+      }
+    }
+
   public:
     virtual void AddDriverArguments()
     {
       Super::AddDriverArguments();
+
+      this->RegisterArgument("Use tiles ARG sites wide (32, 40, or 48; default by program name)",
+                             "--tilewidth", &CheckTileWidthFromArgs, this, true);
     }
 
     virtual void OnceOnly(VArguments& args)
     {
       Super::OnceOnly(args);
+
+      // Each tile width comes with its own default grid size
+      if (args.Appeared("--tilewidth") && !args.Appeared("--gridsize"))
+      {
+        LOG.Message("Tile width %d uses its default grid of %dx%d tiles; see --gridsize",
+                    CC::PARAM_CONFIG::TILE_WIDTH,
+                    this->GetGrid().GetWidth(), this->GetGrid().GetHeight());
+      }
     }
 
     virtual void ReinitEden()
@@ -118,6 +142,20 @@ static bool EndsWith(const char *string, const char* suffix)
   return xlen <= slen && !strcmp(suffix, &string[slen - xlen]);
 }
 
+/* Returns the argument following the last 'name' in argv, or NULL */
+static const char * FindArgument(int argc, const char** argv, const char * name)
+{
+  const char * value = 0;
+  for (int i = 1; i < argc - 1; ++i)
+  {
+    if (!strcmp(argv[i], name))
+    {
+      value = argv[i + 1];
+    }
+  }
+  return value;
+}
+
 int main(int argc, const char** argv)
 {
   MFM::DateTimeStamp stamper;
@@ -125,6 +163,18 @@ int main(int argc, const char** argv)
   MFM::LOG.SetByteSink(MFM::STDERR);
   MFM::LOG.SetLevel(MFM::LOG.MESSAGE);
 
+  const char * tileWidth = FindArgument(argc, argv, "--tilewidth");
+  if (tileWidth)
+  {
+    switch (atoi(tileWidth))
+    {
+    case 32: return MFM::RunSmall(argc, argv);
+    case 40: return MFM::RunMedium(argc, argv);
+    case 48: return MFM::RunBig(argc, argv);
+    default: break;  // The driver will complain
+    }
+  }
+
   if (EndsWith(argv[0],"_s"))
   {
     return MFM::RunSmall(argc, argv);
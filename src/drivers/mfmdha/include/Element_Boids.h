@@ -243,7 +243,11 @@ namespace MFM
     static const u32 STATE_HEADING_LEN = 2 * BITS_PER_DIM;
     static const u32 STATE_BITS = STATE_HEADING_IDX + STATE_HEADING_LEN;
 
-    Element_Boids() { }
+    Element_Boids()
+    {
+      // Behavior scans the whole window
+      Element<CC>::SetGathersWindow(true);
+    }
 
     Vector GetHeading(const T &atom) const {
       if (!IsBoidType(atom.GetType()))
@@ -274,7 +278,7 @@ namespace MFM
         if (sp.GetMaximumLength() > 1) continue;
 
         Vector spVec(sp);
-        const T other = window.GetRelativeAtom(sp);
+        const T other = window.GetSiteAtom(idx);
 
         // Compute weight of this choice:
         //
@@ -335,7 +339,7 @@ namespace MFM
       // Scan event window outside self
       for (u32 idx = md.GetFirstIndex(1); idx <= md.GetLastIndex(R); ++idx) {
         const SPoint sp = md.GetPoint(idx);
-        const T other = window.GetRelativeAtom(sp);
+        const T other = window.GetSiteAtom(idx);
 
         const u32 otherType = other.GetType();
 
@@ -26,6 +26,11 @@ int main(int argc, char** argv)
   ColorMap_Test::Test_RunTests();
   Random_Test::Test_RunTests();
   BitVector_Test::Test_RunTests();
+  SPSCQueue_Test::Test_RunTests();
+  Connection_Test::Test_RunTests();
+  EventCount_Test::Test_RunTests();
+  BufferPoolThread_Test::Test_RunTests();
+  VideoEncoder_Test::Test_RunTests();
 
   Point_Test::Test_pointAdd();
   Point_Test::Test_pointMultiply();
@@ -40,12 +45,31 @@ int main(int argc, char** argv)
   P1Atom_Test::Test_p1atomAddSB();
 #endif
 
+  P3Atom_Test::Test_p3atomTypeIfSane();
+  P3Atom_Test::Test_p3atomExecuteRepair();
+
   Tile_Test::Test_tilePlaceAtom();
+  Tile_Test::Test_tileSparseEvents();
+  Tile_Test::Test_tileEventBatches();
+  Tile_Test::Test_tileAtomTypes();
 
   Grid_Test::Test_gridPlaceAtom();
+  Grid_Test::Test_gridWorkerThreads();
+  Grid_Test::Test_gridSerialExecution();
+  Grid_Test::Test_gridSnapshot();
+  Grid_Test::Test_gridCheckpoints();
+  Grid_Test::Test_gridLiveSnapshots();
+  Grid_Test::Test_gridRasterizer();
+  Grid_Test::Test_gridDimensions();
+  Grid_Test::Test_gridAtomCounts();
+  Grid_Test::Test_gridElementData();
 
   EventWindow_Test::Test_eventwindowConstruction();
   EventWindow_Test::Test_eventwindowWrite();
+  EventWindow_Test::Test_eventwindowDirtySites();
+  EventWindow_Test::Test_eventwindowGatherScatter();
+  EventWindow_Test::Test_eventwindowGatherOptIn();
+  EventWindow_Test::Test_eventwindowSiteMasks();
 
   ExternalConfig_Test::Test_RunTests();
 
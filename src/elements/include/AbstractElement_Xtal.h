@@ -98,6 +98,8 @@ namespace MFM
 
     AbstractElement_Xtal(const UUID & uuid) : Element<CC>(uuid)
     {
+      // Behavior scans the whole window
+      Element<CC>::SetGathersWindow(true);
     }
 
     /**
@@ -174,13 +176,13 @@ namespace MFM
         const SPoint sp = md.GetPoint(idx);
 
         // First question: Is this a live site?
-        if (!window.IsLiveSite(sp))
+        if (!window.IsLiveSiteIndex(idx))
           continue;
 
         // Second question: Is this a point site or a field site?
         bool isPoint = xtalSites.ReadBit(idx) !=0 ;
 
-        const T other = window.GetRelativeAtom(sp);
+        const T other = window.GetSiteAtom(idx);
         const u32 otherType = other.GetType();
 
         if (isPoint) {
@@ -60,6 +60,11 @@ namespace MFM
 
     static Element_Consumer THE_INSTANCE;
 
+    virtual u32 GetElementDataSlotCount() const
+    {
+      return DATA_SLOT_COUNT;
+    }
+
     virtual T BuildDefaultAtom() const {
       T defaultAtom(this->GetType(), 0, 0, AbstractElement_Reprovert<CC>::STATE_BITS);
       this->SetGap(defaultAtom,1); // Pack consumers adjacent
@@ -76,25 +81,21 @@ namespace MFM
     u64 GetAndResetDatumsConsumed(Tile<CC> & t) const
     {
       ElementTable<CC> & et = t.GetElementTable();
-      u64 * datap = et.GetDataIfRegistered(this->GetType(), DATA_SLOT_COUNT);
-      if (!datap)
+      s32 offset = et.GetElementDataOffset(this->GetType(), DATA_SLOT_COUNT, DATUMS_CONSUMED_SLOT);
+      if (offset < 0)
         return 0;
 
-      u64 ret = datap[DATUMS_CONSUMED_SLOT];
-      datap[DATUMS_CONSUMED_SLOT] = 0;
-      return ret;
+      return et.TakeElementData(offset);
     }
 
     u64 GetAndResetBucketError(Tile<CC> & t) const
     {
       ElementTable<CC> & et = t.GetElementTable();
-      u64 * datap = et.GetDataIfRegistered(this->GetType(), DATA_SLOT_COUNT);
-      if (!datap)
+      s32 offset = et.GetElementDataOffset(this->GetType(), DATA_SLOT_COUNT, TOTAL_BUCKET_ERROR_SLOT);
+      if (offset < 0)
         return 0;
 
-      u64 ret = datap[TOTAL_BUCKET_ERROR_SLOT];
-      datap[TOTAL_BUCKET_ERROR_SLOT] = 0;
-      return ret;
+      return et.TakeElementData(offset);
     }
 
     virtual u32 PercentMovable(const T& you,
@@ -159,8 +160,9 @@ namespace MFM
             ElementTable<CC> & et = tile.GetElementTable();
 
             u64 * datap = et.GetDataAndRegister(this->GetType(), DATA_SLOT_COUNT);
-            ++datap[DATUMS_CONSUMED_SLOT];                 // Count datums consumed
-            datap[TOTAL_BUCKET_ERROR_SLOT] += bucketsOff;  // Count total bucket error
+            // Count datums consumed, and total bucket error
+            ElementTable<CC>::AddElementData(datap[DATUMS_CONSUMED_SLOT], 1);
+            ElementTable<CC>::AddElementData(datap[TOTAL_BUCKET_ERROR_SLOT], bucketsOff);
 
             /*
               printf("[%d:%d:%d/bs %d>%d<%d=%d]Export!: %d %ld %ld %f\n",
@@ -61,6 +61,11 @@ namespace MFM
 
     static Element_Emitter THE_INSTANCE;
 
+    virtual u32 GetElementDataSlotCount() const
+    {
+      return DATA_SLOT_COUNT;
+    }
+
     virtual T BuildDefaultAtom() const {
       T defaultAtom(this->GetType(), 0, 0, AbstractElement_Reprovert<CC>::STATE_BITS);
       this->SetGap(defaultAtom,2);
@@ -107,7 +112,7 @@ namespace MFM
         ElementTable<CC> & et = tile.GetElementTable();
 
         u64 * datap = et.GetDataAndRegister(this->GetType(), DATA_SLOT_COUNT);
-        ++datap[DATUMS_EMITTED_SLOT];                  // Count emission attempts
+        ElementTable<CC>::AddElementData(datap[DATUMS_EMITTED_SLOT], 1);  // Count emission attempts
 
         // Pick random nearest empty, if any
         const MDist<R> & md = MDist<R>::get();
@@ -137,7 +142,7 @@ namespace MFM
           }
         }
 
-        ++datap[DATUMS_REJECTED_SLOT];  // Opps, no room at the inn
+        ElementTable<CC>::AddElementData(datap[DATUMS_REJECTED_SLOT], 1);  // Opps, no room at the inn
       }
     }
   };
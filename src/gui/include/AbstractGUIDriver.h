@@ -31,6 +31,7 @@
 #include <sys/stat.h>  /* for mkdir */
 #include <sys/types.h> /* for mkdir */
 #include <errno.h>     /* for errno */
+#include <string.h>    /* for strcmp */
 #include "Utils.h"     /* for GetDateTimeNow */
 #include "Logger.h"
 #include "AssetManager.h"
@@ -64,6 +65,9 @@ namespace MFM
 {
 #define FRAMES_PER_SECOND 100.0
 
+  /* Playback rate of recorded videos, at one frame per epoch */
+#define VIDEO_FRAMES_PER_SECOND 30
+
 #define CAMERA_SLOW_SPEED 2
 #define CAMERA_FAST_SPEED 50
 
@@ -89,14 +93,14 @@ namespace MFM
    protected:
     typedef typename Super::OurGrid OurGrid;
     typedef typename Super::CC CC;
-    enum { W = GC::GRID_WIDTH};
-    enum { H = GC::GRID_HEIGHT};
 
     bool m_startPaused;
     bool m_thisUpdateIsEpoch;
     bool m_bigText;
     u32 m_thisEpochAEPS;
     bool m_captureScreenshots;
+    bool m_captureAsPNGs;                 // Else stream a video in m_videoFormat
+    VideoEncoder::Format m_videoFormat;
     u32 m_saveStateIndex;
     u32 m_epochSaveStateIndex;
 
@@ -197,8 +201,7 @@ namespace MFM
         GridRenderer & grend = AbstractGridButton::m_driver->GetGridRenderer();
 
         const SPoint selTile = grend.GetSelectedTile();
-        if(selTile.GetX() >= 0 && selTile.GetX() < W &&
-           selTile.GetY() >= 0 && selTile.GetY() < H)
+        if(grid.IsLegalTileIndex(selTile))
         {
           grid.EmptyTile(grend.GetSelectedTile());
         }
@@ -640,6 +643,8 @@ namespace MFM
       }
       else
       {
+        Super::PauseGrid();  // In case --live left it running
+
         const s32 ONE_THOUSAND = 1000;
         const s32 ONE_MILLION = ONE_THOUSAND*ONE_THOUSAND;
 
@@ -672,6 +677,7 @@ namespace MFM
 
       if(m_keyboard.IsDown(SDLK_q) && m_keyboard.CtrlHeld())
       {
+        Super::PauseGrid();
         exit(0);
       }
 
@@ -733,7 +739,10 @@ namespace MFM
         if (m_captureScreenshots)
           LOG.Message("Capturing screenshots every %d AEPS", this->GetAEPSPerEpoch());
         else
+        {
           LOG.Message("Not capturing screenshots");
+          camera.StopVideo();
+        }
       }
 
       if(m_keyboard.SemiAuto(SDLK_t))
@@ -786,7 +795,8 @@ namespace MFM
     void SaveGridWithNextFilename()
     {
         const char* filename =
-          Super::GetSimDirPathTemporary("save/%D.mfs", m_saveStateIndex++);
+          Super::GetSimDirPathTemporary("save/%D.%s", m_saveStateIndex++,
+                                        Super::GetSaveExtension());
         Super::SaveGrid(filename);
     }
 
@@ -802,6 +812,8 @@ namespace MFM
       m_thisUpdateIsEpoch(false),
       m_bigText(false),
       m_captureScreenshots(false),
+      m_captureAsPNGs(false),
+      m_videoFormat(VideoEncoder::FORMAT_DELTA),
       m_saveStateIndex(0),
       m_epochSaveStateIndex(0),
       m_renderStats(false),
@@ -886,6 +898,27 @@ namespace MFM
       AbstractGUIDriver* driver = (AbstractGUIDriver<GC>*)driverptr;
 
       driver->m_captureScreenshots = true;
+      driver->m_captureAsPNGs = true;
+    }
+
+    static void SetRecordVideoFromArgs(const char* format, void* driverptr)
+    {
+      AbstractGUIDriver* driver = (AbstractGUIDriver<GC>*)driverptr;
+
+      if (!strcmp(format, "png"))
+      {
+        driver->m_captureAsPNGs = true;
+      }
+      else if (VideoEncoder::ParseFormat(format, driver->m_videoFormat))
+      {
+        driver->m_captureAsPNGs = false;
+      }
+      else
+      {
+        driver->GetVArguments().Die("Video format must be y4m, delta, or png, not '%s'",
+                                    format);
+      }
+      driver->m_captureScreenshots = true;
     }
 
     static void SetStartPausedFromArgs(const char* not_used, void* driverptr)
@@ -926,6 +959,10 @@ namespace MFM
       this->RegisterArgument("Capture a screenshot every epoch",
                              "-p|--pngs", &SetRecordScreenshotPerAEPSFromArgs, this, false);
 
+      this->RegisterArgument("Record a video every epoch in format ARG: delta (also "
+                             "the format for 'r'), y4m, or png",
+                             "--video", &SetRecordVideoFromArgs, this, true);
+
       this->RegisterArgument("Simulation begins upon program startup.",
                              "--run", &SetStartPausedFromArgs, this, false);
 
@@ -1172,6 +1209,32 @@ namespace MFM
       return m_srend;
     }
 
+    void CaptureFrame()
+    {
+      if (m_captureAsPNGs)
+      {
+        const char * path = Super::GetSimDirPathTemporary("vid/%010d.png", m_thisEpochAEPS);
+
+        camera.DrawSurface(screen,path);
+        return;
+      }
+
+      // Start a new video whenever the window size changes
+      if (!camera.VideoFits(screen))
+      {
+        const char * path =
+          Super::GetSimDirPathTemporary("vid/%010d.%s", m_thisEpochAEPS,
+                                        VideoEncoder::GetExtension(m_videoFormat));
+        if (!camera.StartVideo(path, m_videoFormat, screen, VIDEO_FRAMES_PER_SECOND))
+        {
+          m_captureScreenshots = false;
+          return;
+        }
+      }
+
+      camera.RecordVideoFrame(screen, m_thisEpochAEPS);
+    }
+
     void RunHelper()
     {
       m_keyboardPaused = m_startPaused;
@@ -1189,6 +1252,12 @@ namespace MFM
       {
         while(SDL_PollEvent(&event))
         {
+          // Under --live, anything but hovering may change the grid
+          if (event.type != SDL_MOUSEMOTION || mouseButtonsDown != 0)
+          {
+            Super::PauseGrid();
+          }
+
           switch(event.type)
           {
           case SDL_VIDEORESIZE:
@@ -1261,9 +1330,7 @@ namespace MFM
         {
           if (m_captureScreenshots)
           {
-            const char * path = Super::GetSimDirPathTemporary("vid/%010d.png", m_thisEpochAEPS);
-
-            camera.DrawSurface(screen,path);
+            CaptureFrame();
           }
           {
             /*
@@ -1292,13 +1359,19 @@ namespace MFM
            Super::GetAEPS() > Super::GetHaltAfterAEPS())
         {
           // Free final save if --haltafteraeps.  Hope for good-looking corpse
-          SaveGridWithConstantFilename("save/final.mfs");
+          OString32 finalName;
+          finalName.Printf("save/final.%s", Super::GetSaveExtension());
+          SaveGridWithConstantFilename(finalName.GetZString());
           running = false;
         }
 
         SDL_Flip(screen);
       }
 
+      Super::PauseGrid();
+
+      camera.StopVideo();
+
       SDL_FreeSurface(screen);
       TTF_Quit();
       SDL_Quit();
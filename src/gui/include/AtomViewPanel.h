@@ -40,7 +40,9 @@ namespace MFM
     typedef typename GC::CORE_CONFIG::ATOM_TYPE T;
     typedef typename GC::CORE_CONFIG CC;
 
-    T* m_atom;
+    /** The grid site of the Atom to show, if m_hasAtom */
+    SPoint m_atomLoc;
+    bool m_hasAtom;
 
     Grid<GC>* m_grid;
 
@@ -51,7 +53,7 @@ namespace MFM
    public:
     AtomViewPanel() :
       MovablePanel(300, 100),
-      m_atom(NULL),
+      m_hasAtom(false),
       m_grid(NULL),
       m_toolboxPanel(NULL)
     {
@@ -73,7 +75,7 @@ namespace MFM
       this->SetVisibility(visible);
     }
 
-    void PaintDisplayAtomicControllers(Drawing & d, T& atom,const Element<CC>* elt)
+    void PaintDisplayAtomicControllers(Drawing & d, const T& atom,const Element<CC>* elt)
     {
       // XXX DESIGN ME
       // XXX WRITE ME
@@ -107,7 +109,12 @@ namespace MFM
       d.SetForeground(Panel::GetForeground());
       d.FillRect(Rect(SPoint(0, 0), Panel::GetDimensions()));
 
-      if(!m_atom || !m_grid)
+      // Read the Atom afresh each time, from a Snapshot if need be
+      const T* atom = (m_hasAtom && m_grid) ? m_grid->GetDisplayAtom(m_atomLoc) : 0;
+      const Element<CC>* element =
+        (atom && atom->IsSane()) ? m_grid->LookupElement(atom->GetType()) : 0;
+
+      if(!element)
       {
         d.SetFont(AssetManager::Get(FONT_ASSET_HELPPANEL_SMALL));
         d.SetForeground(Drawing::BLACK);
@@ -116,7 +123,6 @@ namespace MFM
       }
       else
       {
-        const Element<CC>* element = m_grid->LookupElement(m_atom->GetType());
         d.SetForeground(element->DefaultPhysicsColor());
         d.FillCircle(2, 2, ATOM_DRAW_SIZE, ATOM_DRAW_SIZE, ATOM_DRAW_SIZE >> 1);
         d.SetFont(FONT_ASSET_ELEMENT);
@@ -132,26 +138,26 @@ namespace MFM
                          MakeUnsigned(d.GetTextSize(element->GetName())));
 
         OString64 desc;
-        element->AppendDescription(m_atom, desc);
+        element->AppendDescription(atom, desc);
         const char* zstr = desc.GetZString();
 
         d.SetFont(FONT_ASSET_HELPPANEL_SMALL);
         d.BlitBackedText(zstr, UPoint(4 + ATOM_DRAW_SIZE, 28),
                          MakeUnsigned(d.GetTextSize(zstr)));
 
-        PaintDisplayAtomicControllers(d, *m_atom, element);
+        PaintDisplayAtomicControllers(d, *atom, element);
       }
     }
 
-    void SetAtom(T* atom)
+    /**
+     * Shows the Atom at grid site \c loc, or none if \c loc is NULL.
+     */
+    void SetAtomLocation(const SPoint* loc)
     {
-      if(atom && atom->IsSane())
-      {
-        m_atom = atom;
-      }
-      else
+      m_hasAtom = loc != NULL;
+      if (loc)
       {
-        m_atom = NULL;
+        m_atomLoc = *loc;
       }
     }
 
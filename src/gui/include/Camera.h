@@ -30,6 +30,7 @@
 
 #include "itype.h"
 #include "SDL.h"
+#include "VideoEncoder.h"
 
 namespace MFM
 {
@@ -43,6 +44,10 @@ namespace MFM
    * At the moment, this only supports writing 10 million frames. This
    * is a whole lot, but keep this in mind if wanting to make a really
    * long video.
+   *
+   * Alternatively, a Camera can stream the images into a single video
+   * file, encoded on a background thread by a VideoEncoder, so that
+   * recording never stalls drawing.
    */
   class Camera
   {
@@ -60,6 +65,8 @@ namespace MFM
 
     u32 SavePNG(const char* filename, SDL_Surface* sfc) const;
 
+    VideoEncoder m_video;
+
   public:
 
     Camera();
@@ -71,6 +78,45 @@ namespace MFM
     void SetRecording(bool recording);
 
     bool DrawSurface(SDL_Surface* sfc, const char * pngPath) const;
+
+    /**
+     * Starts streaming a video of \c sfc, which must have 32 bits per
+     * pixel, to \c path, in \c format.  Any video already being
+     * recorded is finished first.
+     *
+     * @returns true on success; on failure logs an error and returns
+     *          false.
+     */
+    bool StartVideo(const char * path, VideoEncoder::Format format,
+                    SDL_Surface* sfc, u32 framesPerSecond);
+
+    bool IsRecordingVideo() const
+    {
+      return m_video.IsOpen();
+    }
+
+    /**
+     * Returns true if the video being recorded has the size of \c sfc.
+     */
+    bool VideoFits(SDL_Surface* sfc) const
+    {
+      return m_video.IsOpen() &&
+        m_video.GetWidth() == (u32) sfc->w && m_video.GetHeight() == (u32) sfc->h;
+    }
+
+    /**
+     * Queues the current contents of \c sfc as the next video frame,
+     * tagged with \c label.  Never waits for the encoder.
+     *
+     * @returns false if the frame was dropped, because the encoder
+     *          has fallen behind or \c sfc no longer fits the video.
+     */
+    bool RecordVideoFrame(SDL_Surface* sfc, u32 label);
+
+    /**
+     * Finishes writing the video being recorded, if any.
+     */
+    void StopVideo();
   };
 }
 
@@ -268,6 +268,33 @@ namespace MFM {
      */
      void FillCircle(int x, int y, int w, int h, int radius) const;
 
+    /**
+       The largest cellSize FillCells accepts.
+     */
+    static const u32 MAX_CELL_SIZE = 64;
+
+    /**
+       Return true if FillCells can draw on the current surface, which
+       it writes directly and so must have 32 bits per pixel.
+     */
+    bool CanFillCells() const
+    {
+      return m_dest && m_dest->format->BytesPerPixel == 4;
+    }
+
+    /**
+       Fill a cols by rows array of cells, each cellSize pixels square,
+       with the upper left of the first at (x,y).  colors holds one
+       color per cell, row by row; cells of color 0 are left as they
+       are.  If circles, each cell gets a circle as drawn by FillCircle
+       rather than a square.  Much faster than the equivalent FillRect
+       or FillCircle calls, since it writes each row of pixels straight
+       to the surface.  Fail ILLEGAL_STATE unless CanFillCells(), and
+       ILLEGAL_ARGUMENT if cellSize exceeds MAX_CELL_SIZE.
+     */
+    void FillCells(const u32 * colors, u32 cols, u32 rows,
+                   int x, int y, u32 cellSize, bool circles) const;
+
 
     /**
        Draw message in the current font using the current foreground
@@ -53,19 +53,12 @@ namespace MFM
     typedef typename GC::CORE_CONFIG CC;
     typedef typename CC::PARAM_CONFIG P;
     typedef typename CC::ATOM_TYPE T;
-    enum { W = GC::GRID_WIDTH};
-    enum { H = GC::GRID_HEIGHT};
     enum { R = P::EVENT_WINDOW_RADIUS};
     enum { TILE_SIDE_CACHE_SITES = P::TILE_WIDTH};
     enum { TILE_SIDE_LIVE_SITES = TILE_SIDE_CACHE_SITES - 2*R};
     enum { MAX_BUCKET_FILL_DEPTH = 10000 };
 
     static const u32 EVENT_WINDOW_RADIUS = R;
-    static const u32 GRID_WIDTH_TILES = W;
-    static const u32 GRID_HEIGHT_TILES = H;
-
-    static const u32 GRID_WIDTH_LIVE_SITES = W * TILE_SIDE_LIVE_SITES;
-    static const u32 GRID_HEIGHT_LIVE_TILES = H * TILE_SIDE_LIVE_SITES;
 
     typedef Grid<GC> OurGrid;
 
@@ -157,7 +150,7 @@ namespace MFM
       m_grend->DeselectAtom();
       m_cloneOrigin.Set(-1, -1);
       m_grend->SetCloneOrigin(m_cloneOrigin);
-      m_atomViewPanel.SetAtom(NULL);
+      m_atomViewPanel.SetAtomLocation(NULL);
     }
 
    protected:
@@ -267,7 +260,7 @@ namespace MFM
 
       m_grend->SelectAtom(*m_mainGrid, pt);
       SPoint selectedAtom = m_grend->GetSelectedAtom();
-      m_atomViewPanel.SetAtom(m_mainGrid->GetWritableAtom(selectedAtom));
+      m_atomViewPanel.SetAtomLocation(&selectedAtom);
     }
 
     void HandlePencilTool(u8 button, SPoint clickPt)
@@ -392,8 +385,8 @@ namespace MFM
           }
         }
         else if(cp.GetX() >= 0 && cp.GetY() >= 0 &&
-                cp.GetX() < TILE_SIDE_LIVE_SITES * W &&
-                cp.GetY() < TILE_SIDE_LIVE_SITES * H)
+                cp.GetX() < (s32) grid.GetWidthSites() &&
+                cp.GetY() < (s32) grid.GetHeightSites())
         {
           if(tool == TOOL_BUCKET)
           {
@@ -454,8 +447,8 @@ namespace MFM
         npt.Add(pt.GetX(), pt.GetY());
 
         if(npt.GetX() >= 0 && npt.GetY() >= 0 &&
-           npt.GetX() < TILE_SIDE_LIVE_SITES * W &&
-           npt.GetY() < TILE_SIDE_LIVE_SITES * H)
+           npt.GetX() < (s32) grid.GetWidthSites() &&
+           npt.GetY() < (s32) grid.GetHeightSites())
         {
           if(Atom<CC>::IsType(*grid.GetAtom(npt),
                               m_bucketFillStartType))
@@ -27,6 +27,8 @@ namespace MFM
                     m_cloneOrigin.GetY() / (tileSize / atomSize));
     }
 
+    m_tileRenderer.SetRenderSnapshots(grid.IsReadingSnapshots());
+
     for(u32 x = 0; x < grid.GetWidth(); x++)
     {
       current.SetX(x);
@@ -168,7 +170,7 @@ namespace MFM
 
     if(cp.GetX() > 0 && cp.GetY() > 0)
     {
-      for(u32 x = 0; x < GC::GRID_WIDTH + 1; x++)
+      for(u32 x = 0; x < grid.GetWidth() + 1; x++)
       {
         if(x * tileSize >= (u32)cp.GetX())
         {
@@ -176,7 +178,7 @@ namespace MFM
           break;
         }
       }
-      for(u32 y = 0; y < GC::GRID_HEIGHT + 1; y++)
+      for(u32 y = 0; y < grid.GetHeight() + 1; y++)
       {
         if(y * tileSize >= (u32)cp.GetY())
         {
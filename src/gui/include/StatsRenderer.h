@@ -153,6 +153,33 @@ namespace MFM {
       u32 m_outOfSlots;
       bool m_resetOnRead;
 
+      /**
+       * Where our slot lives in every Tile, or -1 if unresolved or not
+       * the same everywhere.  Rechecked against one Tile per read.
+       */
+      mutable s32 m_offset;
+
+      /**
+       * Sums our slot Tile by Tile, for when it isn't at the same
+       * offset in all of them.
+       */
+      u64 SumEachTile(bool take) const
+      {
+        u64 sum = 0;
+        for (typename Grid<GC>::iterator_type i = m_grid->begin(); i != m_grid->end(); ++i)
+        {
+          Tile<CC> * t = *i;
+          ElementTable<CC> & et = t->GetElementTable();
+          s32 offset = et.GetElementDataOffset(m_elementType, m_outOfSlots, m_slot);
+          if (offset < 0)
+          {
+            continue;
+          }
+          sum += take ? et.TakeElementData(offset) : et.ReadElementData(offset);
+        }
+        return sum;
+      }
+
      public:
       ElementDataSlotSum() :
         m_grid(0),
@@ -160,7 +187,8 @@ namespace MFM {
         m_elementType(0),
         m_slot(0),
         m_outOfSlots(0),
-        m_resetOnRead(false)
+        m_resetOnRead(false),
+        m_offset(-1)
       { }
 
       void Set(Grid<GC> & grid, const char * label, u32 elementType,
@@ -172,6 +200,7 @@ namespace MFM {
         m_slot = slot;
         m_outOfSlots = outOfSlots;
         m_resetOnRead = resetOnRead;
+        m_offset = -1;
       }
 
       virtual const char * GetLabel() const
@@ -198,24 +227,21 @@ namespace MFM {
           return -1;
         }
 
-        u64 sum = 0;
-        for (typename Grid<GC>::iterator_type i = m_grid->begin(); i != m_grid->end(); ++i)
+        const bool take = endOfEpoch && m_resetOnRead;
+
+        // Elements may have been reloaded since we resolved m_offset
+        const ElementTable<CC> & et = m_grid->GetTile(0, 0).GetElementTable();
+        if (m_offset < 0 ||
+            et.GetElementDataOffset(m_elementType, m_outOfSlots, m_slot) != m_offset)
         {
-          Tile<CC> * t = *i;
-          ElementTable<CC> & et = t->GetElementTable();
-          u64 * eds = et.GetElementDataSlotsFromType(m_elementType,m_outOfSlots);
-          if (!eds)
-          {
-            continue;
-          }
-          sum += eds[m_slot];
-          if (endOfEpoch && m_resetOnRead)
-          {
-            eds[m_slot] = 0;
-          }
+          m_offset = m_grid->GetElementDataOffset(m_elementType, m_outOfSlots, m_slot);
         }
 
-        return (double) sum;
+        if (m_offset < 0)
+        {
+          return (double) SumEachTile(take);
+        }
+        return (double) m_grid->SumElementData(m_offset, take);
       }
     };
 
@@ -14,8 +14,6 @@ namespace MFM {
     // Extract short names for parameter types
     typedef typename GC::CORE_CONFIG CC;
     typedef typename CC::PARAM_CONFIG P;
-    enum { W = GC::GRID_WIDTH};
-    enum { H = GC::GRID_HEIGHT};
     enum { R = P::EVENT_WINDOW_RADIUS};
 
     const u32 STR_BUFFER_SIZE = 128;
@@ -47,6 +47,9 @@ namespace MFM
 
     bool m_renderSquares;
 
+    /** If true, Tiles are drawn from their Snapshots */
+    bool m_renderSnapshots;
+
     u32 m_gridColor;
 
     u32 m_cacheColor;
@@ -60,6 +63,26 @@ namespace MFM
 
     Point<u32> m_dimensions;
 
+    /**
+     * Atoms drawn larger than this also get their element's symbol,
+     * so are drawn one by one.
+     */
+    static const u32 MAX_UNLABELED_ATOM_SIZE = 40;
+
+    /**
+     * The write age heat map colors, indexed by the base 2 logarithm
+     * of the age in AEPS, to AGE_COLOR_STEPS steps per doubling.
+     * Ages past AGE_COLOR_DOUBLINGS doublings all get the last color.
+     */
+    static const u32 AGE_COLOR_STEP_BITS = 4;
+    static const u32 AGE_COLOR_STEPS = 1 << AGE_COLOR_STEP_BITS;
+    static const u32 AGE_COLOR_DOUBLINGS = 20;
+    u32 m_ageColors[AGE_COLOR_STEPS * (AGE_COLOR_DOUBLINGS + 1)];
+
+    void InitAgeColors();
+
+    u32 GetAgeColor(u32 writeAge, u32 agePerAEPS) const;
+
     template <class CC>
     void RenderMemRegions(Drawing & drawing, SPoint& pt,
                           bool renderCache, bool selected, bool lowlight);
@@ -82,6 +105,10 @@ namespace MFM
     void RenderAtoms(Drawing & drawing, SPoint& pt, Tile<CC>& tile,
                      bool renderCache, bool lowlight);
 
+    template <class CC>
+    void RenderAtomsBySite(Drawing & drawing, SPoint& pt, Tile<CC>& tile,
+                           bool renderCache, bool lowlight);
+
     template <class CC>
     void RenderAtom(Drawing & drawing, const SPoint& atomLoc, const UPoint& rendPt,
                     Tile<CC>& tile, bool lowlight);
@@ -121,6 +148,15 @@ namespace MFM
       m_renderSquares = !m_renderSquares;
     }
 
+    /**
+     * Sets whether RenderTile draws a Tile from its latest Snapshot,
+     * as it must while the Tile runs, rather than from the Tile.
+     */
+    void SetRenderSnapshots(bool value)
+    {
+      m_renderSnapshots = value;
+    }
+
     bool* GetDrawDataHeatPointer()
     {
       return &m_drawDataHeat;
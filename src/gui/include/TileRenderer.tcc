@@ -30,6 +30,119 @@ namespace MFM
   {
     // Extract short type names
     typedef typename CC::PARAM_CONFIG P;
+    typedef typename CC::ATOM_TYPE T;
+    enum { R = P::EVENT_WINDOW_RADIUS };
+
+    if (m_atomDrawSize > MAX_UNLABELED_ATOM_SIZE || !drawing.CanFillCells())
+    {
+      RenderAtomsBySite(drawing, pt, tile, renderCache, lowlight);
+      return;
+    }
+
+    const u32 astart = renderCache ? 0 : R;
+    const u32 aend   = renderCache ? P::TILE_WIDTH : P::TILE_WIDTH - R;
+    const u32 side = aend - astart;
+
+    const s32 cacheOffset = renderCache ? 0 : -R * (s32) m_atomDrawSize;
+    const s32 left = pt.GetX() + m_windowTL.GetX() + cacheOffset + m_atomDrawSize * astart;
+    const s32 top = pt.GetY() + m_windowTL.GetY() + cacheOffset + m_atomDrawSize * astart;
+
+    const bool drawAges = m_drawMemRegions == AGE || m_drawMemRegions == AGE_ONLY;
+    const u32 emptyType = Element_Empty<CC>::THE_INSTANCE.GetType();
+    const u32 agePerAEPS = tile.GetSites();
+
+    // Resolve every site's colors first, then draw them all at once
+    u32 ageColors[P::TILE_WIDTH * P::TILE_WIDTH];
+    u32 atomColors[P::TILE_WIDTH * P::TILE_WIDTH];
+    bool anyBad = false;
+
+    SPoint atomLoc;
+    for (u32 y = astart; y < aend; y++)
+    {
+      atomLoc.SetY(y);
+      const u32 rendY = top + m_atomDrawSize * (y - astart);
+      for (u32 x = astart; x < aend; x++)
+      {
+        atomLoc.SetX(x);
+        const u32 rendX = left + m_atomDrawSize * (x - astart);
+        const u32 i = (y - astart) * side + (x - astart);
+        ageColors[i] = atomColors[i] = 0;
+
+        // Like RenderAtomsBySite, skip sites (even partly) off screen
+        if (rendX + m_atomDrawSize >= m_dimensions.GetX() ||
+            rendY + m_atomDrawSize >= m_dimensions.GetY())
+        {
+          continue;
+        }
+
+        if (drawAges && tile.IsOwnedSite(atomLoc))
+        {
+          const SPoint ownedLoc = atomLoc - SPoint(R, R);
+          const u32 writeAge = m_renderSnapshots ?
+            tile.GetSnapshot().m_writeAges[ownedLoc.GetX()][ownedLoc.GetY()] :
+            tile.GetUncachedWriteAge(ownedLoc);
+          ageColors[i] = GetAgeColor(writeAge, agePerAEPS);
+
+          if (m_drawMemRegions == AGE_ONLY)
+          {
+            continue;
+          }
+        }
+
+        const T * atom = m_renderSnapshots ?
+          &tile.GetSnapshot().m_atoms[x][y] : tile.GetAtom(atomLoc);
+        if (!atom->IsSane())
+        {
+          anyBad = true;
+        }
+        else if (atom->GetType() != emptyType)
+        {
+          u32 color = m_drawDataHeat ?
+            GetDataHeatColor(tile, *atom) : GetAtomColor(tile, *atom);
+          if (color && lowlight)
+          {
+            color = Drawing::HalfColor(color);
+          }
+          atomColors[i] = color;
+        }
+      }
+    }
+
+    if (drawAges)
+    {
+      drawing.FillCells(ageColors, side, side, left, top, m_atomDrawSize, false);
+    }
+    drawing.FillCells(atomColors, side, side, left, top, m_atomDrawSize, !m_renderSquares);
+
+    if (anyBad)
+    {
+      for (u32 y = astart; y < aend; y++)
+      {
+        for (u32 x = astart; x < aend; x++)
+        {
+          const UPoint rendPt(left + m_atomDrawSize * (x - astart),
+                              top + m_atomDrawSize * (y - astart));
+          const SPoint loc(x, y);
+          const T * atom = m_renderSnapshots ?
+            &tile.GetSnapshot().m_atoms[x][y] : tile.GetAtom(loc);
+          if (!atom->IsSane() &&
+              !(m_drawMemRegions == AGE_ONLY && tile.IsOwnedSite(loc)) &&
+              rendPt.GetX() + m_atomDrawSize < m_dimensions.GetX() &&
+              rendPt.GetY() + m_atomDrawSize < m_dimensions.GetY())
+          {
+            RenderBadAtom<CC>(drawing, rendPt);
+          }
+        }
+      }
+    }
+  }
+
+  template <class CC>
+  void TileRenderer::RenderAtomsBySite(Drawing & drawing, SPoint& pt, Tile<CC>& tile,
+                                       bool renderCache, bool lowlight)
+  {
+    // Extract short type names
+    typedef typename CC::PARAM_CONFIG P;
 
     u32 astart = renderCache ? 0 : P::EVENT_WINDOW_RADIUS;
     u32 aend   = renderCache ? P::TILE_WIDTH : P::TILE_WIDTH - P::EVENT_WINDOW_RADIUS;
@@ -58,22 +171,13 @@ namespace MFM
                 tile.IsOwnedSite(atomLoc))
             {
               // Draw background 'write heat' map
-              u32 writeAge = tile.GetUncachedWriteAge(atomLoc -
-                                                      SPoint(P::EVENT_WINDOW_RADIUS,
-                                                             P::EVENT_WINDOW_RADIUS));
-              u32 colorIndex = 0;
-              const u32 MAX_IDX = 10000;       // Potential (interpolated) colors
-              const u32 AGE_PER_AEPS = tile.GetSites();
-              const double MAX_EXPT = 4.0;     // 10**4.0 == 10kAEPS for fully black
-              const double LOG_SCALER = MAX_IDX/MAX_EXPT;
-              double writeAgeAEPS = 1.0 * writeAge / AGE_PER_AEPS + 1;
-
-              colorIndex = MIN(MAX_IDX, (u32) (LOG_SCALER*log10(writeAgeAEPS)));
-              u32 color =
-              ColorMap_CubeHelixRev::THE_INSTANCE.
-              GetInterpolatedColor(colorIndex,0,MAX_IDX,0xffff0000);
-
-              drawing.SetForeground(color);
+              const SPoint ownedLoc = atomLoc - SPoint(P::EVENT_WINDOW_RADIUS,
+                                                       P::EVENT_WINDOW_RADIUS);
+              u32 writeAge = m_renderSnapshots ?
+                tile.GetSnapshot().m_writeAges[ownedLoc.GetX()][ownedLoc.GetY()] :
+                tile.GetUncachedWriteAge(ownedLoc);
+
+              drawing.SetForeground(GetAgeColor(writeAge, tile.GetSites()));
               drawing.FillRect(rendPt.GetX(),
                                rendPt.GetY(),
                                m_atomDrawSize,
@@ -118,7 +222,9 @@ namespace MFM
   void TileRenderer::RenderAtom(Drawing & drawing, const SPoint& atomLoc,
                                 const UPoint& rendPt,  Tile<CC>& tile, bool lowlight)
   {
-    const typename CC::ATOM_TYPE * atom = tile.GetAtom(atomLoc);
+    const typename CC::ATOM_TYPE * atom = m_renderSnapshots ?
+      &tile.GetSnapshot().m_atoms[atomLoc.GetX()][atomLoc.GetY()] :
+      tile.GetAtom(atomLoc);
     if(!atom->IsSane())
     {
       RenderBadAtom<CC>(drawing, rendPt);
@@ -210,7 +316,9 @@ namespace MFM
 
     u32 tileHeight = P::TILE_WIDTH * m_atomDrawSize;
 
-    bool lowlight = !t.GetExecutingOwnEvents();
+    bool lowlight = m_renderSnapshots ?
+      !t.GetSnapshot().m_executingOwnEvents :
+      !t.GetExecutingOwnEvents();
 
     realPt.Add(m_windowTL);
 
@@ -270,15 +378,19 @@ namespace MFM
     typedef typename CC::PARAM_CONFIG P;
     enum { R = P::EVENT_WINDOW_RADIUS};
 
-    SPoint winCenter;
-    tile.FillLastExecutedAtom(winCenter);
-
     SPoint atomLoc;
     SPoint eventCenter;
     u32 cacheOffset = renderCache ? 0 : -R;
     u32 drawColor = Drawing::WHITE;
 
-    tile.FillLastExecutedAtom(eventCenter);
+    if (m_renderSnapshots)
+    {
+      eventCenter = tile.GetSnapshot().m_lastExecutedAtom;
+    }
+    else
+    {
+      tile.FillLastExecutedAtom(eventCenter);
+    }
     u32 tableSize = EVENT_WINDOW_SITES(R);
     for(u32 i = 0; i < tableSize; i++)
     {
@@ -1,4 +1,5 @@
 #include "Camera.h"
+#include "Logger.h"
 
 #include <stdlib.h>    /* for malloc, free */
 #include <png.h>
@@ -48,6 +49,46 @@ namespace MFM
     return ret;
   }
 
+  bool Camera::StartVideo(const char * path, VideoEncoder::Format format,
+                          SDL_Surface* sfc, u32 framesPerSecond)
+  {
+    StopVideo();
+
+    if(sfc->format->BytesPerPixel != 4)
+    {
+      LOG.Error("Can't record video of a %d bit surface", sfc->format->BitsPerPixel);
+      return false;
+    }
+
+    return m_video.Open(path, format, sfc->w, sfc->h, framesPerSecond);
+  }
+
+  bool Camera::RecordVideoFrame(SDL_Surface* sfc, u32 label)
+  {
+    if(!VideoFits(sfc))
+    {
+      return false;
+    }
+
+    if(SDL_MUSTLOCK(sfc) && SDL_LockSurface(sfc) < 0)
+    {
+      return false;
+    }
+
+    bool ret = m_video.SubmitFrame((const u32*) sfc->pixels, sfc->pitch, label);
+
+    if(SDL_MUSTLOCK(sfc))
+    {
+      SDL_UnlockSurface(sfc);
+    }
+    return ret;
+  }
+
+  void Camera::StopVideo()
+  {
+    m_video.Close();
+  }
+
   // Currently unused..
   u32 Camera::GetPNGColorType(SDL_Surface* sfc)
   {
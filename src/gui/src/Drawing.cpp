@@ -144,6 +144,102 @@ namespace MFM
     }
   }
 
+  void Drawing::FillCells(const u32 * colors, u32 cols, u32 rows,
+                          int x, int y, u32 cellSize, bool circles) const
+  {
+    if (!CanFillCells())
+    {
+      FAIL(ILLEGAL_STATE);
+    }
+    if (cellSize == 0 || cellSize > MAX_CELL_SIZE)
+    {
+      FAIL(ILLEGAL_ARGUMENT);
+    }
+
+    // The pixels of each row of a cell, relative to its left edge
+    s32 spanStart[MAX_CELL_SIZE];
+    s32 spanEnd[MAX_CELL_SIZE];
+    for (u32 i = 0; i < cellSize; ++i)
+    {
+      spanStart[i] = circles ? cellSize : 0;
+      spanEnd[i] = circles ? 0 : cellSize;
+    }
+    if (circles)
+    {
+      // Same spans as FillCircle, radius rounded up
+      const s32 radius = (cellSize + 1) / 2;
+      const double center = cellSize / 2.0;
+      for (s32 dy = 1; dy <= radius; ++dy)
+      {
+        const double dx = floor(sqrt(2.0 * radius * dy - dy * dy));
+        const s32 start = (s32) floor(center - dx);
+        const s32 end = (s32) floor(center + dx);
+        const s32 lines[2] = { (s32) (center + radius - dy), (s32) (center - radius + dy) };
+        for (u32 i = 0; i < 2; ++i)
+        {
+          spanStart[lines[i]] = MIN(spanStart[lines[i]], start);
+          spanEnd[lines[i]] = MAX(spanEnd[lines[i]], end);
+        }
+      }
+    }
+
+    // Clip to the window and the surface, in surface coordinates
+    const s32 clipLeft = MAX(0, m_rect.GetX());
+    const s32 clipTop = MAX(0, m_rect.GetY());
+    const s32 clipRight = MIN(m_dest->w, (s32) (m_rect.GetX() + m_rect.GetWidth()));
+    const s32 clipBottom = MIN(m_dest->h, (s32) (m_rect.GetY() + m_rect.GetHeight()));
+    if (clipLeft >= clipRight || clipTop >= clipBottom)
+    {
+      return;
+    }
+
+    const s32 left = x + m_rect.GetX();
+    const s32 top = y + m_rect.GetY();
+
+    if (SDL_MUSTLOCK(m_dest) && SDL_LockSurface(m_dest) < 0)
+    {
+      return;
+    }
+
+    u32 * pixels = (u32 *) m_dest->pixels;
+    const u32 pitch = m_dest->pitch / sizeof(u32);
+
+    for (u32 row = 0; row < rows; ++row)
+    {
+      const u32 * rowColors = colors + row * cols;
+      for (u32 line = 0; line < cellSize; ++line)
+      {
+        const s32 py = top + row * cellSize + line;
+        if (py < clipTop || py >= clipBottom)
+        {
+          continue;
+        }
+
+        u32 * out = pixels + py * pitch;
+        for (u32 col = 0; col < cols; ++col)
+        {
+          const u32 color = rowColors[col];
+          if (!color)
+          {
+            continue;
+          }
+          const s32 cellLeft = left + col * cellSize;
+          const s32 start = MAX(clipLeft, cellLeft + spanStart[line]);
+          const s32 end = MIN(clipRight, cellLeft + spanEnd[line]);
+          for (s32 px = start; px < end; ++px)
+          {
+            out[px] = color;
+          }
+        }
+      }
+    }
+
+    if (SDL_MUSTLOCK(m_dest))
+    {
+      SDL_UnlockSurface(m_dest);
+    }
+  }
+
   void Drawing::BlitImage(SDL_Surface* src, UPoint loc, UPoint maxSize) const
   {
     if(!src)
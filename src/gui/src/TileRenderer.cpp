@@ -1,5 +1,7 @@
+#include <math.h>     /* For log10, pow */
 #include "TileRenderer.h"
 #include "EventWindow.h"
+#include "ColorMap.h"
 
 namespace MFM
 {
@@ -13,6 +15,7 @@ namespace MFM
     m_drawGrid = true;
     m_drawDataHeat = false;
     m_renderSquares = false;
+    m_renderSnapshots = false;
     m_gridColor = 0xff202020;
 
     m_hiddenColor  = 0xff353535;
@@ -24,6 +27,44 @@ namespace MFM
     m_selectedPausedColor = 0xffafafaf;
     m_windowTL.SetX(0);
     m_windowTL.SetY(0);
+
+    InitAgeColors();
+  }
+
+  void TileRenderer::InitAgeColors()
+  {
+    const u32 MAX_IDX = 10000;       // Potential (interpolated) colors
+    const double MAX_EXPT = 4.0;     // 10**4.0 == 10kAEPS for fully black
+    const double LOG_SCALER = MAX_IDX/MAX_EXPT;
+
+    for (u32 doubling = 0; doubling <= AGE_COLOR_DOUBLINGS; ++doubling)
+    {
+      for (u32 step = 0; step < AGE_COLOR_STEPS; ++step)
+      {
+        // Each entry covers ages from (1 + step/STEPS) * 2**doubling AEPS, plus one
+        double writeAgeAEPS = (1.0 + 1.0 * step / AGE_COLOR_STEPS) * pow(2.0, doubling);
+        u32 colorIndex = MIN(MAX_IDX, (u32) (LOG_SCALER*log10(writeAgeAEPS)));
+        m_ageColors[doubling * AGE_COLOR_STEPS + step] =
+          ColorMap_CubeHelixRev::THE_INSTANCE.
+          GetInterpolatedColor(colorIndex,0,MAX_IDX,0xffff0000);
+      }
+    }
+  }
+
+  u32 TileRenderer::GetAgeColor(u32 writeAge, u32 agePerAEPS) const
+  {
+    // Age in AEPS, plus one, in fixed point with STEP_BITS fraction bits
+    const u64 scaled = ((u64) writeAge * AGE_COLOR_STEPS) / agePerAEPS + AGE_COLOR_STEPS;
+    const u64 limit = (u64) AGE_COLOR_STEPS << (AGE_COLOR_DOUBLINGS + 1);
+    if (scaled >= limit)
+    {
+      return m_ageColors[AGE_COLOR_STEPS * (AGE_COLOR_DOUBLINGS + 1) - 1];
+    }
+
+    const u32 value = (u32) scaled;
+    const u32 doubling = (31 - __builtin_clz(value)) - AGE_COLOR_STEP_BITS;
+    const u32 step = (value >> doubling) - AGE_COLOR_STEPS;
+    return m_ageColors[doubling * AGE_COLOR_STEPS + step];
   }
 
   void TileRenderer::RenderAtomBG(Drawing & drawing,
@@ -32,10 +32,12 @@
 #include <sys/time.h>  /* for gettimeofday */
 #include <sys/types.h> /* for mkdir */
 #include <errno.h>     /* for errno */
+#include <string.h>    /* for strcmp */
 #include "Util.h"
 #include "Utils.h"     /* for GetDateTimeNow, Sleep */
 #include "ExternalConfig.h"
 #include "ExternalConfigFunctions.h"
+#include "GridSnapshot.h"
 #include "OverflowableCharBufferByteSink.h"
 #include "FileByteSource.h"
 #include "FileByteSink.h"
@@ -85,18 +87,6 @@ namespace MFM
      */
     typedef typename CC::ATOM_TYPE T;
 
-    /**
-     * Exported from the GridConfiguration, the enumerated width of
-     * the Grid used by this simulation.
-     */
-    enum { W = GC::GRID_WIDTH};
-
-    /**
-     * Exported from the GridConfiguration, the enumerated height of
-     * the Grid used by this simulation.
-     */
-    enum { H = GC::GRID_HEIGHT};
-
     /**
      * Exported from the GridConfiguration, the enumerated size of
      * every EventWindow used by this simulation.
@@ -108,16 +98,6 @@ namespace MFM
      */
     static const u32 EVENT_WINDOW_RADIUS = R;
 
-    /**
-     * The width of the Grid used by this simulation.
-     */
-    static const u32 GRID_WIDTH = W;
-
-    /**
-     * The height of the Grid used by this simulation.
-     */
-    static const u32 GRID_HEIGHT = H;
-
     /**
      * Template shortcut for an ElementRegistry with the correct
      * template parameters.
@@ -160,8 +140,6 @@ namespace MFM
       // Extract short names for parameter types
       typedef typename GC::CORE_CONFIG CC;
       typedef typename CC::PARAM_CONFIG P;
-      enum { W = GC::GRID_WIDTH};
-      enum { H = GC::GRID_HEIGHT};
       enum { R = P::EVENT_WINDOW_RADIUS};
 
       if(!exists)
@@ -233,6 +211,8 @@ namespace MFM
      * amount of time, letting about \c m_aepsPerFrame AEPS occur
      * before pausing. This also learns about how long an AEPS takes
      * to elapse, making subsequent calls more accurate in duration.
+     * Under --live, the Grid is left running, except at the end of an
+     * epoch, and its Tiles are asked for fresh Snapshots instead.
      *
      * @param grid The Grid which is updated during this call.
      */
@@ -241,24 +221,45 @@ namespace MFM
       const s32 ONE_THOUSAND = 1000;
       const s32 ONE_MILLION = ONE_THOUSAND*ONE_THOUSAND;
 
-      grid.Unpause();  // pausing and unpausing should be overhead!
+      if (!m_gridRunning)
+      {
+        grid.Unpause();  // pausing and unpausing should be overhead!
+        m_gridRunning = true;
 
-      u32 startMS = GetTicks();  // So get the ticks after unpausing
-      if (m_ticksLastStopped != 0)
-        m_msSpentOverhead += startMS - m_ticksLastStopped;
-      else
-        m_msSpentOverhead = 0;
+        m_ticksLastSampled = GetTicks();  // So get the ticks after unpausing
+        if (m_ticksLastStopped != 0)
+          m_msSpentOverhead += m_ticksLastSampled - m_ticksLastStopped;
+        else
+          m_msSpentOverhead = 0;
+      }
 
-      Sleep(m_microsSleepPerFrame/ONE_MILLION,
-            (u64) (m_microsSleepPerFrame%ONE_MILLION)*ONE_THOUSAND);
+      u32 startMS = m_ticksLastSampled;
 
-      m_ticksLastStopped = GetTicks(); // and before pausing
+      if (grid.IsSerialExecution())
+      {
+        // Nothing runs in the background; do exactly a frame's worth
+        grid.ExecuteSerialEvents((u64) m_aepsPerFrame * grid.GetTotalSites());
+      }
+      else
+      {
+        Sleep(m_microsSleepPerFrame/ONE_MILLION,
+              (u64) (m_microsSleepPerFrame%ONE_MILLION)*ONE_THOUSAND);
+      }
 
-      grid.Pause();
+      m_ticksLastSampled = GetTicks();
 
-      u32 thisPeriodMS = m_ticksLastStopped - startMS;
+      u32 thisPeriodMS = m_ticksLastSampled - startMS;
       m_msSpentRunning += thisPeriodMS;
 
+      if (m_liveDisplay)
+      {
+        grid.RequestSnapshots();  // For next frame; these show last frame's
+      }
+      else
+      {
+        PauseGrid();
+      }
+
       u64 totalEvents = grid.GetTotalEventsExecuted();
       u32 totalSites = grid.GetTotalSites();
       m_AEPS = totalEvents / totalSites;
@@ -293,6 +294,36 @@ namespace MFM
       PostUpdate();
     }
 
+    /**
+     * Pauses the held Grid if UpdateGrid left it running, as it does
+     * under --live.  Anything that changes or saves the Grid, or
+     * reads it other than through its Snapshots, must call this
+     * first.  The next UpdateGrid resumes the Grid.
+     */
+    void PauseGrid()
+    {
+      if (!m_gridRunning)
+      {
+        return;
+      }
+
+      m_ticksLastStopped = GetTicks(); // and before pausing
+      m_msSpentRunning += m_ticksLastStopped - m_ticksLastSampled;
+      m_ticksLastSampled = m_ticksLastStopped;
+
+      m_grid.Pause();
+      m_gridRunning = false;
+    }
+
+    /**
+     * Returns true if the held Grid is left running between calls to
+     * UpdateGrid, with its state displayed from Snapshots.
+     */
+    bool IsLiveDisplay() const
+    {
+      return m_liveDisplay;
+    }
+
     /**
      * Subtracts \c m_aepsPerFrame (or, the number of AEPS which
      * should elapse every call to \c UpdateGrid() ) by one, keeping it
@@ -446,6 +477,7 @@ namespace MFM
           running = false;
         }
       }
+      PauseGrid();
     }
 
     void SetAEPSPerEpoch(u32 aeps)
@@ -465,6 +497,16 @@ namespace MFM
     OurGrid m_grid;
 
     u32 m_ticksLastStopped;
+
+    /** When m_msSpentRunning was last brought up to date */
+    u32 m_ticksLastSampled;
+
+    /** True if UpdateGrid left the Grid running */
+    bool m_gridRunning;
+
+    /** If true, UpdateGrid leaves the Grid running; see --live */
+    bool m_liveDisplay;
+
     u32 m_haltAfterAEPS;
 
     u64 m_startTimeMS;
@@ -477,6 +519,20 @@ namespace MFM
 
     s32 m_AEPSPerEpoch;
     u32 m_autosavePerEpochs;
+    bool m_binarySaves;
+
+    /**
+     * If nonzero, autosaves are a chain of checkpoints, with a full
+     * snapshot every m_autosavesPerFullCheckpoint autosaves and
+     * deltas holding only the changed Tiles in between.
+     */
+    u32 m_autosavesPerFullCheckpoint;
+    typename GridSnapshot<GC>::Checkpoint m_lastCheckpoint;
+
+    /**
+     * If non-null, Run just saves the loaded grid here and returns.
+     */
+    const char* m_reconstructPath;
     u32 m_accelerateAfterEpochs;
     u32 m_acceleration;
     u32 m_surgeAfterEpochs;
@@ -583,6 +639,34 @@ namespace MFM
       driver.m_autosavePerEpochs = val;
     }
 
+    static void SetBinarySavesFromArgs(const char* not_used, void* driverptr)
+    {
+      AbstractDriver& driver = *((AbstractDriver*)driverptr);
+
+      driver.m_binarySaves = true;
+    }
+
+    static void SetCheckpointsFromArgs(const char* arg, void* driverptr)
+    {
+      AbstractDriver& driver = *((AbstractDriver*)driverptr);
+      VArguments& args = driver.m_varguments;
+
+      s32 val = atoi(arg);
+      if (val <= 0 || (u32) val > GridSnapshot<GC>::MAX_CHAIN_LENGTH)
+      {
+        args.Die("Autosaves per full checkpoint must be 1..%d, not %d",
+                 GridSnapshot<GC>::MAX_CHAIN_LENGTH, val);
+      }
+      driver.m_autosavesPerFullCheckpoint = (u32) val;
+    }
+
+    static void SetReconstructPathFromArgs(const char* path, void* driverptr)
+    {
+      AbstractDriver& driver = *((AbstractDriver*)driverptr);
+
+      driver.m_reconstructPath = path;
+    }
+
     static void SetPicturesPerRateFromArgs(const char* aeps, void* driverptr)
     {
       AbstractDriver* driver = (AbstractDriver*)driverptr;
@@ -676,6 +760,105 @@ namespace MFM
       ++driver.m_configurationPathCount;
     }
 
+    static void SetWorkerThreadsFromArgs(const char* countStr, void* driverptr)
+    {
+      AbstractDriver& driver = *((AbstractDriver*)driverptr);
+      VArguments& args = driver.m_varguments;
+
+      s32 count = atoi(countStr);
+      if (count < 0)
+      {
+        args.Die("Worker thread count must be non-negative, not %d", count);
+      }
+      if (driver.GetGrid().IsSerialExecution())
+      {
+        args.Die("Can't use worker threads with serial execution");
+      }
+      driver.GetGrid().SetWorkerThreads((u32) count);
+    }
+
+    static void SetWorkerBatchEventsFromArgs(const char* countStr, void* driverptr)
+    {
+      AbstractDriver& driver = *((AbstractDriver*)driverptr);
+      VArguments& args = driver.m_varguments;
+
+      s32 count = atoi(countStr);
+      if (count < 1)
+      {
+        args.Die("Worker batch events must be positive, not %d", count);
+      }
+      driver.GetGrid().SetWorkerBatchEvents((u32) count);
+    }
+
+    static void SetGridSizeFromArgs(const char* sizeStr, void* driverptr)
+    {
+      AbstractDriver& driver = *((AbstractDriver*)driverptr);
+      VArguments& args = driver.m_varguments;
+
+      u32 width, height;
+      char extra;
+      if (sscanf(sizeStr, "%ux%u%c", &width, &height, &extra) != 2)
+      {
+        args.Die("Grid size must be WIDTHxHEIGHT in tiles, not '%s'", sizeStr);
+      }
+
+      const u32 maxTiles = OurGrid::MAX_TILES;
+      if (width == 0 || height == 0 || width > maxTiles || height > maxTiles ||
+          width * height > maxTiles)
+      {
+        args.Die("Grid must have 1..%d tiles, not %dx%d", maxTiles, width, height);
+      }
+      driver.GetGrid().SetDimensions(width, height);
+    }
+
+    static void SetSerialExecutionFromArgs(const char* not_used, void* driverptr)
+    {
+      AbstractDriver& driver = *((AbstractDriver*)driverptr);
+      VArguments& args = driver.m_varguments;
+
+      if (driver.GetGrid().IsUsingWorkerThreads())
+      {
+        args.Die("Can't use serial execution with worker threads");
+      }
+      driver.GetGrid().SetSerialExecution(true);
+    }
+
+    static void SetSparseEventsFromArgs(const char* not_used, void* driverptr)
+    {
+      AbstractDriver& driver = *((AbstractDriver*)driverptr);
+
+      driver.GetGrid().SetSparseEvents(true);
+    }
+
+    static void SetEventBatchSizeFromArgs(const char* sizeStr, void* driverptr)
+    {
+      AbstractDriver& driver = *((AbstractDriver*)driverptr);
+      VArguments& args = driver.m_varguments;
+
+      const s32 maxSize = Tile<CC>::MAX_EVENT_BATCH;
+      s32 size = atoi(sizeStr);
+      if (size < 1 || size > maxSize)
+      {
+        args.Die("Event batch size must be 1..%d, not %d", maxSize, size);
+      }
+      driver.GetGrid().SetEventBatchSize((u32) size);
+    }
+
+    static void SetThreadPinningFromArgs(const char* not_used, void* driverptr)
+    {
+      AbstractDriver& driver = *((AbstractDriver*)driverptr);
+
+      driver.GetGrid().SetThreadPinning(true);
+    }
+
+    static void SetLiveDisplayFromArgs(const char* not_used, void* driverptr)
+    {
+      AbstractDriver& driver = *((AbstractDriver*)driverptr);
+
+      driver.m_liveDisplay = true;
+      driver.GetGrid().SetPublishingSnapshots(true);
+    }
+
     static void SetIgnoreThreadingProblems(const char* not_used, void* driverptr)
     {
       AbstractDriver& driver = *((AbstractDriver*)driverptr);
@@ -691,6 +874,7 @@ namespace MFM
       {
         if (m_AEPS >= m_nextEpochAEPS)
         {
+          PauseGrid();
           DoEpochEvents(grid, m_epochCount, m_nextEpochAEPS);
           m_nextEpochAEPS += m_AEPSPerEpoch;
           ++m_epochCount;
@@ -701,15 +885,50 @@ namespace MFM
   public:
     void AutosaveGrid(u32 epochs)
     {
+      if (m_autosavesPerFullCheckpoint > 0)
+      {
+        const char* filename =
+          GetSimDirPathTemporary("autosave/%D-%D.mfb", epochs, (u32) m_AEPS);
+        LOG.Message("Checkpointing to: %s", filename);
+        GridSnapshot<GC> snap(this->GetGrid());
+        snap.WriteCheckpoint(filename, m_lastCheckpoint, m_autosavesPerFullCheckpoint - 1);
+        return;
+      }
+
       const char* filename =
-        GetSimDirPathTemporary("autosave/%D-%D.mfs", epochs, (u32) m_AEPS);
+        GetSimDirPathTemporary("autosave/%D-%D.%s", epochs, (u32) m_AEPS,
+                               GetSaveExtension());
       SaveGrid(filename);
     }
 
+    /**
+     * Gets the filename extension, without the dot, for saves made
+     * by this driver: "mfb" for binary snapshots or "mfs" for text
+     * configurations.
+     */
+    const char* GetSaveExtension() const
+    {
+      return m_binarySaves ? "mfb" : "mfs";
+    }
+
+    /**
+     * Saves the grid to \c filename, as a GridSnapshot if the name
+     * ends in ".mfb" or else as a text configuration.
+     */
     void SaveGrid(const char* filename)
     {
+      PauseGrid();
 
       LOG.Message("Saving to: %s", filename);
+
+      const u32 len = strlen(filename);
+      if (len > 4 && !strcmp(filename + len - 4, ".mfb"))
+      {
+        GridSnapshot<GC> snap(this->GetGrid());
+        snap.Write(filename);
+        return;
+      }
+
       ExternalConfig<GC> cfg(this->GetGrid());
       FILE* fp = fopen(filename, "w");
       FileByteSink fs(fp);
@@ -765,10 +984,22 @@ namespace MFM
         return;
       }
 
+      PauseGrid();
+
       const char * path = m_configurationPaths[m_currentConfigurationPath];
 
       LOG.Debug("Loading configuration from %s...", path);
 
+      if (GridSnapshot<GC>::IsSnapshotFile(path))
+      {
+        GridSnapshot<GC> snap(GetGrid());
+        if (!snap.Read(path))
+        {
+          LOG.Error("Can't load snapshot '%s'", path);
+        }
+        return;
+      }
+
       ExternalConfig<GC> cfg(GetGrid());
       RegisterExternalConfigFunctions<GC>(cfg);
       FileByteSource fs(path);
@@ -789,8 +1020,9 @@ namespace MFM
 
 
     /**
-     * Method to do end-of-epoch processing.  Base class recounts the
-     * grid and handles --gridImage and --tileImage processing here,
+     * Method to do end-of-epoch processing.  Base class has the grid
+     * check its atom counts, in the tiles' own threads, and handles
+     * --gridImage and --tileImage processing here,
      * so all subclasses should override this method and do
      * Super::DoEpochEvents to ensure all methods are called.
      */
@@ -800,7 +1032,7 @@ namespace MFM
 
       grid.CheckCaches();
 
-      grid.RecountAtoms();
+      grid.CheckAtomCounts();
 
       if (m_gridImages)
       {
@@ -845,6 +1077,9 @@ namespace MFM
       m_neededElementCount(0),
       m_grid(m_elementRegistry),
       m_ticksLastStopped(0),
+      m_ticksLastSampled(0),
+      m_gridRunning(false),
+      m_liveDisplay(false),
       m_haltAfterAEPS(0),
       m_startTimeMS(0),
       m_msSpentRunning(0),
@@ -854,6 +1089,9 @@ namespace MFM
       m_aepsPerFrame(INITIAL_AEPS_PER_FRAME),
       m_AEPSPerEpoch(100),
       m_autosavePerEpochs(1),
+      m_binarySaves(false),
+      m_autosavesPerFullCheckpoint(0),
+      m_reconstructPath(0),
       m_accelerateAfterEpochs(0),
       m_acceleration(1),
       m_surgeAfterEpochs(0),
@@ -934,6 +1172,15 @@ namespace MFM
       RegisterArgument("Autosave grid every ARG epochs (default 1; 0 for never)",
                        "-a|--autosave", &SetAutosavePerEpochsFromArgs, this, true);
 
+      RegisterArgument("Save and autosave as binary snapshots (.mfb), not text (.mfs)",
+                       "--binarysaves", &SetBinarySavesFromArgs, this, false);
+
+      RegisterArgument("Autosave only changed tiles, with a full snapshot every ARG autosaves",
+                       "--checkpoints", &SetCheckpointsFromArgs, this, true);
+
+      RegisterArgument("Save the grid loaded by -cp (which may be a checkpoint) to ARG, and exit",
+                       "--reconstruct", &SetReconstructPathFromArgs, this, true);
+
       this->RegisterArgument("Increase the epoch length every ARG epochs",
                              "--accelerate",
                              &SetPicturesPerRateFromArgs, this, true);
@@ -960,6 +1207,30 @@ namespace MFM
       RegisterArgument("Load initial configuration from file at path ARG (string)",
                        "-cp|--configpath", &LoadFromConfigFile, this, true);
 
+      RegisterArgument("Use a grid of ARG tiles, given as WIDTHxHEIGHT, rather than the default size",
+                       "--gridsize", &SetGridSizeFromArgs, this, true);
+
+      RegisterArgument("Run tiles on a pool of ARG worker threads, not a thread per tile (0 -> per core)",
+                       "-w|--workers", &SetWorkerThreadsFromArgs, this, true);
+
+      RegisterArgument("Have each worker thread run ARG events per tile it claims (default 100)",
+                       "--workerevents", &SetWorkerBatchEventsFromArgs, this, true);
+
+      RegisterArgument("Pin threads to CPUs, keeping neighboring tiles on the same socket",
+                       "--pin", &SetThreadPinningFromArgs, this, false);
+
+      RegisterArgument("Keep the grid running between frames; display it from per-tile snapshots",
+                       "--live", &SetLiveDisplayFromArgs, this, false);
+
+      RegisterArgument("Run all events on one thread in seeded order, for reproducible runs",
+                       "--serial", &SetSerialExecutionFromArgs, this, false);
+
+      RegisterArgument("Run events only at non-empty sites, counting the skipped ones toward AEPS",
+                       "--sparse", &SetSparseEventsFromArgs, this, false);
+
+      RegisterArgument("Have each tile choose ARG event sites at once, running hidden ones first and sharing locks (1..128)",
+                       "--eventbatch", &SetEventBatchSizeFromArgs, this, true);
+
       RegisterArgument("Continue execution after detected thread failures",
                        "--ignorethreadbugs", &SetIgnoreThreadingProblems,
                        this, false);
@@ -1025,6 +1296,8 @@ namespace MFM
 
     void Reinit()
     {
+      PauseGrid();
+
       m_lastFrameAEPS = 0;
 
       ReinitUs();
@@ -1051,7 +1324,14 @@ namespace MFM
         abort();
        },
        {
-         RunHelper();
+         if (m_reconstructPath)
+         {
+           SaveGrid(m_reconstructPath);
+         }
+         else
+         {
+           RunHelper();
+         }
        });
     }
   };
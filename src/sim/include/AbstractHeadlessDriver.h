@@ -39,9 +39,13 @@
 #include "Element_Empty.h" /* Need common elements */
 #include "VArguments.h"
 #include "AbstractDriver.h"
+#include "GridRasterizer.h"
 
 namespace MFM
 {
+  /* Playback rate of --frames videos, at one frame per capture */
+#define FRAME_IMAGES_PER_SECOND 30
+
   /**
    * A class representing a headless driver, i.e. a driver which works
    * only on the command line without input.
@@ -55,22 +59,115 @@ namespace MFM
     typedef typename Super::OurGrid OurGrid;
     typedef typename Super::CC CC;
 
-    AbstractHeadlessDriver() : AbstractDriver<GC>()
+    AbstractHeadlessDriver() :
+      AbstractDriver<GC>(),
+      m_rasterizer(Super::GetGrid()),
+      m_frameOutput(GridRasterizer<GC>::OUTPUT_DELTA),
+      m_framePixelsPerSite(2),
+      m_aepsPerFrameImage(0),
+      m_nextFrameImageAEPS(0)
     { }
 
     virtual void AddDriverArguments()
     {
       Super::AddDriverArguments();
+
+      this->RegisterSection("Headless switches");
+
+      this->RegisterArgument("Every ARG AEPS, capture an image of the grid to the per-sim vid/ directory",
+                             "--frames", &SetAEPSPerFrameImageFromArgs, this, true);
+
+      this->RegisterArgument("Write --frames images in format ARG: delta (default), y4m, or ppm",
+                             "--frameformat", &SetFrameOutputFromArgs, this, true);
+
+      this->RegisterArgument("Draw each site as ARG by ARG pixels in --frames images (default 2)",
+                             "--framescale", &SetFramePixelsPerSiteFromArgs, this, true);
     }
 
     virtual void OnceOnly(VArguments& args)
     {
       Super::OnceOnly(args);
+
+      if (m_aepsPerFrameImage > 0)
+      {
+        const char * dir = Super::GetSimDirPathTemporary("vid");
+        if (!m_rasterizer.Start(dir, m_frameOutput, m_framePixelsPerSite,
+                                FRAME_IMAGES_PER_SECOND))
+        {
+          args.Die("Couldn't start writing grid images to '%s'", dir);
+        }
+      }
     }
 
     virtual void PostUpdate()
     {
-      LOG.Debug("AEPS: %d", (u32)Super::GetAEPS());
+      const u32 aeps = (u32) Super::GetAEPS();
+      LOG.Debug("AEPS: %d", aeps);
+
+      if (m_aepsPerFrameImage > 0 && aeps >= m_nextFrameImageAEPS)
+      {
+        // The Grid is paused here, or under --live, reading Snapshots
+        m_rasterizer.Capture(aeps);
+        m_nextFrameImageAEPS = (aeps / m_aepsPerFrameImage + 1) * m_aepsPerFrameImage;
+      }
+    }
+
+    virtual void ReinitUs()
+    {
+      Super::ReinitUs();
+
+      // Captures must be colored by the Elements they were taken with
+      m_rasterizer.Flush();
+    }
+
+    virtual void RunHelper()
+    {
+      Super::RunHelper();
+
+      m_rasterizer.Stop();
+    }
+
+  private:
+    GridRasterizer<GC> m_rasterizer;
+    typename GridRasterizer<GC>::Output m_frameOutput;
+    u32 m_framePixelsPerSite;
+    u32 m_aepsPerFrameImage;
+    u32 m_nextFrameImageAEPS;
+
+    static void SetAEPSPerFrameImageFromArgs(const char* aeps, void* driverptr)
+    {
+      AbstractHeadlessDriver& driver = *((AbstractHeadlessDriver*)driverptr);
+
+      s32 value = atoi(aeps);
+      if (value <= 0)
+      {
+        driver.GetVArguments().Die("AEPS per grid image must be positive, not '%s'", aeps);
+      }
+      driver.m_aepsPerFrameImage = (u32) value;
+    }
+
+    static void SetFrameOutputFromArgs(const char* format, void* driverptr)
+    {
+      AbstractHeadlessDriver& driver = *((AbstractHeadlessDriver*)driverptr);
+
+      if (!GridRasterizer<GC>::ParseOutput(format, driver.m_frameOutput))
+      {
+        driver.GetVArguments().Die("Grid image format must be delta, y4m, or ppm, not '%s'",
+                                   format);
+      }
+    }
+
+    static void SetFramePixelsPerSiteFromArgs(const char* pixels, void* driverptr)
+    {
+      AbstractHeadlessDriver& driver = *((AbstractHeadlessDriver*)driverptr);
+
+      s32 value = atoi(pixels);
+      if (value <= 0 || value > (s32) GridRasterizer<GC>::MAX_PIXELS_PER_SITE)
+      {
+        driver.GetVArguments().Die("Grid image scale must be 1..%d, not '%s'",
+                                   GridRasterizer<GC>::MAX_PIXELS_PER_SITE, pixels);
+      }
+      driver.m_framePixelsPerSite = (u32) value;
     }
   };
 }
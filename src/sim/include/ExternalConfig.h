@@ -77,6 +77,14 @@ namespace MFM
      */
     void Write(ByteSink & byteSink);
 
+    /**
+     * Writes just the element registrations and element parameters
+     * of the current grid configuration to the given \a ByteSink.
+     * The element registered as nickname IntLexEncode(i) is entry \c
+     * i of the grid's ElementRegistry.
+     */
+    void WriteElements(ByteSink & byteSink);
+
     void RegisterFunction(ConfigFunctionCall<GC> & fc) ;
 
     bool RegisterElement(const UUID & uuid, OString16 & nick) ;
@@ -94,6 +102,11 @@ namespace MFM
       return m_in;
     }
 
+    Grid<GC> & GetGrid()
+    {
+      return m_grid;
+    }
+
   private:
     LineCountingByteSource m_in;
     ByteSink * m_errorsTo;
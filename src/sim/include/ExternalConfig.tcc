@@ -80,10 +80,8 @@ namespace MFM
   }
 
   template<class GC>
-  void ExternalConfig<GC>::Write(ByteSink& byteSink)
+  void ExternalConfig<GC>::WriteElements(ByteSink& byteSink)
   {
-    /* First, register all elements. */
-
     u32 elems = m_elementRegistry.GetEntryCount();
     char lexOutput[24];
 
@@ -113,20 +111,24 @@ namespace MFM
         byteSink.WriteNewline();
       }
     }
+  }
+
+  template<class GC>
+  void ExternalConfig<GC>::Write(ByteSink& byteSink)
+  {
+    /* First, register all elements. */
+
+    WriteElements(byteSink);
     byteSink.WriteNewline();
 
     /* Then, GA all live atoms. */
 
-    /* The grid size in sites excluding caches */
-    const u32 gridWidth = CC::PARAM_CONFIG::TILE_WIDTH *
-      GC::GRID_WIDTH -
-      CC::PARAM_CONFIG::EVENT_WINDOW_RADIUS *
-      GC::GRID_WIDTH * 2;
+    u32 elems = m_elementRegistry.GetEntryCount();
+    char lexOutput[24];
 
-    const u32 gridHeight = CC::PARAM_CONFIG::TILE_WIDTH *
-      GC::GRID_HEIGHT -
-      CC::PARAM_CONFIG::EVENT_WINDOW_RADIUS *
-      GC::GRID_HEIGHT * 2;
+    /* The grid size in sites excluding caches */
+    const u32 gridWidth = m_grid.GetWidthSites();
+    const u32 gridHeight = m_grid.GetHeightSites();
 
     for(u32 y = 0; y < gridHeight; y++)
     {
@@ -161,9 +163,9 @@ namespace MFM
     byteSink.WriteNewline();
 
     /* Set Tile geometry */
-    for(u32 y = 0; y < GC::GRID_HEIGHT; y++)
+    for(u32 y = 0; y < m_grid.GetHeight(); y++)
     {
-      for(u32 x = 0; x < GC::GRID_WIDTH; x++)
+      for(u32 x = 0; x < m_grid.GetWidth(); x++)
       {
         SPoint currentPt(x, y);
 
@@ -98,6 +98,15 @@ namespace MFM
         return in.Msg(Logger::ERROR, "Expected y position");
       }
 
+      // Grid sizes vary by run, so a config may not fit this one
+      Grid<GC> & grid = ec.GetGrid();
+      if (x < 0 || y < 0 ||
+          (u32) x >= grid.GetWidthSites() || (u32) y >= grid.GetHeightSites())
+      {
+        return in.Msg(Logger::ERROR, "(%d,%d) is outside this %dx%d grid",
+                      x, y, grid.GetWidthSites(), grid.GetHeightSites());
+      }
+
       if (!this->SkipToNextExistingArg(in, "atom body"))
       {
         return false;
@@ -31,9 +31,11 @@
 #include "itype.h"
 #include "Tile.h"
 #include "ElementTable.h"
+#include "ElementDispatch.h"
 #include "Random.h"
 #include "GridConfig.h"
 #include "ElementRegistry.h"
+#include "TileScheduler.h"
 #include "Logger.h"
 
 #include "Element_Wall.h"
@@ -50,10 +52,11 @@ namespace MFM {
     typedef typename GC::CORE_CONFIG CC;
     typedef typename CC::ATOM_TYPE T;
     typedef typename CC::PARAM_CONFIG P;
-    enum { W = GC::GRID_WIDTH};
-    enum { H = GC::GRID_HEIGHT};
     enum { R = P::EVENT_WINDOW_RADIUS};
 
+    static const u32 PAGE_BYTES = 4096;
+    static const u32 HUGE_PAGE_BYTES = 2 * 1024 * 1024;
+
   private:
     Random m_random;
 
@@ -61,22 +64,144 @@ namespace MFM {
 
     void ReinitSeed();
 
-    const u32 m_width, m_height;
+    u32 m_width, m_height;
 
     SPoint m_lastEventTile;
 
-    Tile<CC> m_tiles[W][H];
+    /**
+     * Our m_width * m_height Tiles, column by column.  Each is a
+     * separate page-aligned block (huge-page-aligned, if big enough),
+     * so Tiles never share pages, and each can be first touched by
+     * the thread that will run it.
+     */
+    Tile<CC> ** m_tiles;
+
+    /**
+     * Allocates and constructs \c width by \c height Tiles, blank
+     * but for this Grid's Tile settings.  Under SetThreadPinning, each
+     * Tile's pages are first touched by a thread pinned to that Tile's
+     * CPU, so the kernel places them on that CPU's NUMA node.  FAILs
+     * with OUT_OF_RESOURCES if memory runs out.
+     */
+    void AllocateTiles(u32 width, u32 height);
+
+    /**
+     * Gets the CPUs our threads are pinned across, ordered by
+     * CoreAffinity::GetCPUsBySocket, or none if pinning is off or the
+     * CPUs can't be determined.
+     */
+    u32 GetPinningCPUs(u32 * cpus) const;
+
+    /**
+     * Gets the CPU, of \c cpuCount \c cpus from GetPinningCPUs, that
+     * the Tile at (\c x, \c y) of a \c width by \c height Grid runs
+     * on, or -1 if there are none.
+     */
+    static s32 CPUForTile(const u32 * cpus, u32 cpuCount, u32 x, u32 y, u32 width, u32 height)
+    {
+      if (cpuCount == 0)
+      {
+        return -1;
+      }
+      return cpus[CoreAffinity::IndexForGridLocation(x, y, width, height, cpuCount)];
+    }
+
+    /** A block of memory to be first touched from a given CPU */
+    struct FirstTouchJob
+    {
+      void * m_block;
+      u32 m_bytes;
+      s32 m_cpu;
+    };
+
+    static void * FirstTouchThreadHelper(void * jobPtr) ;
+
+    /**
+     * Destroys and frees our Tiles, unless any Tile thread has been
+     * started; those are never joined, so their Tiles are left to
+     * them.
+     */
+    void FreeTiles();
+
+    /** The most threads RecountAtoms will share the Tiles among */
+    static const u32 MAX_RECOUNT_THREADS = 16;
+
+    /** Tiles claimed, by index, by the threads of one RecountAtoms */
+    struct RecountJob
+    {
+      Grid * m_grid;
+      u32 m_nextTile;
+    };
+
+    /** Recounts Tiles from \c job until none are left unclaimed */
+    static void RecountTiles(RecountJob & job) ;
+
+    static void * RecountThreadHelper(void * jobPtr) ;
+
+    // Declare away copy ctor; our Tiles are ours alone
+    Grid(const Grid &) ;
 
     bool m_backgroundRadiationEnabled;
 
     ElementRegistry<CC> m_er;
 
+    /**
+     * Every Needed Element by type, shared by all our Tiles'
+     * ElementTables for event dispatch.
+     */
+    ElementDispatch<CC> m_dispatch;
+
     s32 m_xraySiteOdds;
 
     u8 m_gridGeneration;
 
     bool m_ignoreThreadingProblems;
 
+    /**
+     * True if SetThreadPinning(true) has been called.
+     */
+    bool m_threadPinning;
+
+    /**
+     * The worker pool running our Tiles, if SetWorkerThreads has been
+     * called.  Otherwise each Tile runs on its own thread.
+     */
+    TileScheduler<GC> m_scheduler;
+
+    /**
+     * If true, all events are run by ExecuteSerialEvents, on the
+     * caller's thread, rather than by any Tile or worker threads.
+     */
+    bool m_serialExecution;
+
+    /**
+     * True once the Tiles have been set up for serial execution.
+     */
+    bool m_serialStarted;
+
+    /**
+     * If true, the Tiles publish Snapshots for others to read while
+     * this Grid runs.
+     */
+    bool m_publishingSnapshots;
+
+    /**
+     * If true, the Tiles run events only at non-empty sites; see
+     * Tile::SetSparseEvents.
+     */
+    bool m_sparseEvents;
+
+    /**
+     * How many events each Tile runs at a time; see
+     * Tile::SetEventBatchSize.
+     */
+    u32 m_eventBatchSize;
+
+    /**
+     * True between Unpause and Pause, except under serial execution.
+     */
+    bool m_running;
+
     /**
      * A synchronized command sequence to the grid
      */
@@ -157,36 +282,187 @@ namespace MFM {
 
     void SetSeed(u32 seed);
 
+    /**
+     * The most Tiles a Grid may have.
+     */
+    static const u32 MAX_TILES = 4096;
+
+    /**
+     * Constructs a Grid of GC::GRID_WIDTH by GC::GRID_HEIGHT Tiles;
+     * see SetDimensions.
+     */
     Grid(ElementRegistry<CC>& elts) :
       m_seed(0),
-      m_width(W),
-      m_height(H),
+      m_width(0),
+      m_height(0),
+      m_tiles(0),
       m_er(elts),
       m_xraySiteOdds(1000),
       m_gridGeneration(0),
-      m_ignoreThreadingProblems(false)
+      m_ignoreThreadingProblems(false),
+      m_threadPinning(false),
+      m_scheduler(*this),
+      m_serialExecution(false),
+      m_serialStarted(false),
+      m_publishingSnapshots(false),
+      m_sparseEvents(false),
+      m_eventBatchSize(1),
+      m_running(false)
     {
-      for (u32 y = 0; y < H; ++y)
-      {
-        for (u32 x = 0; x < W; ++x)
-        {
-          LOG.Debug("Tile[%d][%d] @ %p", x, y, &m_tiles[x][y]);
-        }
-      }
+      AllocateTiles(GC::GRID_WIDTH, GC::GRID_HEIGHT);
     }
 
+    /**
+     * Replaces this Grid's Tiles with \c width by \c height new ones,
+     * at least one and at most MAX_TILES in all.  The new Tiles are
+     * blank, so call this before Reinit.  FAILs with ILLEGAL_ARGUMENT
+     * if the dimensions are out of range, and with ILLEGAL_STATE if
+     * any events have run under serial execution or worker threads,
+     * or any Tile thread has started.
+     */
+    void SetDimensions(u32 width, u32 height);
+
     void SetIgnoreThreadingProblems(bool value)
     {
       m_ignoreThreadingProblems = value;
-      for(u32 x = 0; x < W; x++)
+      for(u32 x = 0; x < m_width; x++)
       {
-        for(u32 y = 0; y < H; y++)
+        for(u32 y = 0; y < m_height; y++)
         {
           GetTile(x, y).SetIgnoreThreadingProblems(value);
         }
       }
     }
 
+    /**
+     * Runs this Grid's Tiles on a pool of \c count worker threads
+     * (0 meaning one per online processor), rather than on one thread
+     * per Tile.  Must be called before the Grid is first unpaused.
+     *
+     * @sa TileScheduler
+     */
+    void SetWorkerThreads(u32 count)
+    {
+      m_scheduler.SetWorkerCount(count);
+    }
+
+    /**
+     * Sets how many events each worker thread runs on a Tile each
+     * time it claims one; see TileScheduler::SetEventsPerBatch.  Must
+     * be called before the Grid is first unpaused.
+     */
+    void SetWorkerBatchEvents(u32 count)
+    {
+      m_scheduler.SetEventsPerBatch(count);
+    }
+
+    /**
+     * Returns true if this Grid runs on a worker pool rather than on
+     * one thread per Tile.
+     */
+    bool IsUsingWorkerThreads() const
+    {
+      return m_scheduler.GetWorkerCount() > 0;
+    }
+
+    /**
+     * If \c value is true, pins each Tile thread (or each worker
+     * thread, under SetWorkerThreads) to its own CPU, laid out so
+     * that threads for neighboring Tiles share a socket.  Turning
+     * pinning on reallocates the Tiles, blank, as SetDimensions does,
+     * so that each Tile's memory is first touched from its own CPU;
+     * so call this before setting the Tiles up.  FAILs with
+     * ILLEGAL_STATE once the Grid has run.
+     */
+    void SetThreadPinning(bool value);
+
+    /**
+     * Runs all of this Grid's events serially, via
+     * ExecuteSerialEvents, with no threads, locks, or Packets.  Must
+     * be called before any events have run.
+     */
+    void SetSerialExecution(bool value)
+    {
+      if (m_serialStarted || m_scheduler.IsStarted())
+      {
+        FAIL(ILLEGAL_STATE);
+      }
+      m_serialExecution = value;
+    }
+
+    bool IsSerialExecution() const
+    {
+      return m_serialExecution;
+    }
+
+    /**
+     * Sets whether this Grid's Tiles skip events at empty sites,
+     * counting them as executed without running them; see
+     * Tile::SetSparseEvents.  Persists across Reinit.  Must be called
+     * while the Grid is paused.
+     */
+    void SetSparseEvents(bool value);
+
+    bool IsSparseEvents() const
+    {
+      return m_sparseEvents;
+    }
+
+    /**
+     * Sets how many events each of this Grid's Tiles runs at a time;
+     * see Tile::SetEventBatchSize.  Persists across Reinit.  Must be
+     * called while the Grid is paused.
+     */
+    void SetEventBatchSize(u32 size);
+
+    u32 GetEventBatchSize() const
+    {
+      return m_eventBatchSize;
+    }
+
+    /**
+     * If \c value is true, this Grid's Tiles publish Snapshots (see
+     * Tile::RequestSnapshot) so that its Atoms and statistics can be
+     * displayed without pausing it.  While such a Grid runs,
+     * GetAtomCount and GetTotalEventsExecuted report the state as of
+     * the latest Snapshots, and RequestSnapshots asks for new ones.
+     * The Tiles' Snapshots are allocated when \c value is first
+     * true, so this Grid must then be paused.
+     */
+    void SetPublishingSnapshots(bool value) ;
+
+    bool IsPublishingSnapshots() const
+    {
+      return m_publishingSnapshots;
+    }
+
+    /**
+     * Returns true if readers of this Grid's state must use its
+     * Tiles' Snapshots, because it is publishing them and running.
+     */
+    bool IsReadingSnapshots() const
+    {
+      return m_publishingSnapshots && m_running;
+    }
+
+    /**
+     * Brings every Tile's Snapshot up to date: at once if this Grid
+     * is paused, or else by asking each Tile to publish one between
+     * its events.  Must not be called while any Snapshot reference is
+     * in use.
+     */
+    void RequestSnapshots();
+
+    /**
+     * Executes \c count events on the calling thread, each in a Tile
+     * chosen using this Grid's PRNG.  The same seed and the same
+     * sequence of calls therefore always produce the same Grid.
+     * Under SetSparseEvents, events skipped at empty sites count
+     * toward \c count.  FAILs with ILLEGAL_STATE unless
+     * SetSerialExecution(true) has been called.
+     */
+    void ExecuteSerialEvents(u64 count);
+
     s32* GetXraySiteOddsPtr()
     {
       return &m_xraySiteOdds;
@@ -196,7 +472,8 @@ namespace MFM {
 
     const Element<CC> * LookupElement(u32 elementType) const
     {
-      return m_tiles[0][0].GetElementTable().Lookup(elementType);
+      const Element<CC> * elt = m_dispatch.Lookup(elementType);
+      return elt ? elt : GetTile(0, 0).GetElementTable().Lookup(elementType);
     }
 
     ElementRegistry<CC>& GetElementRegistry()
@@ -208,14 +485,31 @@ namespace MFM {
     {
       anElement.AllocateType();         // Force a type now
       m_er.RegisterElement(anElement);  // Make sure we're in here (How could we not?)
-
-      for(u32 i = 0; i < W; i++)
+      m_dispatch.Insert(anElement);
+
+      // Allocate its data now, in the same order in every Tile, so it
+      // lands at the same offset in each; see SumElementData
+      const u32 type = anElement.GetType();
+      const u32 slots = anElement.GetElementDataSlotCount();
+      bool allocated = true;
+      for(u32 i = 0; i < m_width; i++)
       {
-        for(u32 j = 0; j < H; j++)
+        for(u32 j = 0; j < m_height; j++)
         {
-          m_tiles[i][j].RegisterElement(anElement);
+          Tile<CC> & tile = GetTile(i, j);
+          tile.RegisterElement(anElement);
+          if (slots > 0)
+          {
+            allocated = tile.GetElementTable().AllocateElementDataSlotsFromType(type, slots)
+              && allocated;
+          }
         }
       }
+      if (!allocated)
+      {
+        LOG.Warning("No room for %d element data slots for %@; raise EDS",
+                    slots, &anElement.GetUUID());
+      }
       LOG.Message("Assigned type 0x%04x for %@",anElement.GetType(),&anElement.GetUUID());
     }
 
@@ -233,10 +527,10 @@ namespace MFM {
       bool operator!=(const MyIterator &m) const { return i != m.i || j != m.j; }
       void operator++()
       {
-        if (j < g.H)
+        if (j < (s32) g.m_height)
         {
           i++;
-          if (i >= g.W)
+          if (i >= (s32) g.m_width)
           {
             i = 0;
             j++;
@@ -247,12 +541,12 @@ namespace MFM {
       {
         s32 rows = j-m.j;
         s32 cols = i-m.i;
-        return rows*g.W + cols;
+        return rows*g.m_width + cols;
       }
 
       PointerType operator*() const
       {
-        return &g.m_tiles[i][j];
+        return &g.GetTile(i, j);
       }
     };
 
@@ -263,12 +557,15 @@ namespace MFM {
 
     const_iterator_type begin() const { return iterator_type(*this); }
 
-    iterator_type end() { return iterator_type(*this,0,H); }
+    iterator_type end() { return iterator_type(*this,0,m_height); }
 
-    const_iterator_type end() const { return const_iterator_type(*this, 0,H); }
+    const_iterator_type end() const { return const_iterator_type(*this, 0,m_height); }
 
     ~Grid()
-    { }
+    {
+      m_scheduler.Stop();  // Before its workers lose their Tiles
+      FreeTiles();
+    }
 
     /**
      * Used to tell this Tile whether or not to actually execute any
@@ -349,17 +646,17 @@ namespace MFM {
     /**
      * Return the Grid height in Tiles
      */
-    static u32 GetHeight() { return H; }
+    u32 GetHeight() const { return m_height; }
 
     /**
      * Return the Grid width in Tiles
      */
-    static u32 GetWidth() { return W; }
+    u32 GetWidth() const { return m_width; }
 
     /**
      * Return the Grid height in (non-cache) sites
      */
-    static u32 GetHeightSites()
+    u32 GetHeightSites() const
     {
       return GetHeight() * Tile<CC>::OWNED_SIDE;
     }
@@ -367,7 +664,7 @@ namespace MFM {
     /**
      * Return the Grid width in (non-cache) sites
      */
-    static u32 GetWidthSites()
+    u32 GetWidthSites() const
     {
       return GetWidth() * Tile<CC>::OWNED_SIDE;
     }
@@ -377,6 +674,16 @@ namespace MFM {
      */
     void Pause()
     {
+      if (m_serialExecution)
+      {
+        return;  // Never running except inside ExecuteSerialEvents
+      }
+      m_running = false;
+      if (IsUsingWorkerThreads())
+      {
+        m_scheduler.Pause();
+        return;
+      }
       PauseControl pc;
       DoTileControl(pc);
     }
@@ -386,16 +693,66 @@ namespace MFM {
      */
     void Unpause()
     {
+      if (m_serialExecution)
+      {
+        return;
+      }
+      if (m_publishingSnapshots)
+      {
+        RequestSnapshots();  // Still paused, so done right now
+      }
+      m_running = true;
+      if (IsUsingWorkerThreads())
+      {
+        m_scheduler.Run();
+        return;
+      }
       RunControl rc;
       DoTileControl(rc);
     }
 
     /**
-     * Resets all atom counts and refreshes the atoms counts in
-     * every tile in the grid.
+     * Resets all atom counts and refreshes the atoms counts in every
+     * tile in the grid, sharing the Tiles among several threads.  If
+     * this Grid is running, its Tiles' own threads own their Atoms,
+     * so this just has each Tile recount itself before its next event,
+     * as CheckAtomCounts does.
+     *
+     * Counts are kept up to date as Atoms are placed, so this is only
+     * needed after changing Atoms behind the Tiles' backs.
      */
     void RecountAtoms();
 
+    /**
+     * Has each Tile check its atom counts against a recount of its
+     * Atoms, on whatever thread runs its events, before its next
+     * event; see Tile::RequestRecount.  Returns at once.
+     */
+    void CheckAtomCounts();
+
+    /**
+     * Gets how many recounts have found any Tile's atom counts wrong;
+     * see Tile::GetCountRepairs.
+     */
+    u32 GetCountRepairs() const;
+
+    /**
+     * Gets where slot \c slot of the \c slots element-specific data
+     * slots of the element of type \c elementType lives in every
+     * Tile's ElementTable, or -1 unless it is at the same offset in
+     * all of them, as Needed arranges.  Resolve this once, then use
+     * SumElementData.
+     */
+    s32 GetElementDataOffset(u32 elementType, u32 slots, u32 slot) const;
+
+    /**
+     * Sums the element-specific data at \c offset, as given by
+     * GetElementDataOffset, over all Tiles, zeroing each one as it is
+     * read if \c take.  Tiles may keep running meanwhile; the sum
+     * then mixes moments a little, but no update is torn or lost.
+     */
+    u64 SumElementData(u32 offset, bool take);
+
     void PlaceAtom(const T& atom, const SPoint& location);
 
     void XRayAtom(const SPoint& location);
@@ -414,6 +771,26 @@ namespace MFM {
       return GetTile(tileInGrid).GetAtom(siteInTile);
     }
 
+    /**
+     * Gets the Atom at grid site \c loc for display: from its Tile's
+     * Snapshot if IsReadingSnapshots, or else from the Tile itself.
+     * Returns NULL if \c loc is not in this Grid.
+     */
+    const T* GetDisplayAtom(const SPoint& loc) const
+    {
+      SPoint tileInGrid, siteInTile;
+      if (!MapGridToTile(loc, tileInGrid, siteInTile))
+      {
+        return 0;
+      }
+      const Tile<CC> & tile = GetTile(tileInGrid.GetX(), tileInGrid.GetY());
+      if (IsReadingSnapshots())
+      {
+        return &tile.GetSnapshot().m_atoms[siteInTile.GetX()][siteInTile.GetY()];
+      }
+      return tile.GetAtom(siteInTile);
+    }
+
     T* GetWritableAtom(SPoint& loc)
     {
       SPoint tileInGrid, siteInTile;
@@ -433,13 +810,13 @@ namespace MFM {
     {return GetTile(pt.GetX(), pt.GetY());}
 
     inline Tile<CC> & GetTile(u32 x, u32 y)
-    { return m_tiles[x][y]; }
+    { return *m_tiles[x * m_height + y]; }
 
     inline const Tile<CC> & GetTile(u32 x, u32 y) const
-    { return m_tiles[x][y]; }
+    { return *m_tiles[x * m_height + y]; }
 
     /* Don't count caches! */
-    static inline const u32 GetTotalSites()
+    inline u32 GetTotalSites() const
     { return GetWidthSites() * GetHeightSites(); }
 
     u64 GetTotalEventsExecuted() const;
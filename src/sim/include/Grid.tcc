@@ -3,6 +3,12 @@
 #include "Grid.h"
 #include "Utils.h"   /* For Sleep */
 #include "FileByteSink.h"
+#include <stdlib.h>    /* For posix_memalign, calloc, free */
+#include <string.h>    /* For memset */
+#include <sys/mman.h>  /* For madvise */
+#include <new>         /* For placement new */
+#include <unistd.h>    /* For sysconf */
+#include <pthread.h>
 
 #define XRAY_BIT_ODDS 100
 
@@ -16,6 +22,11 @@ namespace MFM {
 
     m_backgroundRadiationEnabled = false;
 
+    /* Forget all but Empty, which the tiles are about to reregister */
+    m_dispatch.Clear();
+    Element_Empty<CC>::THE_INSTANCE.AllocateType();
+    m_dispatch.Insert(Element_Empty<CC>::THE_INSTANCE);
+
     /* Reinit all the tiles */
 
     /* Set the neighbors flags of each tile. This lets the tiles know */
@@ -32,6 +43,8 @@ namespace MFM {
         tbs.Printf("[%d,%d]", x, y);
 
         ctile.Reinit();
+        ctile.SetSparseEvents(m_sparseEvents);
+        ctile.SetEventBatchSize(m_eventBatchSize);
 
         neighbors = 0;
         if(x > 0)
@@ -78,6 +91,148 @@ namespace MFM {
     }
   }
 
+  template <class GC>
+  void Grid<GC>::AllocateTiles(u32 width, u32 height)
+  {
+    // Whole pages apiece, so no two Tiles (or their threads) share one
+    const u32 align = sizeof(Tile<CC>) >= HUGE_PAGE_BYTES ? HUGE_PAGE_BYTES : PAGE_BYTES;
+    const u32 blockBytes = (sizeof(Tile<CC>) + align - 1) / align * align;
+
+    m_tiles = (Tile<CC> **) calloc(width * height, sizeof(Tile<CC> *));
+    if (!m_tiles)
+    {
+      FAIL(OUT_OF_RESOURCES);
+    }
+    m_width = width;
+    m_height = height;
+
+    u32 cpus[CoreAffinity::MAX_CPUS];
+    const u32 cpuCount = GetPinningCPUs(cpus);
+
+    for (u32 i = 0; i < width * height; ++i)
+    {
+      void * block;
+      if (posix_memalign(&block, align, blockBytes))
+      {
+        FAIL(OUT_OF_RESOURCES);
+      }
+#ifdef MADV_HUGEPAGE
+      if (align == HUGE_PAGE_BYTES)
+      {
+        madvise(block, blockBytes, MADV_HUGEPAGE);  // Only a hint; ignore failure
+      }
+#endif
+      // Pages are placed where first written, so write them from where they'll be used
+      FirstTouchJob job;
+      job.m_block = block;
+      job.m_bytes = blockBytes;
+      job.m_cpu = CPUForTile(cpus, cpuCount, i / height, i % height, width, height);
+      pthread_t toucher;
+      if (job.m_cpu < 0 || pthread_create(&toucher, NULL, FirstTouchThreadHelper, &job))
+      {
+        FirstTouchThreadHelper(&job);
+      }
+      else
+      {
+        pthread_join(toucher, NULL);
+      }
+
+      m_tiles[i] = new (block) Tile<CC>();
+      m_tiles[i]->GetElementTable().SetDispatch(&m_dispatch);
+      if (m_publishingSnapshots)
+      {
+        m_tiles[i]->StartPublishingSnapshots();
+      }
+      LOG.Debug("Tile[%d][%d] @ %p", i / height, i % height, block);
+    }
+
+    SetIgnoreThreadingProblems(m_ignoreThreadingProblems);
+    if (m_threadPinning)
+    {
+      SetThreadPinning(true);
+    }
+  }
+
+  template <class GC>
+  void * Grid<GC>::FirstTouchThreadHelper(void * jobPtr)
+  {
+    const FirstTouchJob & job = *(const FirstTouchJob *) jobPtr;
+    if (job.m_cpu >= 0 && !CoreAffinity::PinCurrentThread(job.m_cpu))
+    {
+      LOG.Warning("Could not pin to CPU %d to place a Tile's memory", job.m_cpu);
+    }
+    memset(job.m_block, 0, job.m_bytes);
+    return NULL;
+  }
+
+  template <class GC>
+  u32 Grid<GC>::GetPinningCPUs(u32 * cpus) const
+  {
+    if (!m_threadPinning)
+    {
+      return 0;
+    }
+    return CoreAffinity::GetCPUsBySocket(cpus, CoreAffinity::MAX_CPUS);
+  }
+
+  template <class GC>
+  void Grid<GC>::FreeTiles()
+  {
+    if (!m_tiles)
+    {
+      return;
+    }
+
+    // Tile threads are never joined, so theirs must outlive us
+    for (u32 i = 0; i < m_width * m_height; ++i)
+    {
+      if (m_tiles[i]->IsThreadStarted())
+      {
+        return;
+      }
+    }
+
+    for (u32 i = 0; i < m_width * m_height; ++i)
+    {
+      m_tiles[i]->~Tile();
+      free(m_tiles[i]);
+    }
+    free(m_tiles);
+    m_tiles = 0;
+    m_width = m_height = 0;
+  }
+
+  template <class GC>
+  void Grid<GC>::SetDimensions(u32 width, u32 height)
+  {
+    if (width == 0 || height == 0 || width > MAX_TILES || height > MAX_TILES ||
+        width * height > MAX_TILES)
+    {
+      FAIL(ILLEGAL_ARGUMENT);
+    }
+
+    if (m_running || m_serialStarted || m_scheduler.IsStarted())
+    {
+      FAIL(ILLEGAL_STATE);
+    }
+
+    if (width == m_width && height == m_height)
+    {
+      return;
+    }
+
+    for (u32 i = 0; i < m_width * m_height; ++i)
+    {
+      if (m_tiles[i]->IsThreadStarted())
+      {
+        FAIL(ILLEGAL_STATE);
+      }
+    }
+
+    FreeTiles();
+    AllocateTiles(width, height);
+  }
+
   template <class GC>
   void Grid<GC>::SetSeed(u32 seed)
   {
@@ -93,11 +248,11 @@ namespace MFM {
     }
 
     m_random.SetSeed(m_seed);
-    for(u32 i = 0; i < W; i++)
+    for(u32 i = 0; i < m_width; i++)
     {
-      for(u32 j = 0; j < H; j++)
+      for(u32 j = 0; j < m_height; j++)
         {
-          m_tiles[i][j].GetRandom().SetSeed(m_random.Create());
+          GetTile(i, j).GetRandom().SetSeed(m_random.Create());
         }
     }
   }
@@ -106,7 +261,7 @@ namespace MFM {
   void Grid<GC>::SetTileToExecuteOnly(const SPoint& tileLoc, bool value)
   {
     if(tileLoc.GetX() >= 0 && tileLoc.GetY() >= 0 &&
-       tileLoc.GetX() < W  && tileLoc.GetY() < H)
+       tileLoc.GetX() < (s32) m_width && tileLoc.GetY() < (s32) m_height)
     {
       GetTile(tileLoc).SetExecuteOwnEvents(value);
     }
@@ -123,7 +278,7 @@ namespace MFM {
   {
     if (tileInGrid.GetX() < 0 || tileInGrid.GetY() < 0)
       return false;
-    if (tileInGrid.GetX() >= (s32) W || tileInGrid.GetY() >= (s32) H)
+    if (tileInGrid.GetX() >= (s32) m_width || tileInGrid.GetY() >= (s32) m_height)
       return false;
     return true;
   }
@@ -159,9 +314,108 @@ namespace MFM {
   template <class GC>
   void Grid<GC>::RecountAtoms()
   {
-    for(u32 i = 0; i < W; i++)
-      for(u32 j = 0; j < H; j++)
-        m_tiles[i][j].RecountAtoms();
+    if (m_running)
+    {
+      CheckAtomCounts();
+      return;
+    }
+
+    RecountJob job;
+    job.m_grid = this;
+    job.m_nextTile = 0;
+
+    const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    u32 threads = cores > 0 ? (u32) cores : 1;
+    threads = MIN(threads, MIN(m_width * m_height, MAX_RECOUNT_THREADS));
+
+    // We make one of the threads ourselves
+    pthread_t helpers[MAX_RECOUNT_THREADS];
+    u32 helperCount = 0;
+    while (helperCount + 1 < threads &&
+           !pthread_create(&helpers[helperCount], NULL, RecountThreadHelper, &job))
+    {
+      ++helperCount;
+    }
+
+    RecountTiles(job);
+
+    for (u32 i = 0; i < helperCount; ++i)
+    {
+      pthread_join(helpers[i], NULL);
+    }
+  }
+
+  template <class GC>
+  void Grid<GC>::RecountTiles(RecountJob & job)
+  {
+    Grid & grid = *job.m_grid;
+    const u32 tiles = grid.m_width * grid.m_height;
+    while (true)
+    {
+      const u32 index = __atomic_fetch_add(&job.m_nextTile, 1, __ATOMIC_RELAXED);
+      if (index >= tiles)
+      {
+        break;
+      }
+      grid.m_tiles[index]->RecountAtoms();
+    }
+  }
+
+  template <class GC>
+  void * Grid<GC>::RecountThreadHelper(void * jobPtr)
+  {
+    // FAILs outside any unwind_protect abort, as on a Tile thread
+    MFMErrorEnvironmentPointer_t errorEnvironmentStackTop = 0;
+    MFMPtrToErrEnvStackPtr = &errorEnvironmentStackTop;
+
+    RecountTiles(*(RecountJob *) jobPtr);
+    return NULL;
+  }
+
+  template <class GC>
+  void Grid<GC>::CheckAtomCounts()
+  {
+    for(u32 i = 0; i < m_width * m_height; i++)
+    {
+      m_tiles[i]->RequestRecount();
+    }
+  }
+
+  template <class GC>
+  u32 Grid<GC>::GetCountRepairs() const
+  {
+    u32 total = 0;
+    for(u32 i = 0; i < m_width * m_height; i++)
+    {
+      total += m_tiles[i]->GetCountRepairs();
+    }
+    return total;
+  }
+
+  template <class GC>
+  s32 Grid<GC>::GetElementDataOffset(u32 elementType, u32 slots, u32 slot) const
+  {
+    const s32 offset = m_tiles[0]->GetElementTable().GetElementDataOffset(elementType, slots, slot);
+    for(u32 i = 1; offset >= 0 && i < m_width * m_height; i++)
+    {
+      if (m_tiles[i]->GetElementTable().GetElementDataOffset(elementType, slots, slot) != offset)
+      {
+        return -1;
+      }
+    }
+    return offset;
+  }
+
+  template <class GC>
+  u64 Grid<GC>::SumElementData(u32 offset, bool take)
+  {
+    u64 total = 0;
+    for(u32 i = 0; i < m_width * m_height; i++)
+    {
+      ElementTable<CC> & et = m_tiles[i]->GetElementTable();
+      total += take ? et.TakeElementData(offset) : et.ReadElementData(offset);
+    }
+    return total;
   }
 
   template <class GC>
@@ -246,10 +500,17 @@ namespace MFM {
     LOG.Log(level," Last event tile: (%d, %d)", m_lastEventTile.GetX(), m_lastEventTile.GetY());
     LOG.Log(level," Background radiation: %s", m_backgroundRadiationEnabled?"true":"false");
     LOG.Log(level," Xray odds: %d", m_xraySiteOdds);
+    LOG.Log(level," Serial execution: %s", m_serialExecution?"true":"false");
+    LOG.Log(level," Sparse events: %s", m_sparseEvents?"true":"false");
+    LOG.Log(level," Event batch size: %d", m_eventBatchSize);
+    if (IsUsingWorkerThreads())
+    {
+      m_scheduler.ReportSchedulerStatus(level);
+    }
 
-    for(u32 x = 0; x < W; x++)
+    for(u32 x = 0; x < m_width; x++)
     {
-      for(u32 y = 0; y < H; y++)
+      for(u32 y = 0; y < m_height; y++)
       {
         Tile<CC> & tile = GetTile(x,y);
         LOG.Log(level,"--Grid(%d,%d)=Tile %s (%p)--",
@@ -263,9 +524,9 @@ namespace MFM {
   void Grid<GC>::DoTileControl(TileControl & tc)
   {
     // Issue request to all
-    for(u32 x = 0; x < W; x++)
+    for(u32 x = 0; x < m_width; x++)
     {
-      for(u32 y = 0; y < H; y++)
+      for(u32 y = 0; y < m_height; y++)
       {
         tc.MakeRequest(GetTile(x, y));
       }
@@ -303,9 +564,9 @@ namespace MFM {
 
       notReady = 0;
 
-      for(u32 x = 0; x < W; x++)
+      for(u32 x = 0; x < m_width; x++)
       {
-        for(u32 y = 0; y < H; y++)
+        for(u32 y = 0; y < m_height; y++)
         {
           if (!tc.CheckIfReady(GetTile(x, y)))
           {
@@ -324,15 +585,132 @@ namespace MFM {
     }
 
     // Release the hounds
-    for(u32 x = 0; x < W; x++)
+    for(u32 x = 0; x < m_width; x++)
     {
-      for(u32 y = 0; y < H; y++)
+      for(u32 y = 0; y < m_height; y++)
       {
         tc.Execute(GetTile(x, y));
       }
     }
   }
 
+  template <class GC>
+  void Grid<GC>::SetThreadPinning(bool value)
+  {
+    if (m_running || m_serialStarted || m_scheduler.IsStarted())
+    {
+      FAIL(ILLEGAL_STATE);
+    }
+
+    const bool rehome = value && !m_threadPinning && m_tiles;
+    m_threadPinning = value;
+    if (rehome)
+    {
+      for (u32 i = 0; i < m_width * m_height; ++i)
+      {
+        if (m_tiles[i]->IsThreadStarted())
+        {
+          FAIL(ILLEGAL_STATE);
+        }
+      }
+      const u32 width = m_width, height = m_height;
+      FreeTiles();
+      AllocateTiles(width, height);  // Comes back here to assign the CPUs
+      return;
+    }
+
+    u32 cpus[CoreAffinity::MAX_CPUS];
+    const u32 cpuCount = GetPinningCPUs(cpus);
+    if (value && cpuCount == 0)
+    {
+      LOG.Warning("Can't determine usable CPUs; threads will not be pinned");
+    }
+
+    for(u32 x = 0; x < m_width; x++)
+    {
+      for(u32 y = 0; y < m_height; y++)
+      {
+        GetTile(x, y).SetPinnedCPU(CPUForTile(cpus, cpuCount, x, y, m_width, m_height));
+      }
+    }
+
+    m_scheduler.SetPinnedCPUs(cpus, cpuCount);
+  }
+
+  template <class GC>
+  void Grid<GC>::ExecuteSerialEvents(u64 count)
+  {
+    if (!m_serialExecution)
+    {
+      FAIL(ILLEGAL_STATE);
+    }
+
+    if (!m_serialStarted)
+    {
+      for(u32 x = 0; x < m_width; x++)
+      {
+        for(u32 y = 0; y < m_height; y++)
+        {
+          Tile<CC> & tile = GetTile(x, y);
+          tile.SetExternallyScheduled(true);
+          tile.SetDirectCacheUpdates(true);
+          tile.RequestRecount();
+        }
+      }
+      m_serialStarted = true;
+    }
+
+    u64 done = 0;
+    while (done < count)
+    {
+      const u32 tileIndex = m_random.Create(m_width * m_height);
+      // The same x*m_height+y order as m_tiles
+      m_lastEventTile.Set(tileIndex / m_height, tileIndex % m_height);
+      Tile<CC> & tile = *m_tiles[tileIndex];
+
+      const u64 before = tile.GetEventsExecuted();
+      tile.ExecuteEvents(1);
+      const u64 ran = tile.GetEventsExecuted() - before;
+      done += ran > 0 ? ran : 1;  // Tiles told not to run still use up a turn
+    }
+  }
+
+  template <class GC>
+  void Grid<GC>::SetPublishingSnapshots(bool value)
+  {
+    if (value && !m_publishingSnapshots)
+    {
+      if (m_running)
+      {
+        FAIL(ILLEGAL_STATE);
+      }
+      for(u32 i = 0; i < m_width * m_height; i++)
+      {
+        m_tiles[i]->StartPublishingSnapshots();
+      }
+    }
+    m_publishingSnapshots = value;
+  }
+
+  template <class GC>
+  void Grid<GC>::RequestSnapshots()
+  {
+    for(u32 x = 0; x < m_width; x++)
+    {
+      for(u32 y = 0; y < m_height; y++)
+      {
+        if (m_running)
+        {
+          GetTile(x, y).RequestSnapshot();
+        }
+        else
+        {
+          GetTile(x, y).PublishSnapshot();
+        }
+      }
+    }
+  }
+
   template <class GC>
   void Grid<GC>::FillLastEventTile(SPoint& out)
   {
@@ -344,11 +722,13 @@ namespace MFM {
   u64 Grid<GC>::GetTotalEventsExecuted() const
   {
     u64 total = 0;
-    for(u32 x = 0; x < W; x++)
+    for(u32 x = 0; x < m_width; x++)
     {
-      for(u32 y = 0; y < H; y++)
+      for(u32 y = 0; y < m_height; y++)
       {
-        total += m_tiles[x][y].GetEventsExecuted();
+        total += IsReadingSnapshots() ?
+          GetTile(x, y).GetSnapshot().m_eventsExecuted :
+          GetTile(x, y).GetEventsExecuted();
       }
     }
     return total;
@@ -428,9 +808,11 @@ namespace MFM {
   u32 Grid<GC>::GetAtomCount(ElementType atomType) const
   {
     u32 total = 0;
-    for(u32 i = 0; i < W; i++)
-      for(u32 j = 0; j < H; j++)
-        total += m_tiles[i][j].GetAtomCount(atomType);
+    for(u32 i = 0; i < m_width; i++)
+      for(u32 j = 0; j < m_height; j++)
+        total += IsReadingSnapshots() ?
+          GetTile(i, j).GetSnapshotAtomCount(atomType) :
+          GetTile(i, j).GetAtomCount(atomType);
 
     return total;
   }
@@ -475,8 +857,8 @@ namespace MFM {
   {
     Random& rand = m_random;
 
-    SPoint center(rand.Create(W * CC::PARAM_CONFIG::TILE_WIDTH),
-		  rand.Create(H * CC::PARAM_CONFIG::TILE_WIDTH));
+    SPoint center(rand.Create(m_width * CC::PARAM_CONFIG::TILE_WIDTH),
+		  rand.Create(m_height * CC::PARAM_CONFIG::TILE_WIDTH));
 
     u32 radius = rand.Between(5, CC::PARAM_CONFIG::TILE_WIDTH);
     T atom(Element_Empty<CC>::THE_INSTANCE.GetDefaultAtom());
@@ -502,9 +884,9 @@ namespace MFM {
   void Grid<GC>::Clear()
   {
     ++m_gridGeneration;
-    for(u32 x = 0; x < W; x++)
+    for(u32 x = 0; x < m_width; x++)
     {
-      for(u32 y = 0; y < H; y++)
+      for(u32 y = 0; y < m_height; y++)
       {
 	EmptyTile(SPoint(x, y));
 
@@ -515,9 +897,9 @@ namespace MFM {
   template <class GC>
   void Grid<GC>::CheckCaches()
   {
-    for(u32 x = 0; x < W; x++)
+    for(u32 x = 0; x < m_width; x++)
     {
-      for(u32 y = 0; y < H; y++)
+      for(u32 y = 0; y < m_height; y++)
       {
         const SPoint usp(x,y);
 
@@ -539,9 +921,9 @@ namespace MFM {
   template <class GC>
   void Grid<GC>::SetBackgroundRadiation(bool value)
   {
-    for(u32 x = 0; x < W; x++)
+    for(u32 x = 0; x < m_width; x++)
     {
-      for(u32 y = 0; y < H; y++)
+      for(u32 y = 0; y < m_height; y++)
       {
 	GetTile(x, y).SetBackgroundRadiation(value);
       }
@@ -549,12 +931,38 @@ namespace MFM {
     m_backgroundRadiationEnabled = value;
   }
 
+  template <class GC>
+  void Grid<GC>::SetSparseEvents(bool value)
+  {
+    for(u32 x = 0; x < m_width; x++)
+    {
+      for(u32 y = 0; y < m_height; y++)
+      {
+        GetTile(x, y).SetSparseEvents(value);
+      }
+    }
+    m_sparseEvents = value;
+  }
+
+  template <class GC>
+  void Grid<GC>::SetEventBatchSize(u32 size)
+  {
+    for(u32 x = 0; x < m_width; x++)
+    {
+      for(u32 y = 0; y < m_height; y++)
+      {
+        GetTile(x, y).SetEventBatchSize(size);
+      }
+    }
+    m_eventBatchSize = size;
+  }
+
   template <class GC>
   void Grid<GC>::XRay()
   {
-    for(u32 x = 0; x < W; x++)
+    for(u32 x = 0; x < m_width; x++)
     {
-      for(u32 y = 0; y < H; y++)
+      for(u32 y = 0; y < m_height; y++)
       {
 	GetTile(x,y).XRay(m_xraySiteOdds,
 			  XRAY_BIT_ODDS);
@@ -568,9 +976,9 @@ namespace MFM {
     u32 acc   = 0,
         sides = GetTile(0,0).GetSites();
 
-    for(u32 x = 0; x < W; x++)
+    for(u32 x = 0; x < m_width; x++)
     {
-      for(u32 y = 0; y < H; y++)
+      for(u32 y = 0; y < m_height; y++)
       {
 	acc += GetTile(x,y).GetExecutingOwnEvents() ? sides : 0;
       }
@@ -43,8 +43,8 @@ namespace MFM {
    * template classes that need to use the new parameter.
    */
   template <class CC,      // CoreConfig
-            u32 W = 5,     // Grid width in tiles
-            u32 H = 3>     // Grid height in tiles
+            u32 W = 5,     // Default grid width in tiles
+            u32 H = 3>     // Default grid height in tiles
   struct GridConfig {
 
     /**
@@ -53,14 +53,14 @@ namespace MFM {
     typedef CC CORE_CONFIG;
 
     /**
-     * GRID_WIDTH is the number of columns of tiles in this Grid
-     * Configuration.
+     * GRID_WIDTH is the number of columns of tiles a Grid of this
+     * Configuration starts with; see Grid::SetDimensions.
      */
     enum { GRID_WIDTH = W };
 
     /**
-     * GRID_HEIGHT is the number of rows of tiles in this Grid
-     * Configuration.
+     * GRID_HEIGHT is the number of rows of tiles a Grid of this
+     * Configuration starts with; see Grid::SetDimensions.
      */
     enum { GRID_HEIGHT = H };
 
@@ -0,0 +1,232 @@
+/*                                              -*- mode:C++ -*-
+  GridRasterizer.h Offscreen rendering of Grid images without SDL
+  Copyright (C) 2014 The Regents of the University of New Mexico.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file GridRasterizer.h Offscreen rendering of Grid images without SDL
+  \author David H. Ackley.
+  \date (C) 2014 All rights reserved.
+  \lgpl
+ */
+#ifndef GRIDRASTERIZER_H
+#define GRIDRASTERIZER_H
+
+#include "itype.h"
+#include "Grid.h"
+#include "BufferPoolThread.h"
+#include "VideoEncoder.h"
+
+namespace MFM
+{
+  /**
+   * Renders pictures of a Grid's owned sites, each Atom drawn in its
+   * Element's LocalPhysicsColor as a square of pixels, into memory
+   * rather than onto a display, and writes them out as PPM images or
+   * as frames of a video.  It needs neither SDL nor an X server.
+   *
+   * Capture only copies the Grid's Atoms, from its Tiles if it is
+   * paused or else from their Snapshots, and returns; the coloring
+   * and writing happen on a background thread.  If the background
+   * thread is still busy with CAPTURE_BUFFERS earlier captures, the
+   * capture is dropped and counted rather than delaying the caller.
+   */
+  template <class GC>
+  class GridRasterizer
+  {
+    // Extract short type names
+    typedef typename GC::CORE_CONFIG CC;
+    typedef typename CC::PARAM_CONFIG P;
+    typedef typename CC::ATOM_TYPE T;
+    enum { R = P::EVENT_WINDOW_RADIUS};
+    enum { OWNED_SIDE = Tile<CC>::OWNED_SIDE };
+    enum { SITES_PER_TILE = OWNED_SIDE * OWNED_SIDE };
+
+  public:
+    enum Output
+    {
+      OUTPUT_PPM,    /**< A binary PPM file per capture */
+      OUTPUT_Y4M,    /**< One YUV4MPEG2 video; see VideoEncoder */
+      OUTPUT_DELTA   /**< One delta video; see VideoEncoder */
+    };
+
+    /**
+     * The most pixels on a side any site may be drawn with.
+     */
+    static const u32 MAX_PIXELS_PER_SITE = 16;
+
+    /**
+     * The number of captures that may await the background thread.
+     * Must be a power of two.
+     */
+    static const u32 CAPTURE_BUFFERS = 2;
+
+    /**
+     * The color of empty sites, and of sites whose Element is unknown.
+     */
+    static const u32 EMPTY_COLOR = 0xff000000;
+
+    /**
+     * The color of sites holding damaged Atoms.
+     */
+    static const u32 BAD_ATOM_COLOR = 0xffffff00;
+
+    /**
+     * Looks up an Output by its name ("ppm", "y4m", or "delta"),
+     * storing it in \c output.
+     *
+     * @returns false if \c name is no Output's name.
+     */
+    static bool ParseOutput(const char * name, Output & output) ;
+
+    GridRasterizer(Grid<GC> & grid) ;
+
+    /**
+     * Stops, if started.
+     */
+    ~GridRasterizer() ;
+
+    /**
+     * Starts the background thread, to write \c output to \c
+     * directory: PPM files named by each capture's label, or a single
+     * video named 'frames', to be played at \c framesPerSecond.  Each
+     * site becomes \c pixelsPerSite pixels square.  FAILs with
+     * ILLEGAL_STATE if already started.  The Grid's dimensions must
+     * not change until Stop.
+     *
+     * @returns true on success; on failure logs an error and returns
+     *          false.
+     */
+    bool Start(const char * directory, Output output, u32 pixelsPerSite,
+               u32 framesPerSecond) ;
+
+    bool IsStarted() const
+    {
+      return m_rasterizer.IsStarted();
+    }
+
+    /**
+     * Gets the width of each image, in pixels.
+     */
+    u32 GetImageWidth() const
+    {
+      return m_grid.GetWidth() * OWNED_SIDE * m_pixelsPerSite;
+    }
+
+    /**
+     * Gets the height of each image, in pixels.
+     */
+    u32 GetImageHeight() const
+    {
+      return m_grid.GetHeight() * OWNED_SIDE * m_pixelsPerSite;
+    }
+
+    /**
+     * Copies the owned Atoms of the Grid, which must be paused or
+     * else reading Snapshots, to be rendered and written in the
+     * background with \c label, typically the current AEPS.  FAILs
+     * with ILLEGAL_STATE unless started.
+     *
+     * @returns true if the capture was queued, false if it was
+     *          dropped because the background thread has fallen
+     *          behind.
+     */
+    bool Capture(u32 label) ;
+
+    /**
+     * Waits until every queued capture has been rendered.  Call this
+     * before changing the Grid's Elements.
+     */
+    void Flush() ;
+
+    /**
+     * Renders and writes all queued captures, stops the background
+     * thread, and closes any video.  Logs how many captures were
+     * written and dropped.  Does nothing unless started.
+     */
+    void Stop() ;
+
+    u32 GetCapturesTaken() const
+    {
+      return m_capturesTaken;
+    }
+
+    u32 GetCapturesDropped() const
+    {
+      return m_capturesDropped;
+    }
+
+    u32 GetCapturesWritten() const
+    {
+      return __atomic_load_n(&m_capturesWritten, __ATOMIC_ACQUIRE);
+    }
+
+  private:
+    static const u32 MAX_PATH_BYTES = 256;
+
+    // Declare away copy ctor; the background thread holds our address
+    GridRasterizer(const GridRasterizer &) ;
+
+    Grid<GC> & m_grid;
+
+    Output m_output;
+    u32 m_pixelsPerSite;
+    char m_directory[MAX_PATH_BYTES];
+
+    /**
+     * CAPTURE_BUFFERS copies of the owned Atoms, Tile by Tile, each
+     * Tile column by column, as raw bytes.
+     */
+    u8 * m_captures[CAPTURE_BUFFERS];
+    u32 m_labels[CAPTURE_BUFFERS];
+
+    /** The image being rendered, row by row */
+    u32 * m_pixels;
+
+    /** OUTPUT_PPM: the image as written */
+    u8 * m_rgb;
+
+    VideoEncoder m_video;
+
+    /** Renders and writes m_captures, by index */
+    BufferPoolThread<CAPTURE_BUFFERS> m_rasterizer;
+
+    u32 m_capturesTaken;
+    u32 m_capturesDropped;
+    u32 m_capturesWritten;
+
+    T * GetCapture(u32 index) const
+    {
+      return (T *) m_captures[index];
+    }
+
+    void Render(const T * atoms) ;
+
+    bool WritePPM(u32 label) ;
+
+    void RasterizeCapture(u32 index) ;
+
+    static void RasterizeCaptureHelper(void * rasterizerPtr, u32 index) ;
+
+    void FreeBuffers() ;
+  };
+}
+
+#include "GridRasterizer.tcc"
+
+#endif /* GRIDRASTERIZER_H */
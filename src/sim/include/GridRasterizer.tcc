@@ -0,0 +1,300 @@
+/* -*- C++ -*- */
+#include <stdlib.h>    /* For malloc, free */
+#include <string.h>    /* For memcpy, strcmp, strerror */
+#include <errno.h>
+#include "Logger.h"
+
+namespace MFM
+{
+  template <class GC>
+  bool GridRasterizer<GC>::ParseOutput(const char * name, Output & output)
+  {
+    if (!strcmp(name, "ppm"))
+    {
+      output = OUTPUT_PPM;
+      return true;
+    }
+
+    VideoEncoder::Format format;
+    if (VideoEncoder::ParseFormat(name, format))
+    {
+      output = format == VideoEncoder::FORMAT_Y4M ? OUTPUT_Y4M : OUTPUT_DELTA;
+      return true;
+    }
+    return false;
+  }
+
+  template <class GC>
+  GridRasterizer<GC>::GridRasterizer(Grid<GC> & grid) :
+    m_grid(grid),
+    m_output(OUTPUT_PPM),
+    m_pixelsPerSite(1),
+    m_pixels(0),
+    m_rgb(0),
+    m_capturesTaken(0),
+    m_capturesDropped(0),
+    m_capturesWritten(0)
+  {
+    m_directory[0] = 0;
+    for (u32 i = 0; i < CAPTURE_BUFFERS; ++i)
+    {
+      m_captures[i] = 0;
+      m_labels[i] = 0;
+    }
+  }
+
+  template <class GC>
+  GridRasterizer<GC>::~GridRasterizer()
+  {
+    Stop();
+  }
+
+  template <class GC>
+  void GridRasterizer<GC>::FreeBuffers()
+  {
+    for (u32 i = 0; i < CAPTURE_BUFFERS; ++i)
+    {
+      free(m_captures[i]);
+      m_captures[i] = 0;
+    }
+    free(m_pixels);
+    m_pixels = 0;
+    free(m_rgb);
+    m_rgb = 0;
+  }
+
+  template <class GC>
+  bool GridRasterizer<GC>::Start(const char * directory, Output output, u32 pixelsPerSite,
+                                 u32 framesPerSecond)
+  {
+    if (IsStarted())
+    {
+      FAIL(ILLEGAL_STATE);
+    }
+
+    if (pixelsPerSite == 0 || pixelsPerSite > MAX_PIXELS_PER_SITE)
+    {
+      LOG.Error("Pixels per site must be 1..%d, not %d", MAX_PIXELS_PER_SITE, pixelsPerSite);
+      return false;
+    }
+
+    if (strlen(directory) + 32 > MAX_PATH_BYTES)
+    {
+      LOG.Error("Image directory path too long: '%s'", directory);
+      return false;
+    }
+    strcpy(m_directory, directory);
+    m_output = output;
+    m_pixelsPerSite = pixelsPerSite;
+
+    const u32 pixels = GetImageWidth() * GetImageHeight();
+    bool allocated = true;
+    for (u32 i = 0; i < CAPTURE_BUFFERS; ++i)
+    {
+      m_captures[i] = (u8 *) malloc(m_grid.GetWidth() * m_grid.GetHeight() *
+                                    SITES_PER_TILE * sizeof(T));
+      allocated = allocated && m_captures[i];
+    }
+    m_pixels = (u32 *) malloc(pixels * sizeof(u32));
+    allocated = allocated && m_pixels;
+    if (output == OUTPUT_PPM)
+    {
+      m_rgb = (u8 *) malloc(pixels * 3);
+      allocated = allocated && m_rgb;
+    }
+    if (!allocated)
+    {
+      LOG.Error("Can't allocate buffers for %dx%d images", GetImageWidth(), GetImageHeight());
+      FreeBuffers();
+      return false;
+    }
+
+    if (output != OUTPUT_PPM)
+    {
+      const VideoEncoder::Format format =
+        output == OUTPUT_Y4M ? VideoEncoder::FORMAT_Y4M : VideoEncoder::FORMAT_DELTA;
+      char path[MAX_PATH_BYTES];
+      snprintf(path, MAX_PATH_BYTES, "%s/frames.%s",
+               directory, VideoEncoder::GetExtension(format));
+      if (!m_video.Open(path, format, GetImageWidth(), GetImageHeight(), framesPerSecond))
+      {
+        FreeBuffers();
+        return false;
+      }
+    }
+
+    m_capturesTaken = m_capturesDropped = m_capturesWritten = 0;
+
+    if (!m_rasterizer.Start(RasterizeCaptureHelper, this))
+    {
+      LOG.Error("Can't start the rasterizer thread");
+      m_video.Close();
+      FreeBuffers();
+      return false;
+    }
+    return true;
+  }
+
+  template <class GC>
+  bool GridRasterizer<GC>::Capture(u32 label)
+  {
+    if (!IsStarted())
+    {
+      FAIL(ILLEGAL_STATE);
+    }
+
+    ++m_capturesTaken;
+
+    u32 index;
+    if (!m_rasterizer.Acquire(index))
+    {
+      ++m_capturesDropped;
+      return false;
+    }
+
+    const bool fromSnapshots = m_grid.IsReadingSnapshots();
+    T * out = GetCapture(index);
+    for (u32 tx = 0; tx < m_grid.GetWidth(); ++tx)
+    {
+      for (u32 ty = 0; ty < m_grid.GetHeight(); ++ty)
+      {
+        const Tile<CC> & tile = m_grid.GetTile(tx, ty);
+        for (u32 x = 0; x < OWNED_SIDE; ++x)
+        {
+          // Each column of owned sites is contiguous
+          const T * column = fromSnapshots ?
+            &tile.GetSnapshot().m_atoms[x + R][R] :
+            tile.GetAtom(x + R, R);
+          memcpy((void *) out, column, OWNED_SIDE * sizeof(T));
+          out += OWNED_SIDE;
+        }
+      }
+    }
+    m_labels[index] = label;
+
+    m_rasterizer.Queue(index);
+    return true;
+  }
+
+  template <class GC>
+  void GridRasterizer<GC>::Flush()
+  {
+    m_rasterizer.Flush();
+  }
+
+  template <class GC>
+  void GridRasterizer<GC>::Stop()
+  {
+    if (!IsStarted())
+    {
+      return;
+    }
+
+    m_rasterizer.Stop();
+    m_video.Close();
+    FreeBuffers();
+
+    LOG.Message("Grid images: %d of %d captures written, %d dropped",
+                GetCapturesWritten(), GetCapturesTaken(), GetCapturesDropped());
+  }
+
+  template <class GC>
+  void GridRasterizer<GC>::Render(const T * atoms)
+  {
+    const u32 pps = m_pixelsPerSite;
+    const u32 width = GetImageWidth();
+    const u32 emptyType = Element_Empty<CC>::THE_INSTANCE.GetType();
+
+    for (u32 tx = 0; tx < m_grid.GetWidth(); ++tx)
+    {
+      for (u32 ty = 0; ty < m_grid.GetHeight(); ++ty)
+      {
+        for (u32 x = 0; x < OWNED_SIDE; ++x)
+        {
+          for (u32 y = 0; y < OWNED_SIDE; ++y)
+          {
+            const T & atom = *atoms++;
+
+            u32 color = EMPTY_COLOR;
+            if (!atom.IsSane())
+            {
+              color = BAD_ATOM_COLOR;
+            }
+            else if (atom.GetType() != emptyType)
+            {
+              const Element<CC> * elt = m_grid.LookupElement(atom.GetType());
+              if (elt)
+              {
+                color = elt->LocalPhysicsColor(atom, 0);
+              }
+            }
+
+            u32 * out = m_pixels +
+              ((ty * OWNED_SIDE + y) * width + tx * OWNED_SIDE + x) * pps;
+            for (u32 py = 0; py < pps; ++py)
+            {
+              for (u32 px = 0; px < pps; ++px)
+              {
+                out[px] = color;
+              }
+              out += width;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  template <class GC>
+  bool GridRasterizer<GC>::WritePPM(u32 label)
+  {
+    const u32 pixels = GetImageWidth() * GetImageHeight();
+    for (u32 i = 0; i < pixels; ++i)
+    {
+      m_rgb[3 * i] = (m_pixels[i] >> 16) & 0xff;
+      m_rgb[3 * i + 1] = (m_pixels[i] >> 8) & 0xff;
+      m_rgb[3 * i + 2] = m_pixels[i] & 0xff;
+    }
+
+    char path[MAX_PATH_BYTES];
+    snprintf(path, MAX_PATH_BYTES, "%s/%010d.ppm", m_directory, label);
+    FILE * fp = fopen(path, "wb");
+    if (!fp)
+    {
+      LOG.Error("Can't write image '%s': %s", path, strerror(errno));
+      return false;
+    }
+
+    fprintf(fp, "P6\n# AEPS %d\n%d %d\n255\n", label, GetImageWidth(), GetImageHeight());
+    const bool ok = fwrite(m_rgb, 3, pixels, fp) == pixels;
+    if (fclose(fp) != 0 || !ok)
+    {
+      LOG.Error("Writing image '%s' failed: %s", path, strerror(errno));
+      return false;
+    }
+    return true;
+  }
+
+  template <class GC>
+  void GridRasterizer<GC>::RasterizeCapture(u32 index)
+  {
+    Render(GetCapture(index));
+
+    const u32 label = m_labels[index];
+    m_rasterizer.Release(index);  // Done with the Atoms already
+
+    const bool ok = m_output == OUTPUT_PPM ?
+      WritePPM(label) :
+      m_video.SubmitFrame(m_pixels, GetImageWidth() * sizeof(u32), label);
+    if (ok)
+    {
+      __atomic_add_fetch(&m_capturesWritten, 1, __ATOMIC_RELEASE);
+    }
+  }
+
+  template <class GC>
+  void GridRasterizer<GC>::RasterizeCaptureHelper(void * rasterizerPtr, u32 index)
+  {
+    ((GridRasterizer *) rasterizerPtr)->RasterizeCapture(index);
+  }
+}
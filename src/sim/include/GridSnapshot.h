@@ -0,0 +1,300 @@
+/*                                              -*- mode:C++ -*-
+  GridSnapshot.h Binary whole-grid save and restore
+  Copyright (C) 2014 The Regents of the University of New Mexico.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file GridSnapshot.h Binary whole-grid save and restore
+  \lgpl
+ */
+#ifndef GRIDSNAPSHOT_H
+#define GRIDSNAPSHOT_H
+
+#include "itype.h"
+#include "Grid.h"
+#include "Random.h"
+#include "ExternalConfig.h"
+#include <sys/mman.h>        /* For munmap */
+
+namespace MFM
+{
+  /**
+   * Saves and restores the complete state of a Grid -- every Tile's
+   * Atoms, caches included, plus element data slots and random
+   * number generator states -- in a binary format much faster to
+   * write and read than the text configurations of ExternalConfig.
+   * The text format remains the one for interchange: a snapshot can
+   * only be loaded into a Grid with exactly the same ParamConfig and
+   * GridConfig, on a machine of the same byte order.
+   *
+   * A snapshot file holds:
+   *
+   * - A SnapshotHeader, recording the configuration;
+   *
+   * - The type number each element had when saved, indexed as in
+   *   the element registrations that follow;
+   *
+   * - The element registrations and element parameters, as written
+   *   by ExternalConfig::WriteElements;
+   *
+   * - Starting at the next page boundary, one record per Tile, in
+   *   column order: a TileHeader, the element data slot counts and
+   *   contents, and then, if the TileHeader says so, the Tile's raw
+   *   Atoms.
+   *
+   * Each Tile record is written with a single system call, and
+   * reading maps the file and copies each Tile's Atoms straight into
+   * place.  Atoms are retyped on loading only if some element was
+   * assigned a different type number than when it was saved.
+   *
+   * A snapshot may also be a \e delta, written by WriteCheckpoint,
+   * which names the previous checkpoint and holds Atoms only for the
+   * Tiles whose Atoms changed since then.  Every Tile's random
+   * number generator state and element data slots are in every
+   * snapshot, since they change even when the Atoms do not.  Reading
+   * a delta reads its whole chain of checkpoints, back to the last
+   * full snapshot, and so reconstructs the Grid as of that delta.
+   */
+  template <class GC>
+  class GridSnapshot
+  {
+    // Extract short type names
+    typedef typename GC::CORE_CONFIG CC;
+    typedef typename CC::PARAM_CONFIG P;
+    typedef typename CC::ATOM_TYPE T;
+    enum { TILE_WIDTH = P::TILE_WIDTH };
+    enum { EDS = P::ELEMENT_DATA_SLOTS };
+    enum { MAX_ELEMENTS = ElementRegistry<CC>::TABLE_SIZE };
+
+  public:
+    /**
+     * The version of the snapshot format written by Write.
+     */
+    static const u32 FORMAT_VERSION = 4;
+
+    /**
+     * The longest file name, including its directory, a snapshot
+     * chain may use.
+     */
+    static const u32 MAX_PATH_BYTES = 256;
+
+    /**
+     * The most snapshots, counting the full one, in any one chain.
+     */
+    static const u32 MAX_CHAIN_LENGTH = 64;
+
+    /**
+     * What WriteCheckpoint remembers about the latest checkpoint, to
+     * decide what the next one must hold.  A default-constructed
+     * Checkpoint makes the next checkpoint a full snapshot.
+     */
+    struct Checkpoint
+    {
+      Checkpoint() : m_deltas(0), m_elementCount(0)
+      {
+        m_path[0] = 0;
+      }
+
+      /** The file name (without directory) of the checkpoint, if any */
+      char m_path[MAX_PATH_BYTES];
+
+      /** How many deltas have followed the last full snapshot */
+      u32 m_deltas;
+
+      /** The element types as of the checkpoint */
+      u32 m_elementCount;
+      u32 m_types[MAX_ELEMENTS];
+
+      /** Each Tile's GetAtomChangeCount() as of the checkpoint, column by column */
+      u32 m_atomChanges[Grid<GC>::MAX_TILES];
+    };
+
+    /**
+     * Creates a GridSnapshot for saving or restoring \c grid.
+     */
+    GridSnapshot(Grid<GC> & grid) : m_grid(grid)
+    { }
+
+    /**
+     * Checks whether \c path names a file that looks like a snapshot
+     * (of any version), rather than a text configuration.
+     */
+    static bool IsSnapshotFile(const char * path) ;
+
+    /**
+     * Writes the complete state of the Grid to \c path, which is
+     * overwritten if it exists.  The Grid must be paused.
+     *
+     * @returns true on success; on failure logs an error and returns
+     *          false.
+     */
+    bool Write(const char * path) ;
+
+    /**
+     * Writes a checkpoint of the Grid to \c path, and updates \c last
+     * to describe it.  The checkpoint is a delta from \c last when
+     * possible, or else a full snapshot.  A full snapshot is written
+     * instead of a delta that would make \c maxDeltas deltas in a row,
+     * or when \c last describes no checkpoint, or when the elements
+     * have changed since.  Deltas must be written to the same
+     * directory as the checkpoint they follow.  The Grid must be
+     * paused.
+     *
+     * @returns true on success; on failure logs an error, resets \c
+     *          last, and returns false.
+     */
+    bool WriteCheckpoint(const char * path, Checkpoint & last, u32 maxDeltas) ;
+
+    /**
+     * Replaces the complete state of the Grid with that in the
+     * snapshot at \c path, reading its whole chain if it is a delta.
+     * The Grid must be paused.
+     *
+     * @returns true on success.  On failure, logs an error and
+     *          returns false, and the Grid may be left partly loaded.
+     */
+    bool Read(const char * path) ;
+
+  private:
+    static const u32 BYTE_ORDER_MARK = 0x01020304;
+
+    /**
+     * The fixed-size start of every snapshot file.
+     */
+    struct SnapshotHeader
+    {
+      char m_magic[8];
+      u32 m_version;
+      u32 m_byteOrderMark;
+
+      u32 m_bitsPerAtom;
+      u32 m_bytesPerAtom;
+      u32 m_eventWindowRadius;
+      u32 m_elementTableBits;
+      u32 m_tileWidth;
+      u32 m_elementDataSlots;
+      u32 m_gridWidth;
+      u32 m_gridHeight;
+      u32 m_randomGenerator;
+
+      u32 m_elementCount;
+      u32 m_elementTextBytes;
+
+      /** The size of a Tile record holding Atoms */
+      u32 m_tileRecordBytes;
+      u32 m_tilesOffset;
+
+      /** The number of Tile records holding Atoms; fewer than all only in deltas */
+      u32 m_atomTileCount;
+
+      /** 0 for a full snapshot; else how many deltas follow the full one */
+      u32 m_deltaDepth;
+
+      /** For a delta, the file name of the previous checkpoint */
+      char m_previous[MAX_PATH_BYTES];
+
+      u32 m_random[Random::STATE_WORDS];
+    };
+
+    /**
+     * A snapshot file mapped into memory, unmapped on destruction.
+     */
+    struct MappedSnapshot
+    {
+      MappedSnapshot() : m_mapped(0), m_size(0), m_header(0)
+      { }
+
+      ~MappedSnapshot()
+      {
+        if (m_mapped)
+        {
+          munmap(m_mapped, m_size);
+        }
+      }
+
+      const u32 * GetSavedTypes() const
+      {
+        return (const u32 *) (((const u8 *) m_mapped) + sizeof(SnapshotHeader));
+      }
+
+      const char * GetElementText() const
+      {
+        return (const char *) (GetSavedTypes() + m_header->m_elementCount);
+      }
+
+      const u8 * GetTileRecords() const
+      {
+        return ((const u8 *) m_mapped) + m_header->m_tilesOffset;
+      }
+
+      void * m_mapped;
+      size_t m_size;
+      const SnapshotHeader * m_header;
+    };
+
+    /**
+     * The fixed-size start of each Tile record.
+     */
+    struct TileHeader
+    {
+      u32 m_x;
+      u32 m_y;
+      u32 m_executingOwnEvents;
+      u32 m_hasAtoms;
+      u32 m_random[Random::STATE_WORDS];
+    };
+
+    static const char MAGIC[8];
+
+    Grid<GC> & m_grid;
+
+    static u32 SlotCountBytes(u32 elementCount)
+    {
+      // Keep the u64 data slots that follow aligned
+      return ((elementCount + 1) & ~1) * sizeof(u32);
+    }
+
+    static u32 TileRecordBytes(u32 elementCount, bool hasAtoms)
+    {
+      const u32 bytes = sizeof(TileHeader) + SlotCountBytes(elementCount) +
+        EDS * sizeof(u64) + (hasAtoms ? TILE_WIDTH * TILE_WIDTH * sizeof(T) : 0);
+      return (bytes + 63) & ~63;
+    }
+
+    void FillHeader(SnapshotHeader & header, u32 elementCount) ;
+
+    bool CheckHeader(const SnapshotHeader & header, const char * path) ;
+
+    bool Map(const char * path, MappedSnapshot & snap) ;
+
+    bool WriteSnapshot(const char * path, const Checkpoint * since) ;
+
+    bool WriteTile(s32 fd, u32 x, u32 y, u32 elementCount, bool withAtoms, const char * path) ;
+
+    /**
+     * Restores one Tile from \c record, returning the size of the
+     * record.
+     */
+    u32 ReadTile(const u8 * record, u32 elementCount,
+                 const u32 * savedTypes, const Element<CC> ** elements, bool retype) ;
+  };
+}
+
+#include "GridSnapshot.tcc"
+
+#endif /* GRIDSNAPSHOT_H */
@@ -0,0 +1,632 @@
+/* -*- C++ -*- */
+#include "ExternalConfigFunctions.h"
+#include "CharBufferByteSource.h"
+#include "FileByteSink.h"
+#include "AtomSerializer.h"
+#include "Util.h"            /* For IntLexEncode */
+#include <string.h>          /* For memcmp, memcpy, memset */
+#include <errno.h>           /* For errno */
+#include <fcntl.h>           /* For open */
+#include <unistd.h>          /* For close, pwrite, sysconf */
+#include <sys/mman.h>        /* For mmap */
+#include <sys/stat.h>        /* For fstat */
+#include <sys/uio.h>         /* For writev */
+
+namespace MFM
+{
+  template <class GC>
+  const char GridSnapshot<GC>::MAGIC[8] = { 'M', 'F', 'M', 'S', 'N', 'A', 'P', '\n' };
+
+  template <class GC>
+  bool GridSnapshot<GC>::IsSnapshotFile(const char * path)
+  {
+    FILE * fp = fopen(path, "r");
+    if (!fp)
+    {
+      return false;
+    }
+
+    char magic[sizeof(MAGIC)];
+    bool ret = fread(magic, sizeof(magic), 1, fp) == 1 &&
+      !memcmp(magic, MAGIC, sizeof(MAGIC));
+    fclose(fp);
+    return ret;
+  }
+
+  template <class GC>
+  void GridSnapshot<GC>::FillHeader(SnapshotHeader & header, u32 elementCount)
+  {
+    memset(&header, 0, sizeof(header));
+    memcpy(header.m_magic, MAGIC, sizeof(MAGIC));
+    header.m_version = FORMAT_VERSION;
+    header.m_byteOrderMark = BYTE_ORDER_MARK;
+
+    header.m_bitsPerAtom = P::BITS_PER_ATOM;
+    header.m_bytesPerAtom = sizeof(T);
+    header.m_eventWindowRadius = P::EVENT_WINDOW_RADIUS;
+    header.m_elementTableBits = P::ELEMENT_TABLE_BITS;
+    header.m_tileWidth = TILE_WIDTH;
+    header.m_elementDataSlots = EDS;
+    header.m_gridWidth = m_grid.GetWidth();
+    header.m_gridHeight = m_grid.GetHeight();
+    header.m_randomGenerator = Random::GENERATOR_ID;
+
+    header.m_elementCount = elementCount;
+    header.m_tileRecordBytes = TileRecordBytes(elementCount, true);
+
+    m_grid.GetRandom().SaveState(header.m_random);
+  }
+
+  template <class GC>
+  bool GridSnapshot<GC>::CheckHeader(const SnapshotHeader & header, const char * path)
+  {
+    SnapshotHeader ours;
+    FillHeader(ours, header.m_elementCount);
+
+    if (header.m_version != FORMAT_VERSION)
+    {
+      LOG.Error("'%s' is snapshot version %d, expected %d",
+                path, header.m_version, FORMAT_VERSION);
+      return false;
+    }
+
+    if (header.m_byteOrderMark != BYTE_ORDER_MARK)
+    {
+      LOG.Error("'%s' was saved with a different byte order", path);
+      return false;
+    }
+
+    // Everything from m_bitsPerAtom through m_randomGenerator must match
+    const u32 * theirs = &header.m_bitsPerAtom;
+    const u32 * mine = &ours.m_bitsPerAtom;
+    const u32 fields = &ours.m_randomGenerator - &ours.m_bitsPerAtom + 1;
+    for (u32 i = 0; i < fields; ++i)
+    {
+      if (theirs[i] != mine[i])
+      {
+        LOG.Error("'%s' was saved with a different configuration "
+                  "(header word %d: %d, expected %d)",
+                  path, i, theirs[i], mine[i]);
+        return false;
+      }
+    }
+
+    if (header.m_elementCount > MAX_ELEMENTS ||
+        header.m_tileRecordBytes != ours.m_tileRecordBytes)
+    {
+      LOG.Error("'%s' has an inconsistent header", path);
+      return false;
+    }
+
+    return true;
+  }
+
+  template <class GC>
+  bool GridSnapshot<GC>::WriteTile(s32 fd, u32 x, u32 y, u32 elementCount,
+                                   bool withAtoms, const char * path)
+  {
+    ElementRegistry<CC> & er = m_grid.GetElementRegistry();
+    Tile<CC> & tile = m_grid.GetTile(x, y);
+    ElementTable<CC> & et = tile.GetElementTable();
+
+    TileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.m_x = x;
+    header.m_y = y;
+    header.m_executingOwnEvents = m_grid.GetTileExecutionStatus(SPoint(x, y)) ? 1 : 0;
+    header.m_hasAtoms = withAtoms ? 1 : 0;
+    tile.GetRandom().SaveState(header.m_random);
+
+    // Element data slots, packed in registry order
+    u32 slotCounts[MAX_ELEMENTS + 1];
+    u64 slotData[EDS + 1];
+    u32 slotsUsed = 0;
+    memset(slotCounts, 0, sizeof(slotCounts));
+    memset(slotData, 0, sizeof(slotData));
+
+    for (u32 i = 0; i < elementCount; ++i)
+    {
+      const u32 type = er.GetEntryElement(i)->GetType();
+      const u32 slots = et.GetElementDataSlotCount(type);
+      const u64 * data = slots ? et.GetElementDataSlotsFromType(type, slots) : 0;
+      if (data && slotsUsed + slots <= EDS)
+      {
+        slotCounts[i] = slots;
+        memcpy(&slotData[slotsUsed], data, slots * sizeof(u64));
+        slotsUsed += slots;
+      }
+    }
+
+    const u32 atomBytes = withAtoms ? TILE_WIDTH * TILE_WIDTH * sizeof(T) : 0;
+    const u32 recordBytes = TileRecordBytes(elementCount, withAtoms);
+    const u32 usedBytes = sizeof(header) + SlotCountBytes(elementCount) +
+      EDS * sizeof(u64) + atomBytes;
+    static const u8 zeros[64] = { 0 };
+
+    struct iovec iov[5];
+    iov[0].iov_base = &header;
+    iov[0].iov_len = sizeof(header);
+    iov[1].iov_base = slotCounts;
+    iov[1].iov_len = SlotCountBytes(elementCount);
+    iov[2].iov_base = slotData;
+    iov[2].iov_len = EDS * sizeof(u64);
+    iov[3].iov_base = (void *) tile.GetAtomArray();
+    iov[3].iov_len = atomBytes;
+    iov[4].iov_base = (void *) zeros;
+    iov[4].iov_len = recordBytes - usedBytes;
+
+    const ssize_t wrote = writev(fd, iov, 5);
+    if (wrote != (ssize_t) recordBytes)
+    {
+      LOG.Error("Writing tile (%d,%d) to '%s' failed: %s",
+                x, y, path, wrote < 0 ? strerror(errno) : "short write");
+      return false;
+    }
+    return true;
+  }
+
+  template <class GC>
+  bool GridSnapshot<GC>::Write(const char * path)
+  {
+    return WriteSnapshot(path, 0);
+  }
+
+  template <class GC>
+  bool GridSnapshot<GC>::WriteCheckpoint(const char * path, Checkpoint & last, u32 maxDeltas)
+  {
+    ElementRegistry<CC> & er = m_grid.GetElementRegistry();
+    const u32 elementCount = er.GetEntryCount();
+
+    bool delta = last.m_path[0] != 0 &&
+      last.m_deltas < MIN(maxDeltas, MAX_CHAIN_LENGTH - 1) &&
+      last.m_elementCount == elementCount;
+    for (u32 i = 0; delta && i < elementCount; ++i)
+    {
+      delta = last.m_types[i] == er.GetEntryElement(i)->GetType();
+    }
+
+    const char * slash = strrchr(path, '/');
+    const char * name = slash ? slash + 1 : path;
+    bool ok = strlen(path) < MAX_PATH_BYTES;
+    if (!ok)
+    {
+      LOG.Error("Checkpoint path too long: '%s'", path);
+    }
+    else
+    {
+      ok = WriteSnapshot(path, delta ? &last : 0);
+    }
+
+    if (!ok)
+    {
+      last.m_path[0] = 0;
+      return false;
+    }
+
+    strcpy(last.m_path, name);
+    last.m_deltas = delta ? last.m_deltas + 1 : 0;
+    last.m_elementCount = elementCount;
+    for (u32 i = 0; i < elementCount; ++i)
+    {
+      last.m_types[i] = er.GetEntryElement(i)->GetType();
+    }
+    const u32 H = m_grid.GetHeight();
+    for (u32 x = 0; x < m_grid.GetWidth(); ++x)
+    {
+      for (u32 y = 0; y < H; ++y)
+      {
+        last.m_atomChanges[x * H + y] = m_grid.GetTile(x, y).GetAtomChangeCount();
+      }
+    }
+    return true;
+  }
+
+  template <class GC>
+  bool GridSnapshot<GC>::WriteSnapshot(const char * path, const Checkpoint * since)
+  {
+    ElementRegistry<CC> & er = m_grid.GetElementRegistry();
+    const u32 elementCount = er.GetEntryCount();
+
+    // Deltas hold Atoms only for the Tiles changed since the last checkpoint
+    const u32 W = m_grid.GetWidth();
+    const u32 H = m_grid.GetHeight();
+    bool changed[Grid<GC>::MAX_TILES];
+    u32 atomTileCount = 0;
+    for (u32 x = 0; x < W; ++x)
+    {
+      for (u32 y = 0; y < H; ++y)
+      {
+        const u32 i = x * H + y;
+        changed[i] = !since ||
+          since->m_atomChanges[i] != m_grid.GetTile(x, y).GetAtomChangeCount();
+        if (changed[i])
+        {
+          ++atomTileCount;
+        }
+      }
+    }
+
+    FILE * fp = fopen(path, "w");
+    if (!fp)
+    {
+      LOG.Error("Can't write snapshot '%s': %s", path, strerror(errno));
+      return false;
+    }
+
+    SnapshotHeader header;
+    FillHeader(header, elementCount);
+    header.m_atomTileCount = atomTileCount;
+    if (since)
+    {
+      header.m_deltaDepth = since->m_deltas + 1;
+      strcpy(header.m_previous, since->m_path);
+    }
+
+    u32 savedTypes[MAX_ELEMENTS];
+    for (u32 i = 0; i < elementCount; ++i)
+    {
+      savedTypes[i] = er.GetEntryElement(i)->GetType();
+    }
+
+    // The header is rewritten once the text length is known
+    fwrite(&header, sizeof(header), 1, fp);
+    fwrite(savedTypes, sizeof(u32), elementCount, fp);
+
+    const long textStart = ftell(fp);
+    {
+      FileByteSink fbs(fp);
+      ExternalConfig<GC> cfg(m_grid);
+      cfg.WriteElements(fbs);
+    }
+    const long textEnd = ftell(fp);
+
+    const long pageSize = sysconf(_SC_PAGESIZE);
+    const long tilesOffset = (textEnd + pageSize - 1) / pageSize * pageSize;
+    for (long i = textEnd; i < tilesOffset; ++i)
+    {
+      fputc(0, fp);
+    }
+
+    bool ok = fflush(fp) == 0 && !ferror(fp);
+    if (!ok)
+    {
+      LOG.Error("Writing '%s' failed: %s", path, strerror(errno));
+    }
+
+    const s32 fd = fileno(fp);
+    for (u32 x = 0; ok && x < W; ++x)
+    {
+      for (u32 y = 0; ok && y < H; ++y)
+      {
+        ok = WriteTile(fd, x, y, elementCount, changed[x * H + y], path);
+      }
+    }
+
+    if (ok)
+    {
+      header.m_elementTextBytes = (u32) (textEnd - textStart);
+      header.m_tilesOffset = (u32) tilesOffset;
+      if (pwrite(fd, &header, sizeof(header), 0) != (ssize_t) sizeof(header))
+      {
+        LOG.Error("Writing '%s' header failed: %s", path, strerror(errno));
+        ok = false;
+      }
+    }
+
+    if (fclose(fp) != 0)
+    {
+      ok = false;
+    }
+
+    if (ok && since)
+    {
+      LOG.Message("Checkpoint %s: %d of %d tiles changed", path, atomTileCount, W * H);
+    }
+    return ok;
+  }
+
+  template <class GC>
+  u32 GridSnapshot<GC>::ReadTile(const u8 * record, u32 elementCount,
+                                 const u32 * savedTypes, const Element<CC> ** elements,
+                                 bool retype)
+  {
+    const TileHeader & header = *(const TileHeader *) record;
+    const u32 * slotCounts = (const u32 *) (record + sizeof(TileHeader));
+    const u64 * slotData =
+      (const u64 *) (record + sizeof(TileHeader) + SlotCountBytes(elementCount));
+    const T * atoms = (const T *) (((const u8 *) slotData) + EDS * sizeof(u64));
+
+    const SPoint tileLoc(header.m_x, header.m_y);
+    Tile<CC> & tile = m_grid.GetTile(tileLoc);
+
+    m_grid.SetTileToExecuteOnly(tileLoc, header.m_executingOwnEvents != 0);
+    tile.GetRandom().LoadState(header.m_random);
+
+    // Without Atoms, the Tile keeps those of an earlier checkpoint
+    if (header.m_hasAtoms)
+    {
+      tile.LoadAtomArray(atoms);
+    }
+
+    if (header.m_hasAtoms && retype)
+    {
+      const Element<CC> & empty = Element_Empty<CC>::THE_INSTANCE;
+      for (u32 x = 0; x < TILE_WIDTH; ++x)
+      {
+        for (u32 y = 0; y < TILE_WIDTH; ++y)
+        {
+          T * atom = tile.GetWritableAtom(x, y);
+          const u32 type = atom->GetType();
+
+          const Element<CC> * elt = &empty;
+          for (u32 i = 0; i < elementCount; ++i)
+          {
+            if (savedTypes[i] == type)
+            {
+              if (elements[i])
+              {
+                elt = elements[i];
+              }
+              break;
+            }
+          }
+
+          if (elt->GetType() != type)
+          {
+            T retyped = elt->GetDefaultAtom();
+            if (elt != &empty)
+            {
+              AtomSerializer<CC> as(*atom);
+              retyped.ReadStateBits(as.GetBits());
+            }
+            *atom = retyped;
+          }
+        }
+      }
+      tile.RecountAtoms();
+    }
+
+    ElementTable<CC> & et = tile.GetElementTable();
+    u32 slotsUsed = 0;
+    for (u32 i = 0; i < elementCount; ++i)
+    {
+      const u32 slots = slotCounts[i];
+      if (slots == 0)
+      {
+        continue;
+      }
+      if (elements[i] && slotsUsed + slots <= EDS)
+      {
+        const u32 type = elements[i]->GetType();
+        u64 * data = 0;
+        if (et.AllocateElementDataSlotsFromType(type, slots))
+        {
+          data = et.GetElementDataSlotsFromType(type, slots);
+        }
+        if (data)
+        {
+          memcpy(data, &slotData[slotsUsed], slots * sizeof(u64));
+        }
+        else
+        {
+          LOG.Warning("Dropping %d element data slots for type 0x%04x in tile %s",
+                      slots, type, tile.GetLabel());
+        }
+      }
+      slotsUsed += slots;
+    }
+
+    return TileRecordBytes(elementCount, header.m_hasAtoms != 0);
+  }
+
+  template <class GC>
+  bool GridSnapshot<GC>::Map(const char * path, MappedSnapshot & snap)
+  {
+    const s32 fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+      LOG.Error("Can't read snapshot '%s': %s", path, strerror(errno));
+      return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t) sizeof(SnapshotHeader))
+    {
+      LOG.Error("'%s' is too short to be a snapshot", path);
+      close(fd);
+      return false;
+    }
+
+    void * mapped = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED)
+    {
+      LOG.Error("Can't map snapshot '%s': %s", path, strerror(errno));
+      return false;
+    }
+
+    snap.m_mapped = mapped;
+    snap.m_size = st.st_size;
+    snap.m_header = (const SnapshotHeader *) mapped;
+
+    const SnapshotHeader & header = *snap.m_header;
+    if (memcmp(header.m_magic, MAGIC, sizeof(MAGIC)))
+    {
+      LOG.Error("'%s' is not a snapshot", path);
+      return false;
+    }
+
+    if (!CheckHeader(header, path))
+    {
+      return false;
+    }
+
+    const u64 textStart = sizeof(SnapshotHeader) + header.m_elementCount * sizeof(u32);
+    if (textStart + header.m_elementTextBytes > header.m_tilesOffset ||
+        header.m_tilesOffset > snap.m_size)
+    {
+      LOG.Error("'%s' is truncated", path);
+      return false;
+    }
+
+    const u32 W = m_grid.GetWidth();
+    const u32 H = m_grid.GetHeight();
+    if (header.m_atomTileCount > W * H ||
+        (header.m_deltaDepth == 0 && header.m_atomTileCount != W * H) ||
+        memchr(header.m_previous, 0, MAX_PATH_BYTES) == 0)
+    {
+      LOG.Error("'%s' has an inconsistent header", path);
+      return false;
+    }
+
+    // Records vary in size, so walk them all before trusting any
+    const u32 stateBytes = TileRecordBytes(header.m_elementCount, false);
+    u64 offset = header.m_tilesOffset;
+    u32 atomTiles = 0;
+    for (u32 x = 0; x < W; ++x)
+    {
+      for (u32 y = 0; y < H; ++y)
+      {
+        if (offset + stateBytes > snap.m_size)
+        {
+          LOG.Error("'%s' is truncated", path);
+          return false;
+        }
+
+        const TileHeader & th = *(const TileHeader *) (((const u8 *) snap.m_mapped) + offset);
+        if (th.m_x != x || th.m_y != y)
+        {
+          LOG.Error("'%s' has a misplaced record for tile (%d,%d)", path, th.m_x, th.m_y);
+          return false;
+        }
+
+        if (th.m_hasAtoms)
+        {
+          ++atomTiles;
+        }
+        offset += TileRecordBytes(header.m_elementCount, th.m_hasAtoms != 0);
+        if (offset > snap.m_size)
+        {
+          LOG.Error("'%s' is truncated", path);
+          return false;
+        }
+      }
+    }
+
+    if (atomTiles != header.m_atomTileCount)
+    {
+      LOG.Error("'%s' has an inconsistent header", path);
+      return false;
+    }
+
+    return true;
+  }
+
+  template <class GC>
+  bool GridSnapshot<GC>::Read(const char * path)
+  {
+    // Find the chain back to a full snapshot, newest first
+    char paths[MAX_CHAIN_LENGTH][MAX_PATH_BYTES];
+    MappedSnapshot snaps[MAX_CHAIN_LENGTH];
+    u32 count = 0;
+
+    if (strlen(path) >= MAX_PATH_BYTES)
+    {
+      LOG.Error("Snapshot path too long: '%s'", path);
+      return false;
+    }
+    strcpy(paths[0], path);
+
+    while (true)
+    {
+      if (!Map(paths[count], snaps[count]))
+      {
+        return false;
+      }
+
+      const SnapshotHeader & header = *snaps[count].m_header;
+      ++count;
+
+      if (header.m_deltaDepth == 0)
+      {
+        break;
+      }
+
+      if (count >= MAX_CHAIN_LENGTH)
+      {
+        LOG.Error("Snapshot chain from '%s' is too long", path);
+        return false;
+      }
+
+      // Previous checkpoints live in the same directory
+      const char * dir = paths[count - 1];
+      const char * slash = strrchr(dir, '/');
+      const u32 dirLength = slash ? slash - dir + 1 : 0;
+      if (dirLength + strlen(header.m_previous) >= MAX_PATH_BYTES)
+      {
+        LOG.Error("Snapshot path too long: '%s'", header.m_previous);
+        return false;
+      }
+      memcpy(paths[count], dir, dirLength);
+      strcpy(paths[count] + dirLength, header.m_previous);
+    }
+
+    const MappedSnapshot & full = snaps[count - 1];
+    const u32 elementCount = full.m_header->m_elementCount;
+    const u32 * savedTypes = full.GetSavedTypes();
+
+    for (u32 i = 0; i + 1 < count; ++i)
+    {
+      if (snaps[i].m_header->m_elementCount != elementCount ||
+          memcmp(snaps[i].GetSavedTypes(), savedTypes, elementCount * sizeof(u32)))
+      {
+        LOG.Error("Elements in '%s' don't match those in '%s'", paths[i], paths[count - 1]);
+        return false;
+      }
+    }
+
+    // Registering the elements also clears the grid
+    ExternalConfig<GC> cfg(m_grid);
+    RegisterExternalConfigFunctions<GC>(cfg);
+    CharBufferByteSource cbs(full.GetElementText(), full.m_header->m_elementTextBytes);
+    cfg.SetByteSource(cbs, paths[count - 1]);
+    if (!cfg.Read())
+    {
+      return false;
+    }
+
+    const Element<CC> * elements[MAX_ELEMENTS];
+    bool retype = false;
+    char lexOutput[24];
+
+    for (u32 i = 0; i < elementCount; ++i)
+    {
+      OString16 nick;
+      IntLexEncode(i, lexOutput);
+      nick.Printf("%s", lexOutput);
+      elements[i] = cfg.LookupElement(nick);
+      if (!elements[i] || elements[i]->GetType() != savedTypes[i])
+      {
+        retype = true;
+      }
+    }
+
+    // Oldest first, so each Tile ends up as of its latest record
+    for (s32 i = count - 1; i >= 0; --i)
+    {
+      const u8 * record = snaps[i].GetTileRecords();
+      for (u32 t = 0; t < m_grid.GetWidth() * m_grid.GetHeight(); ++t)
+      {
+        record += ReadTile(record, elementCount, savedTypes, elements, retype);
+      }
+    }
+
+    m_grid.GetRandom().LoadState(snaps[0].m_header->m_random);
+
+    if (count > 1)
+    {
+      LOG.Message("Reconstructed '%s' from %d checkpoints", path, count);
+    }
+    return true;
+  }
+}
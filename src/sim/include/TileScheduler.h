@@ -0,0 +1,265 @@
+/*                                              -*- mode:C++ -*-
+  TileScheduler.h Worker pool running Tile events in batches
+  Copyright (C) 2014 The Regents of the University of New Mexico.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file TileScheduler.h Worker pool running Tile events in batches
+  \author David H. Ackley.
+  \date (C) 2014 All rights reserved.
+  \lgpl
+ */
+#ifndef TILESCHEDULER_H
+#define TILESCHEDULER_H
+
+#include <pthread.h>
+#include "itype.h"
+#include "Tile.h"
+#include "Random.h"
+#include "Mutex.h"
+#include "EventCount.h"
+#include "CoreAffinity.h"
+#include "Logger.h"
+
+namespace MFM {
+
+  template <class GC> class Grid;  // FORWARD
+
+  /**
+   * An alternative to running each Tile of a Grid on its own thread:
+   * a fixed pool of worker threads, each repeatedly claiming some
+   * Tile and running a batch of events on it.
+   *
+   * A worker claims not just the Tile it runs but all of that Tile's
+   * neighbors as well, so two Tiles are never run at once if they
+   * have a neighbor in common.  That lets the worker process the
+   * neighbors' sides of each event itself -- see
+   * Tile::ExecuteEvents -- so no event ever waits on another thread.
+   *
+   * Work is dealt out in rounds in which every Tile gets one batch.
+   * Each worker starts a round with a shuffled share of the Tiles,
+   * taken from a compact block of the Grid so that most of its
+   * neighbors are its own, and steals from other workers whenever
+   * none of its remaining Tiles can be claimed.
+   */
+  template <class GC>
+  class TileScheduler
+  {
+    // Extract short type names
+    typedef typename GC::CORE_CONFIG CC;
+
+  public:
+    /**
+     * The most worker threads a TileScheduler will use.  This only
+     * sizes m_workers, which is fixed so workers never move.  Since
+     * each worker claims a Tile and its eight neighbors, at most
+     * about a ninth of the Tiles can run at once.  More workers than
+     * this would only help Grids of well over 500 Tiles.
+     */
+    static const u32 MAX_WORKERS = 64;
+
+    /**
+     * The default number of events run on a Tile each time it is
+     * claimed; see SetEventsPerBatch.  A claim costs a mutex and nine
+     * atomic claims, which 100 events (about 100 times that much work)
+     * amortize.  A batch is still short enough that Pause, which
+     * waits out the batches in progress, returns promptly.
+     */
+    static const u32 DEFAULT_EVENTS_PER_BATCH = 100;
+
+  private:
+    /**
+     * How long a parked worker, or a pausing caller, sleeps before
+     * looking around again even if not notified.
+     */
+    static const u32 PARK_TIMEOUT_MICROS = 100000;
+
+    /**
+     * One worker thread, and its share of the current round.
+     */
+    struct Worker
+    {
+      TileScheduler * m_scheduler;
+      pthread_t m_thread;
+      Random m_random;
+
+      /** Guards m_tiles and m_tileCount against thieves */
+      Mutex m_lock;
+
+      /** Indices of the Tiles yet to run this round, in no particular order */
+      u32 * m_tiles;
+      u32 m_tileCount;
+
+      u64 m_batches;
+      u64 m_steals;
+      u64 m_claimFailures;
+    };
+
+    Grid<GC> & m_grid;
+
+    /** The number of Tiles in m_grid, as of when the workers started */
+    u32 m_gridTiles;
+
+    Worker m_workers[MAX_WORKERS];
+
+    u32 m_workerCount;
+
+    u32 m_eventsPerBatch;
+
+    bool m_started;
+
+    /** Nonzero while workers should be running batches. */
+    u32 m_running;
+
+    /** Nonzero once workers should exit. */
+    u32 m_quitting;
+
+    /** The number of workers currently parked. */
+    u32 m_parkedWorkers;
+
+    /** The number of Tiles not yet finished in the current round. */
+    u32 m_unfinishedTiles;
+
+    /** Nonzero for each Tile currently claimed by some worker. */
+    u32 * m_claims;
+
+    /** CPUs to pin the workers to, ordered by socket, if m_cpuCount > 0 */
+    u32 m_cpus[CoreAffinity::MAX_CPUS];
+    u32 m_cpuCount;
+
+    /** Notified when workers should stop parking */
+    EventCount m_runSignal;
+
+    /** Notified whenever a worker parks */
+    EventCount m_parkSignal;
+
+    static Tile<CC> & TileAt(Grid<GC> & grid, u32 tileIndex);
+
+    bool TryClaim(u32 tileIndex);
+
+    void Release(u32 tileIndex);
+
+    bool TakeFrom(Worker & from, bool fromFront, u32 & tileIndex, u64 & claimFailures);
+
+    bool TakeTile(Worker & worker, u32 & tileIndex);
+
+    void StartRound();
+
+    void Park();
+
+    void RunWorker(Worker & worker);
+
+    static void * WorkerThreadHelper(void * workerPtr);
+
+  public:
+
+    TileScheduler(Grid<GC> & grid) :
+      m_grid(grid),
+      m_gridTiles(0),
+      m_workerCount(0),
+      m_eventsPerBatch(DEFAULT_EVENTS_PER_BATCH),
+      m_started(false),
+      m_running(0),
+      m_quitting(0),
+      m_parkedWorkers(0),
+      m_unfinishedTiles(0),
+      m_claims(0),
+      m_cpuCount(0)
+    {
+      for (u32 w = 0; w < MAX_WORKERS; ++w)
+      {
+        m_workers[w].m_tiles = 0;
+      }
+    }
+
+    /**
+     * Stops.
+     */
+    ~TileScheduler()
+    {
+      Stop();
+    }
+
+    /**
+     * Sets the number of worker threads to use, once started.  0
+     * means one per online processor.  No more than MAX_WORKERS, or
+     * than the Grid has Tiles when started, are used.  FAILs with
+     * ILLEGAL_STATE if the workers have already been started.
+     */
+    void SetWorkerCount(u32 count);
+
+    /**
+     * Pins the workers, once started, across the given CPUs (as
+     * ordered by CoreAffinity::GetCPUsBySocket), so that workers with
+     * neighboring shares of the Grid share a socket.  A \c count of 0
+     * means no pinning.  FAILs with ILLEGAL_STATE if the workers have
+     * already been started.
+     */
+    void SetPinnedCPUs(const u32 * cpus, u32 count);
+
+    /**
+     * Sets how many events a worker runs on each Tile it claims.
+     * Larger batches spend less time claiming; smaller ones interleave
+     * neighboring Tiles more finely.  FAILs with ILLEGAL_ARGUMENT if
+     * \c count is 0, and with ILLEGAL_STATE if the workers have
+     * already been started.
+     */
+    void SetEventsPerBatch(u32 count);
+
+    u32 GetEventsPerBatch() const
+    {
+      return m_eventsPerBatch;
+    }
+
+    u32 GetWorkerCount() const
+    {
+      return m_workerCount;
+    }
+
+    bool IsStarted() const
+    {
+      return m_started;
+    }
+
+    /**
+     * Lets the workers run batches, starting them if necessary.  The
+     * Grid's dimensions must not change while they are started.
+     */
+    void Run();
+
+    /**
+     * Stops and joins all worker threads, if any were started, each
+     * once it finishes any batch in progress.  Afterwards no worker
+     * refers to the Grid.
+     */
+    void Stop();
+
+    /**
+     * Returns once every worker has finished its current batch and
+     * parked.  Afterwards no events are in progress anywhere in the
+     * Grid, and all intertile traffic has been processed.
+     */
+    void Pause();
+
+    void ReportSchedulerStatus(Logger::Level level);
+  };
+} /* namespace MFM */
+
+#include "TileScheduler.tcc"
+
+#endif /*TILESCHEDULER_H*/
@@ -0,0 +1,386 @@
+/* -*- C++ -*- */
+#include <unistd.h>   /* For sysconf */
+#include <stdlib.h>   /* For malloc, free */
+
+namespace MFM {
+
+  template <class GC>
+  Tile<typename GC::CORE_CONFIG> & TileScheduler<GC>::TileAt(Grid<GC> & grid, u32 tileIndex)
+  {
+    return grid.GetTile(tileIndex / grid.GetHeight(), tileIndex % grid.GetHeight());
+  }
+
+  template <class GC>
+  bool TileScheduler<GC>::TryClaim(u32 tileIndex)
+  {
+    const s32 W = m_grid.GetWidth();
+    const s32 H = m_grid.GetHeight();
+    const s32 tx = tileIndex / H;
+    const s32 ty = tileIndex % H;
+
+    u32 claimed[9];
+    u32 claimedCount = 0;
+
+    // Claim the whole neighborhood, or none of it
+    for (s32 x = tx - 1; x <= tx + 1; ++x)
+    {
+      for (s32 y = ty - 1; y <= ty + 1; ++y)
+      {
+        if (x < 0 || y < 0 || x >= W || y >= H)
+        {
+          continue;
+        }
+        const u32 idx = x * H + y;
+        u32 expected = 0;
+        if (!__atomic_compare_exchange_n(&m_claims[idx], &expected, 1, false,
+                                         __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        {
+          while (claimedCount > 0)
+          {
+            __atomic_store_n(&m_claims[claimed[--claimedCount]], 0, __ATOMIC_RELEASE);
+          }
+          return false;
+        }
+        claimed[claimedCount++] = idx;
+      }
+    }
+    return true;
+  }
+
+  template <class GC>
+  void TileScheduler<GC>::Release(u32 tileIndex)
+  {
+    const s32 W = m_grid.GetWidth();
+    const s32 H = m_grid.GetHeight();
+    const s32 tx = tileIndex / H;
+    const s32 ty = tileIndex % H;
+
+    for (s32 x = tx - 1; x <= tx + 1; ++x)
+    {
+      for (s32 y = ty - 1; y <= ty + 1; ++y)
+      {
+        if (x < 0 || y < 0 || x >= W || y >= H)
+        {
+          continue;
+        }
+        __atomic_store_n(&m_claims[x * H + y], 0, __ATOMIC_RELEASE);
+      }
+    }
+  }
+
+  template <class GC>
+  bool TileScheduler<GC>::TakeFrom(Worker & from, bool fromFront, u32 & tileIndex,
+                                   u64 & claimFailures)
+  {
+    Mutex::ScopeLock lock(from.m_lock);
+
+    for (u32 i = 0; i < from.m_tileCount; ++i)
+    {
+      const u32 slot = fromFront ? i : from.m_tileCount - 1 - i;
+      if (TryClaim(from.m_tiles[slot]))
+      {
+        tileIndex = from.m_tiles[slot];
+        from.m_tiles[slot] = from.m_tiles[--from.m_tileCount];
+        return true;
+      }
+      ++claimFailures;
+    }
+    return false;
+  }
+
+  template <class GC>
+  bool TileScheduler<GC>::TakeTile(Worker & worker, u32 & tileIndex)
+  {
+    // Owners take from the front, thieves from the back
+    if (TakeFrom(worker, true, tileIndex, worker.m_claimFailures))
+    {
+      return true;
+    }
+
+    const u32 self = &worker - m_workers;
+    const u32 start = worker.m_random.Create(m_workerCount);
+    for (u32 i = 0; i < m_workerCount; ++i)
+    {
+      const u32 victim = (start + i) % m_workerCount;
+      if (victim != self &&
+          TakeFrom(m_workers[victim], false, tileIndex, worker.m_claimFailures))
+      {
+        ++worker.m_steals;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  template <class GC>
+  void TileScheduler<GC>::StartRound()
+  {
+    // Count first, so no early finisher can see zero during the deal
+    __atomic_store_n(&m_unfinishedTiles, m_gridTiles, __ATOMIC_SEQ_CST);
+
+    for (u32 w = 0; w < m_workerCount; ++w)
+    {
+      Worker & worker = m_workers[w];
+      const u32 first = w * m_gridTiles / m_workerCount;
+      const u32 limit = (w + 1) * m_gridTiles / m_workerCount;
+
+      Mutex::ScopeLock lock(worker.m_lock);
+      worker.m_tileCount = 0;
+      for (u32 i = first; i < limit; ++i)
+      {
+        // Inside-out Fisher-Yates shuffle as we deal
+        const u32 j = worker.m_random.Create(worker.m_tileCount + 1);
+        worker.m_tiles[worker.m_tileCount++] = worker.m_tiles[j];
+        worker.m_tiles[j] = i;
+      }
+    }
+  }
+
+  template <class GC>
+  void TileScheduler<GC>::Park()
+  {
+    __atomic_add_fetch(&m_parkedWorkers, 1, __ATOMIC_SEQ_CST);
+    m_parkSignal.Notify();
+
+    while (true)
+    {
+      const u32 key = m_runSignal.PrepareWait();
+      if (__atomic_load_n(&m_running, __ATOMIC_SEQ_CST) ||
+          __atomic_load_n(&m_quitting, __ATOMIC_SEQ_CST))
+      {
+        break;
+      }
+      m_runSignal.Wait(key, PARK_TIMEOUT_MICROS);
+    }
+
+    // Our caller rechecks m_running after this, so a Pause that
+    // still counted us as parked cannot be fooled.
+    __atomic_sub_fetch(&m_parkedWorkers, 1, __ATOMIC_SEQ_CST);
+  }
+
+  template <class GC>
+  void TileScheduler<GC>::RunWorker(Worker & worker)
+  {
+    while (!__atomic_load_n(&m_quitting, __ATOMIC_SEQ_CST))
+    {
+      if (!__atomic_load_n(&m_running, __ATOMIC_SEQ_CST))
+      {
+        Park();
+        continue;
+      }
+
+      u32 tileIndex;
+      if (!TakeTile(worker, tileIndex))
+      {
+        // Everything left this round is near someone else's work
+        pthread_yield();
+        continue;
+      }
+
+      TileAt(m_grid, tileIndex).ExecuteEvents(m_eventsPerBatch);
+      Release(tileIndex);
+      ++worker.m_batches;
+
+      if (__atomic_sub_fetch(&m_unfinishedTiles, 1, __ATOMIC_SEQ_CST) == 0)
+      {
+        StartRound();
+      }
+    }
+  }
+
+  template <class GC>
+  void* TileScheduler<GC>::WorkerThreadHelper(void* arg)
+  {
+    Worker * worker = (Worker*) arg;
+
+    // FAILs outside any unwind_protect abort, as on a Tile thread
+    MFMErrorEnvironmentPointer_t errorEnvironmentStackTop = 0;
+    MFMPtrToErrEnvStackPtr = &errorEnvironmentStackTop;
+
+    TileScheduler & scheduler = *worker->m_scheduler;
+    if (scheduler.m_cpuCount > 0)
+    {
+      // Shares are dealt in grid order, so keep worker order too
+      const u32 index = worker - scheduler.m_workers;
+      const u32 cpu =
+        scheduler.m_cpus[index * scheduler.m_cpuCount / scheduler.m_workerCount];
+      if (!CoreAffinity::PinCurrentThread(cpu))
+      {
+        LOG.Warning("Worker %d could not be pinned to CPU %d", index, cpu);
+      }
+    }
+
+    scheduler.RunWorker(*worker);
+    return NULL;
+  }
+
+  template <class GC>
+  void TileScheduler<GC>::Stop()
+  {
+    if (!m_started)
+    {
+      return;
+    }
+
+    __atomic_store_n(&m_quitting, 1, __ATOMIC_SEQ_CST);
+    m_runSignal.Notify();
+
+    for (u32 w = 0; w < m_workerCount; ++w)
+    {
+      pthread_join(m_workers[w].m_thread, NULL);
+      free(m_workers[w].m_tiles);
+      m_workers[w].m_tiles = 0;
+    }
+    free(m_claims);
+    m_claims = 0;
+
+    m_started = false;
+    __atomic_store_n(&m_running, 0, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&m_quitting, 0, __ATOMIC_SEQ_CST);
+  }
+
+  template <class GC>
+  void TileScheduler<GC>::SetWorkerCount(u32 count)
+  {
+    if (m_started)
+    {
+      FAIL(ILLEGAL_STATE);
+    }
+
+    if (count == 0)
+    {
+      const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+      count = cores > 0 ? (u32) cores : 1;
+    }
+
+    m_workerCount = MIN(count, MAX_WORKERS);
+  }
+
+  template <class GC>
+  void TileScheduler<GC>::SetEventsPerBatch(u32 count)
+  {
+    if (m_started)
+    {
+      FAIL(ILLEGAL_STATE);
+    }
+    if (count == 0)
+    {
+      FAIL(ILLEGAL_ARGUMENT);
+    }
+    m_eventsPerBatch = count;
+  }
+
+  template <class GC>
+  void TileScheduler<GC>::SetPinnedCPUs(const u32 * cpus, u32 count)
+  {
+    if (m_started)
+    {
+      FAIL(ILLEGAL_STATE);
+    }
+
+    m_cpuCount = MIN(count, CoreAffinity::MAX_CPUS);
+    for (u32 i = 0; i < m_cpuCount; ++i)
+    {
+      m_cpus[i] = cpus[i];
+    }
+  }
+
+  template <class GC>
+  void TileScheduler<GC>::Run()
+  {
+    if (m_workerCount == 0)
+    {
+      FAIL(ILLEGAL_STATE);  // SetWorkerCount first
+    }
+
+    if (m_started)
+    {
+      __atomic_store_n(&m_running, 1, __ATOMIC_SEQ_CST);
+      m_runSignal.Notify();
+      return;
+    }
+
+    m_gridTiles = m_grid.GetWidth() * m_grid.GetHeight();
+    m_workerCount = MIN(m_workerCount, m_gridTiles);
+
+    m_claims = (u32 *) calloc(m_gridTiles, sizeof(u32));
+    if (!m_claims)
+    {
+      FAIL(OUT_OF_RESOURCES);
+    }
+
+    for (u32 i = 0; i < m_gridTiles; ++i)
+    {
+      Tile<CC> & tile = TileAt(m_grid, i);
+      tile.SetExternallyScheduled(true);
+      tile.RequestRecount();  // By its worker, when it runs
+    }
+
+    for (u32 w = 0; w < m_workerCount; ++w)
+    {
+      Worker & worker = m_workers[w];
+      worker.m_tiles = (u32 *) malloc(m_gridTiles * sizeof(u32));
+      if (!worker.m_tiles)
+      {
+        FAIL(OUT_OF_RESOURCES);
+      }
+      worker.m_scheduler = this;
+      worker.m_random.SetSeed(m_grid.GetRandom().Create());
+      worker.m_tileCount = 0;
+      worker.m_batches = worker.m_steals = worker.m_claimFailures = 0;
+    }
+
+    StartRound();
+
+    m_started = true;
+    __atomic_store_n(&m_running, 1, __ATOMIC_SEQ_CST);
+
+    for (u32 w = 0; w < m_workerCount; ++w)
+    {
+      if (pthread_create(&m_workers[w].m_thread, NULL, WorkerThreadHelper, &m_workers[w]))
+      {
+        FAIL(ILLEGAL_STATE);
+      }
+    }
+
+    LOG.Message("Running %d tiles on %d worker threads", m_gridTiles, m_workerCount);
+  }
+
+  template <class GC>
+  void TileScheduler<GC>::Pause()
+  {
+    if (!m_started)
+    {
+      return;
+    }
+
+    __atomic_store_n(&m_running, 0, __ATOMIC_SEQ_CST);
+
+    while (true)
+    {
+      const u32 key = m_parkSignal.PrepareWait();
+      if (__atomic_load_n(&m_parkedWorkers, __ATOMIC_SEQ_CST) == m_workerCount)
+      {
+        break;
+      }
+      m_parkSignal.Wait(key, PARK_TIMEOUT_MICROS);
+    }
+  }
+
+  template <class GC>
+  void TileScheduler<GC>::ReportSchedulerStatus(Logger::Level level)
+  {
+    LOG.Log(level," Worker threads: %d%s", m_workerCount, m_started ? "" : " (not started)");
+    LOG.Log(level," Pinned across CPUs: %d", m_cpuCount);
+    LOG.Log(level," Tiles unfinished this round: %d",
+            __atomic_load_n(&m_unfinishedTiles, __ATOMIC_SEQ_CST));
+    for (u32 w = 0; w < m_workerCount; ++w)
+    {
+      const Worker & worker = m_workers[w];
+      LOG.Log(level,"  Worker %d: %d batches, %d stolen, %d claim failures, %d queued",
+              w, (u32) worker.m_batches, (u32) worker.m_steals,
+              (u32) worker.m_claimFailures, worker.m_tileCount);
+    }
+  }
+
+} /* namespace MFM */
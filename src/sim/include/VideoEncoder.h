@@ -0,0 +1,289 @@
+/*                                              -*- mode:C++ -*-
+  VideoEncoder.h Background encoder writing frames to one video file
+  Copyright (C) 2014 The Regents of the University of New Mexico.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file VideoEncoder.h Background encoder writing frames to one video file
+  \author David H. Ackley.
+  \date (C) 2014 All rights reserved.
+  \lgpl
+ */
+#ifndef VIDEOENCODER_H
+#define VIDEOENCODER_H
+
+#include <stdio.h>      /* For FILE */
+#include "itype.h"
+#include "BufferPoolThread.h"
+
+namespace MFM
+{
+  /**
+   * Writes a stream of same-sized 32 bit ARGB frames to a single
+   * video file, encoding them on a background thread.  SubmitFrame
+   * only copies the frame into one of a few preallocated buffers and
+   * never waits on the encoder: if all the buffers are still queued,
+   * the frame is dropped and counted instead.  Nothing here depends
+   * on SDL, so headless drivers can record as well as GUI ones.
+   *
+   * Two formats are supported:
+   *
+   * - FORMAT_Y4M: uncompressed YUV4MPEG2, 4:4:4, readable by most
+   *   video tools (e.g., 'ffmpeg -i run.y4m run.mp4');
+   *
+   * - FORMAT_DELTA: a frame log holding, for each frame, only the
+   *   BLOCK_SIZE by BLOCK_SIZE pixel blocks that changed since the
+   *   previous frame, in native byte order.  Much smaller than Y4M
+   *   when most of the screen is static; read it back with
+   *   VideoDeltaReader.
+   */
+  class VideoEncoder
+  {
+  public:
+    enum Format
+    {
+      FORMAT_Y4M,
+      FORMAT_DELTA
+    };
+
+    /**
+     * The number of frames that may be waiting for the encoder before
+     * further frames are dropped.  Must be a power of two.
+     */
+    static const u32 MAX_QUEUED_FRAMES = 8;
+
+    /**
+     * The width and height of the pixel blocks of FORMAT_DELTA.
+     */
+    static const u32 BLOCK_SIZE = 16;
+
+    /**
+     * Looks up a Format by its name ("y4m" or "delta"), storing it in
+     * \c format.
+     *
+     * @returns false if \c name is no Format's name.
+     */
+    static bool ParseFormat(const char * name, Format & format) ;
+
+    /**
+     * Gets the usual file name extension, without the dot, for \c
+     * format.
+     */
+    static const char * GetExtension(Format format) ;
+
+    VideoEncoder() ;
+
+    /**
+     * Closes the video, if one is open.
+     */
+    ~VideoEncoder() ;
+
+    /**
+     * Creates \c path, which is overwritten if it exists, and starts
+     * the encoder thread to write frames of \c width by \c height
+     * pixels to it, in \c format, to be played at \c framesPerSecond.
+     * FAILs with ILLEGAL_STATE if a video is already open.
+     *
+     * @returns true on success; on failure logs an error and returns
+     *          false.
+     */
+    bool Open(const char * path, Format format, u32 width, u32 height,
+              u32 framesPerSecond) ;
+
+    bool IsOpen() const
+    {
+      return m_file != 0;
+    }
+
+    u32 GetWidth() const
+    {
+      return m_width;
+    }
+
+    u32 GetHeight() const
+    {
+      return m_height;
+    }
+
+    /**
+     * Queues a copy of a frame for encoding.  \c pixels holds
+     * GetHeight() rows of GetWidth() pixels, each row starting \c
+     * pitchBytes after the previous.  \c label is stored with the
+     * frame in FORMAT_DELTA, e.g. to record the AEPS it shows.  FAILs
+     * with ILLEGAL_STATE if no video is open.
+     *
+     * @returns true if the frame was queued, false if it was dropped
+     *          because the encoder has fallen behind.
+     */
+    bool SubmitFrame(const u32 * pixels, u32 pitchBytes, u32 label) ;
+
+    /**
+     * Waits for every queued frame to be written, stops the encoder
+     * thread, and closes the file.  Logs how many frames were written
+     * and dropped.  Does nothing if no video is open.
+     */
+    void Close() ;
+
+    u32 GetFramesSubmitted() const
+    {
+      return __atomic_load_n(&m_framesSubmitted, __ATOMIC_RELAXED);
+    }
+
+    u32 GetFramesDropped() const
+    {
+      return __atomic_load_n(&m_framesDropped, __ATOMIC_RELAXED);
+    }
+
+    u32 GetFramesWritten() const
+    {
+      return __atomic_load_n(&m_framesWritten, __ATOMIC_ACQUIRE);
+    }
+
+    /**
+     * The fixed-size start of a FORMAT_DELTA file.
+     */
+    struct DeltaHeader
+    {
+      char m_magic[8];
+      u32 m_version;
+      u32 m_byteOrderMark;
+      u32 m_width;
+      u32 m_height;
+      u32 m_blockSize;
+      u32 m_framesPerSecond;
+    };
+
+    /**
+     * The start of each frame in a FORMAT_DELTA file.  It is followed
+     * by m_blockCount block positions, as u16 column and row pairs in
+     * units of blocks, and then the pixels of those blocks in the
+     * same order, row by row, each block clipped to the frame.
+     */
+    struct DeltaFrameHeader
+    {
+      u32 m_label;
+      u32 m_blockCount;
+    };
+
+    static const char DELTA_MAGIC[8];
+    static const u32 DELTA_VERSION = 1;
+    static const u32 BYTE_ORDER_MARK = 0x01020304;
+
+  private:
+    // Declare away copy ctor; the encoder thread holds our address
+    VideoEncoder(const VideoEncoder &) ;
+
+    FILE * m_file;
+    Format m_format;
+    u32 m_width;
+    u32 m_height;
+
+    /** MAX_QUEUED_FRAMES buffers of m_width * m_height pixels */
+    u32 * m_frames[MAX_QUEUED_FRAMES];
+    u32 m_labels[MAX_QUEUED_FRAMES];
+
+    /** FORMAT_DELTA: the last frame written */
+    u32 * m_previous;
+
+    /** Scratch space for one encoded frame */
+    u8 * m_output;
+
+    /** Runs the encoder on m_frames, by index */
+    BufferPoolThread<MAX_QUEUED_FRAMES> m_encoder;
+
+    bool m_failed;
+
+    u32 m_framesSubmitted;
+    u32 m_framesDropped;
+    u32 m_framesWritten;
+
+    bool WriteBytes(const void * bytes, u32 length) ;
+
+    bool EncodeY4M(const u32 * frame) ;
+
+    bool EncodeDelta(const u32 * frame, u32 label) ;
+
+    void EncodeFrame(u32 index) ;
+
+    static void EncodeFrameHelper(void * encoderPtr, u32 index) ;
+
+    void FreeBuffers() ;
+  };
+
+  /**
+   * Reads back, frame by frame, a video written by VideoEncoder in
+   * VideoEncoder::FORMAT_DELTA.
+   */
+  class VideoDeltaReader
+  {
+  public:
+    VideoDeltaReader() ;
+
+    ~VideoDeltaReader() ;
+
+    /**
+     * Opens the delta video at \c path, closing any already open.
+     *
+     * @returns true on success; on failure logs an error and returns
+     *          false.
+     */
+    bool Open(const char * path) ;
+
+    void Close() ;
+
+    u32 GetWidth() const
+    {
+      return m_header.m_width;
+    }
+
+    u32 GetHeight() const
+    {
+      return m_header.m_height;
+    }
+
+    u32 GetFramesPerSecond() const
+    {
+      return m_header.m_framesPerSecond;
+    }
+
+    /**
+     * Reads the next frame, leaving its GetWidth() * GetHeight()
+     * pixels, row by row, available from GetPixels(), and its label
+     * in \c label.
+     *
+     * @returns false at the end of the video, or if the video is
+     *          damaged, in which case an error is logged.
+     */
+    bool ReadFrame(u32 & label) ;
+
+    const u32 * GetPixels() const
+    {
+      return m_pixels;
+    }
+
+  private:
+    // Declare away copy ctor
+    VideoDeltaReader(const VideoDeltaReader &) ;
+
+    FILE * m_file;
+    VideoEncoder::DeltaHeader m_header;
+    u32 * m_pixels;
+  };
+}
+
+#endif /* VIDEOENCODER_H */
@@ -0,0 +1,446 @@
+#include "VideoEncoder.h"
+#include "Fail.h"
+#include "Logger.h"
+#include "Util.h"      /* For MIN */
+#include <stdlib.h>    /* For malloc, free */
+#include <string.h>    /* For memcmp, memcpy, strcmp, strerror */
+#include <errno.h>
+
+namespace MFM
+{
+  const char VideoEncoder::DELTA_MAGIC[8] = { 'M', 'F', 'M', 'D', 'V', 'I', 'D', 0 };
+
+  bool VideoEncoder::ParseFormat(const char * name, Format & format)
+  {
+    if (!strcmp(name, "y4m"))
+    {
+      format = FORMAT_Y4M;
+      return true;
+    }
+    if (!strcmp(name, "delta"))
+    {
+      format = FORMAT_DELTA;
+      return true;
+    }
+    return false;
+  }
+
+  const char * VideoEncoder::GetExtension(Format format)
+  {
+    return format == FORMAT_Y4M ? "y4m" : "mfv";
+  }
+
+  VideoEncoder::VideoEncoder() :
+    m_file(0),
+    m_format(FORMAT_DELTA),
+    m_width(0),
+    m_height(0),
+    m_previous(0),
+    m_output(0),
+    m_failed(false),
+    m_framesSubmitted(0),
+    m_framesDropped(0),
+    m_framesWritten(0)
+  {
+    for (u32 i = 0; i < MAX_QUEUED_FRAMES; ++i)
+    {
+      m_frames[i] = 0;
+      m_labels[i] = 0;
+    }
+  }
+
+  VideoEncoder::~VideoEncoder()
+  {
+    Close();
+  }
+
+  void VideoEncoder::FreeBuffers()
+  {
+    for (u32 i = 0; i < MAX_QUEUED_FRAMES; ++i)
+    {
+      free(m_frames[i]);
+      m_frames[i] = 0;
+    }
+    free(m_previous);
+    m_previous = 0;
+    free(m_output);
+    m_output = 0;
+  }
+
+  bool VideoEncoder::Open(const char * path, Format format, u32 width, u32 height,
+                          u32 framesPerSecond)
+  {
+    if (m_file)
+    {
+      FAIL(ILLEGAL_STATE);
+    }
+
+    if (width == 0 || height == 0)
+    {
+      LOG.Error("Can't record an empty %dx%d video", width, height);
+      return false;
+    }
+
+    m_format = format;
+    m_width = width;
+    m_height = height;
+
+    const u32 pixels = width * height;
+    const u32 blocks =
+      ((width + BLOCK_SIZE - 1) / BLOCK_SIZE) * ((height + BLOCK_SIZE - 1) / BLOCK_SIZE);
+    const u32 outputBytes = format == FORMAT_Y4M ?
+      6 + 3 * pixels :
+      sizeof(DeltaFrameHeader) + blocks * 2 * sizeof(u16) + pixels * sizeof(u32);
+
+    bool allocated = true;
+    for (u32 i = 0; i < MAX_QUEUED_FRAMES; ++i)
+    {
+      m_frames[i] = (u32 *) malloc(pixels * sizeof(u32));
+      allocated = allocated && m_frames[i];
+    }
+    if (format == FORMAT_DELTA)
+    {
+      m_previous = (u32 *) malloc(pixels * sizeof(u32));
+      allocated = allocated && m_previous;
+    }
+    m_output = (u8 *) malloc(outputBytes);
+    allocated = allocated && m_output;
+    if (!allocated)
+    {
+      LOG.Error("Can't allocate buffers for a %dx%d video", width, height);
+      FreeBuffers();
+      return false;
+    }
+
+    m_file = fopen(path, "wb");
+    if (!m_file)
+    {
+      LOG.Error("Can't write video '%s': %s", path, strerror(errno));
+      FreeBuffers();
+      return false;
+    }
+
+    bool ok;
+    if (format == FORMAT_Y4M)
+    {
+      ok = fprintf(m_file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n",
+                   width, height, framesPerSecond) > 0;
+    }
+    else
+    {
+      DeltaHeader header;
+      memset(&header, 0, sizeof(header));
+      memcpy(header.m_magic, DELTA_MAGIC, sizeof(header.m_magic));
+      header.m_version = DELTA_VERSION;
+      header.m_byteOrderMark = BYTE_ORDER_MARK;
+      header.m_width = width;
+      header.m_height = height;
+      header.m_blockSize = BLOCK_SIZE;
+      header.m_framesPerSecond = framesPerSecond;
+      ok = WriteBytes(&header, sizeof(header));
+    }
+    if (!ok)
+    {
+      LOG.Error("Writing video '%s' header failed: %s", path, strerror(errno));
+      fclose(m_file);
+      m_file = 0;
+      FreeBuffers();
+      return false;
+    }
+
+    m_failed = false;
+    m_framesSubmitted = m_framesDropped = m_framesWritten = 0;
+
+    if (!m_encoder.Start(EncodeFrameHelper, this))
+    {
+      LOG.Error("Can't start the encoder thread for video '%s'", path);
+      fclose(m_file);
+      m_file = 0;
+      FreeBuffers();
+      return false;
+    }
+
+    LOG.Message("Recording %dx%d %s video to '%s'", width, height, GetExtension(format), path);
+    return true;
+  }
+
+  bool VideoEncoder::SubmitFrame(const u32 * pixels, u32 pitchBytes, u32 label)
+  {
+    if (!m_file)
+    {
+      FAIL(ILLEGAL_STATE);
+    }
+
+    __atomic_add_fetch(&m_framesSubmitted, 1, __ATOMIC_RELAXED);
+
+    u32 index;
+    if (!m_encoder.Acquire(index))
+    {
+      __atomic_add_fetch(&m_framesDropped, 1, __ATOMIC_RELAXED);
+      return false;
+    }
+
+    u32 * frame = m_frames[index];
+    const u8 * row = (const u8 *) pixels;
+    for (u32 y = 0; y < m_height; ++y)
+    {
+      memcpy(frame + y * m_width, row, m_width * sizeof(u32));
+      row += pitchBytes;
+    }
+    m_labels[index] = label;
+
+    m_encoder.Queue(index);
+    return true;
+  }
+
+  void VideoEncoder::Close()
+  {
+    if (!m_file)
+    {
+      return;
+    }
+
+    m_encoder.Stop();
+
+    if (fclose(m_file) != 0 && !m_failed)
+    {
+      LOG.Error("Closing video failed: %s", strerror(errno));
+    }
+    m_file = 0;
+    FreeBuffers();
+
+    LOG.Message("Closed video: %d of %d frames written, %d dropped",
+                GetFramesWritten(), GetFramesSubmitted(), GetFramesDropped());
+  }
+
+  bool VideoEncoder::WriteBytes(const void * bytes, u32 length)
+  {
+    return fwrite(bytes, 1, length, m_file) == length;
+  }
+
+  bool VideoEncoder::EncodeY4M(const u32 * frame)
+  {
+    const u32 pixels = m_width * m_height;
+    u8 * out = m_output;
+    memcpy(out, "FRAME\n", 6);
+
+    u8 * yPlane = out + 6;
+    u8 * uPlane = yPlane + pixels;
+    u8 * vPlane = uPlane + pixels;
+
+    // ITU-R BT.601 studio swing
+    for (u32 i = 0; i < pixels; ++i)
+    {
+      const s32 r = (frame[i] >> 16) & 0xff;
+      const s32 g = (frame[i] >> 8) & 0xff;
+      const s32 b = frame[i] & 0xff;
+      yPlane[i] = (u8) ((( 66 * r + 129 * g +  25 * b + 128) >> 8) + 16);
+      uPlane[i] = (u8) (((-38 * r -  74 * g + 112 * b + 128) >> 8) + 128);
+      vPlane[i] = (u8) (((112 * r -  94 * g -  18 * b + 128) >> 8) + 128);
+    }
+
+    return WriteBytes(m_output, 6 + 3 * pixels);
+  }
+
+  bool VideoEncoder::EncodeDelta(const u32 * frame, u32 label)
+  {
+    const bool first = GetFramesWritten() == 0;
+    const u32 blocksWide = (m_width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    const u32 blocksHigh = (m_height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+    DeltaFrameHeader * header = (DeltaFrameHeader *) m_output;
+    u16 * positions = (u16 *) (header + 1);
+    header->m_label = label;
+    header->m_blockCount = 0;
+
+    // Find the changed blocks
+    for (u32 by = 0; by < blocksHigh; ++by)
+    {
+      const u32 top = by * BLOCK_SIZE;
+      const u32 rows = MIN(BLOCK_SIZE, m_height - top);
+      for (u32 bx = 0; bx < blocksWide; ++bx)
+      {
+        const u32 left = bx * BLOCK_SIZE;
+        const u32 rowBytes = MIN(BLOCK_SIZE, m_width - left) * sizeof(u32);
+        bool changed = first;
+        for (u32 y = top; !changed && y < top + rows; ++y)
+        {
+          const u32 offset = y * m_width + left;
+          changed = memcmp(frame + offset, m_previous + offset, rowBytes) != 0;
+        }
+        if (changed)
+        {
+          positions[2 * header->m_blockCount] = (u16) bx;
+          positions[2 * header->m_blockCount + 1] = (u16) by;
+          ++header->m_blockCount;
+        }
+      }
+    }
+
+    // Then append their pixels
+    u8 * out = (u8 *) (positions + 2 * header->m_blockCount);
+    for (u32 i = 0; i < header->m_blockCount; ++i)
+    {
+      const u32 left = positions[2 * i] * BLOCK_SIZE;
+      const u32 top = positions[2 * i + 1] * BLOCK_SIZE;
+      const u32 rows = MIN(BLOCK_SIZE, m_height - top);
+      const u32 rowBytes = MIN(BLOCK_SIZE, m_width - left) * sizeof(u32);
+      for (u32 y = top; y < top + rows; ++y)
+      {
+        memcpy(out, frame + y * m_width + left, rowBytes);
+        out += rowBytes;
+      }
+    }
+
+    memcpy(m_previous, frame, m_width * m_height * sizeof(u32));
+    return WriteBytes(m_output, out - m_output);
+  }
+
+  void VideoEncoder::EncodeFrame(u32 index)
+  {
+    // After a write error, keep draining but write nothing more
+    if (!m_failed)
+    {
+      const bool ok = m_format == FORMAT_Y4M ?
+        EncodeY4M(m_frames[index]) :
+        EncodeDelta(m_frames[index], m_labels[index]);
+      if (ok)
+      {
+        __atomic_add_fetch(&m_framesWritten, 1, __ATOMIC_RELEASE);
+      }
+      else
+      {
+        LOG.Error("Writing video frame failed: %s", strerror(errno));
+        m_failed = true;
+      }
+    }
+    m_encoder.Release(index);
+  }
+
+  void VideoEncoder::EncodeFrameHelper(void * encoderPtr, u32 index)
+  {
+    ((VideoEncoder *) encoderPtr)->EncodeFrame(index);
+  }
+
+  VideoDeltaReader::VideoDeltaReader() : m_file(0), m_pixels(0)
+  {
+    memset(&m_header, 0, sizeof(m_header));
+  }
+
+  VideoDeltaReader::~VideoDeltaReader()
+  {
+    Close();
+  }
+
+  void VideoDeltaReader::Close()
+  {
+    if (m_file)
+    {
+      fclose(m_file);
+      m_file = 0;
+    }
+    free(m_pixels);
+    m_pixels = 0;
+    memset(&m_header, 0, sizeof(m_header));
+  }
+
+  bool VideoDeltaReader::Open(const char * path)
+  {
+    Close();
+
+    m_file = fopen(path, "rb");
+    if (!m_file)
+    {
+      LOG.Error("Can't read video '%s': %s", path, strerror(errno));
+      return false;
+    }
+
+    if (fread(&m_header, sizeof(m_header), 1, m_file) != 1 ||
+        memcmp(m_header.m_magic, VideoEncoder::DELTA_MAGIC, sizeof(m_header.m_magic)))
+    {
+      LOG.Error("'%s' is not a delta video", path);
+      Close();
+      return false;
+    }
+
+    if (m_header.m_version != VideoEncoder::DELTA_VERSION ||
+        m_header.m_byteOrderMark != VideoEncoder::BYTE_ORDER_MARK ||
+        m_header.m_blockSize != VideoEncoder::BLOCK_SIZE ||
+        m_header.m_width == 0 || m_header.m_height == 0)
+    {
+      LOG.Error("'%s' is an unsupported delta video version, byte order, or size", path);
+      Close();
+      return false;
+    }
+
+    m_pixels = (u32 *) calloc(m_header.m_width * m_header.m_height, sizeof(u32));
+    if (!m_pixels)
+    {
+      LOG.Error("Can't allocate a %dx%d frame for '%s'",
+                m_header.m_width, m_header.m_height, path);
+      Close();
+      return false;
+    }
+    return true;
+  }
+
+  bool VideoDeltaReader::ReadFrame(u32 & label)
+  {
+    if (!m_file)
+    {
+      FAIL(ILLEGAL_STATE);
+    }
+
+    const u32 width = m_header.m_width;
+    const u32 height = m_header.m_height;
+    const u32 blockSize = m_header.m_blockSize;
+    const u32 blocksWide = (width + blockSize - 1) / blockSize;
+    const u32 blocksHigh = (height + blockSize - 1) / blockSize;
+
+    VideoEncoder::DeltaFrameHeader header;
+    const size_t got = fread(&header, 1, sizeof(header), m_file);
+    if (got == 0 && feof(m_file))
+    {
+      return false;
+    }
+    if (got != sizeof(header) || header.m_blockCount > blocksWide * blocksHigh)
+    {
+      LOG.Error("Damaged delta video frame header");
+      return false;
+    }
+
+    u16 * positions = (u16 *) malloc(header.m_blockCount * 2 * sizeof(u16) + 1);
+    if (!positions)
+    {
+      LOG.Error("Can't allocate %d delta video block positions", header.m_blockCount);
+      return false;
+    }
+
+    bool ok = fread(positions, 2 * sizeof(u16), header.m_blockCount, m_file) ==
+      header.m_blockCount;
+    for (u32 i = 0; ok && i < header.m_blockCount; ++i)
+    {
+      const u32 bx = positions[2 * i];
+      const u32 by = positions[2 * i + 1];
+      ok = bx < blocksWide && by < blocksHigh;
+      const u32 left = bx * blockSize;
+      const u32 top = by * blockSize;
+      const u32 rows = MIN(blockSize, height - top);
+      const u32 columns = MIN(blockSize, width - left);
+      for (u32 y = top; ok && y < top + rows; ++y)
+      {
+        ok = fread(m_pixels + y * width + left, sizeof(u32), columns, m_file) == columns;
+      }
+    }
+    free(positions);
+
+    if (!ok)
+    {
+      LOG.Error("Damaged delta video frame");
+      return false;
+    }
+
+    label = header.m_label;
+    return true;
+  }
+}
@@ -29,6 +29,8 @@ namespace MFM {
 
     static void Test_bitVectorLong();
 
+    static void Test_bitVectorReadWithinUnit();
+
   };
 } /* namespace MFM */
 #endif /*BITVECTOR_TEST_H*/
@@ -0,0 +1,20 @@
+#ifndef BUFFERPOOLTHREAD_TEST_H      /* -*- C++ -*- */
+#define BUFFERPOOLTHREAD_TEST_H
+
+#include "BufferPoolThread.h"
+
+namespace MFM {
+
+  /**
+   * Tests for the BufferPoolThread class
+   */
+  class BufferPoolThread_Test
+  {
+  private:
+
+  public:
+    static void Test_RunTests();
+
+  };
+} /* namespace MFM */
+#endif /*BUFFERPOOLTHREAD_TEST_H*/
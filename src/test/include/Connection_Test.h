@@ -0,0 +1,20 @@
+#ifndef CONNECTION_TEST_H      /* -*- C++ -*- */
+#define CONNECTION_TEST_H
+
+#include "Connection.h"
+
+namespace MFM {
+
+  /**
+   * Tests for the Connection class
+   */
+  class Connection_Test
+  {
+  private:
+
+  public:
+    static void Test_RunTests();
+
+  };
+} /* namespace MFM */
+#endif /*CONNECTION_TEST_H*/
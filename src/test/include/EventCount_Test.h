@@ -0,0 +1,20 @@
+#ifndef EVENTCOUNT_TEST_H      /* -*- C++ -*- */
+#define EVENTCOUNT_TEST_H
+
+#include "EventCount.h"
+
+namespace MFM {
+
+  /**
+   * Tests for the EventCount class
+   */
+  class EventCount_Test
+  {
+  private:
+
+  public:
+    static void Test_RunTests();
+
+  };
+} /* namespace MFM */
+#endif /*EVENTCOUNT_TEST_H*/
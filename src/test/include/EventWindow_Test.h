@@ -13,6 +13,14 @@ public:
   static void Test_eventwindowConstruction();
 
   static void Test_eventwindowWrite();
+
+  static void Test_eventwindowDirtySites();
+
+  static void Test_eventwindowGatherScatter();
+
+  static void Test_eventwindowGatherOptIn();
+
+  static void Test_eventwindowSiteMasks();
 };
 } /* namespace MFM */
 #endif /*EVENTWINDOW_TEST_H*/
@@ -15,6 +15,24 @@ namespace MFM {
   {
   public:
     static void Test_gridPlaceAtom();
+
+    static void Test_gridWorkerThreads();
+
+    static void Test_gridSerialExecution();
+
+    static void Test_gridSnapshot();
+
+    static void Test_gridCheckpoints();
+
+    static void Test_gridLiveSnapshots();
+
+    static void Test_gridRasterizer();
+
+    static void Test_gridDimensions();
+
+    static void Test_gridAtomCounts();
+
+    static void Test_gridElementData();
   };
 } /* namespace MFM */
 #endif /*GRID_TEST_H*/
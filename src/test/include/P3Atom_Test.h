@@ -0,0 +1,16 @@
+#ifndef P3ATOM_TEST_H      /* -*- C++ -*- */
+#define P3ATOM_TEST_H
+
+#include "Test_Common.h"
+
+namespace MFM {
+
+class P3Atom_Test
+{
+public:
+  static void Test_p3atomTypeIfSane();
+
+  static void Test_p3atomExecuteRepair();
+};
+} /* namespace MFM */
+#endif /*P3ATOM_TEST_H*/
@@ -0,0 +1,20 @@
+#ifndef SPSCQUEUE_TEST_H      /* -*- C++ -*- */
+#define SPSCQUEUE_TEST_H
+
+#include "SPSCQueue.h"
+
+namespace MFM {
+
+  /**
+   * Tests for the SPSCQueue class
+   */
+  class SPSCQueue_Test
+  {
+  private:
+
+  public:
+    static void Test_RunTests();
+
+  };
+} /* namespace MFM */
+#endif /*SPSCQUEUE_TEST_H*/
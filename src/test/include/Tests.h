@@ -19,10 +19,16 @@
 #include "BitVector_Test.h"
 #include "Point_Test.h"
 #include "P1Atom_Test.h"
+#include "P3Atom_Test.h"
 #include "Tile_Test.h"
 #include "Grid_Test.h"
 #include "EventWindow_Test.h"
 #include "Random_Test.h"
+#include "SPSCQueue_Test.h"
+#include "Connection_Test.h"
+#include "EventCount_Test.h"
+#include "BufferPoolThread_Test.h"
+#include "VideoEncoder_Test.h"
 #include "ColorMap_Test.h"
 #include "FXP_Test.h"
 #include "ExternalConfig_Test.h"
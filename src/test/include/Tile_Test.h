@@ -13,6 +13,12 @@ namespace MFM {
   public:
 
     static void Test_tilePlaceAtom();
+
+    static void Test_tileSparseEvents();
+
+    static void Test_tileEventBatches();
+
+    static void Test_tileAtomTypes();
   };
 } /* namespace MFM */
 
@@ -0,0 +1,20 @@
+#ifndef VIDEOENCODER_TEST_H      /* -*- C++ -*- */
+#define VIDEOENCODER_TEST_H
+
+#include "VideoEncoder.h"
+
+namespace MFM {
+
+  /**
+   * Tests for the VideoEncoder and VideoDeltaReader classes
+   */
+  class VideoEncoder_Test
+  {
+  private:
+
+  public:
+    static void Test_RunTests();
+
+  };
+} /* namespace MFM */
+#endif /*VIDEOENCODER_TEST_H*/
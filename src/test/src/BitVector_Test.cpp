@@ -25,6 +25,7 @@ namespace MFM {
     Test_bitVectorSplitWrites();
     Test_bitVectorSetAndClearBits();
     Test_bitVectorStoreBits();
+    Test_bitVectorReadWithinUnit();
   }
 
   static BitVector<256> bits;
@@ -261,4 +262,16 @@ namespace MFM {
     assert(bits->ReadLong(192, 64) == (u64) -1L);
   }
 
+  void BitVector_Test::Test_bitVectorReadWithinUnit()
+  {
+    BitVector<256>* bits = setup();
+
+    assert((bits->ReadWithinUnit<0, 32>()) == 0x24681357);
+    assert((bits->ReadWithinUnit<0, 25>()) == bits->Read(0, 25));
+    assert((bits->ReadWithinUnit<9, 16>()) == bits->Read(9, 16));
+    assert((bits->ReadWithinUnit<64, 8>()) == 0x12);
+    assert((bits->ReadWithinUnit<100, 20>()) == bits->Read(100, 20));
+    assert((bits->ReadWithinUnit<255, 1>()) == 1);
+  }
+
 } /* namespace MFM */
@@ -0,0 +1,92 @@
+#include "assert.h"
+#include "BufferPoolThread_Test.h"
+#include "Util.h"
+
+namespace MFM {
+
+  typedef BufferPoolThread<4> TestPool;
+
+  struct PoolUser
+  {
+    TestPool m_pool;
+    u32 m_buffers[4];
+    u32 m_processed[100];
+    u32 m_processedCount;
+    u32 m_gate;  // The processor waits while this is zero
+  };
+
+  static void Process(void * userPtr, u32 index)
+  {
+    PoolUser & user = *(PoolUser *) userPtr;
+    while (!__atomic_load_n(&user.m_gate, __ATOMIC_ACQUIRE))
+    {
+      Sleep(0, 1000000);
+    }
+    user.m_processed[user.m_processedCount++] = user.m_buffers[index];
+    user.m_pool.Release(index);
+  }
+
+  static void Test_DropsWhenFull(PoolUser & user)
+  {
+    user.m_processedCount = 0;
+    user.m_gate = 0;
+    assert(user.m_pool.Start(Process, &user));
+    assert(user.m_pool.IsStarted());
+
+    // The processor is held, so all four buffers stay in use
+    u32 index;
+    for (u32 i = 0; i < 4; ++i)
+    {
+      assert(user.m_pool.Acquire(index));
+      user.m_buffers[index] = i;
+      user.m_pool.Queue(index);
+    }
+    assert(!user.m_pool.Acquire(index));
+
+    __atomic_store_n(&user.m_gate, 1, __ATOMIC_RELEASE);
+    user.m_pool.Flush();
+    assert(user.m_processedCount == 4);
+    for (u32 i = 0; i < 4; ++i)
+    {
+      assert(user.m_processed[i] == i);
+    }
+    assert(user.m_pool.Acquire(index));
+    user.m_pool.Stop();
+    assert(!user.m_pool.IsStarted());
+  }
+
+  static void Test_StopDrains(PoolUser & user)
+  {
+    // Restarting frees every buffer, including the one held above
+    user.m_processedCount = 0;
+    user.m_gate = 1;
+    assert(user.m_pool.Start(Process, &user));
+
+    u32 queued = 0;
+    for (u32 i = 0; i < 100; ++i)
+    {
+      u32 index;
+      if (user.m_pool.Acquire(index))
+      {
+        user.m_buffers[index] = i;
+        user.m_pool.Queue(index);
+        ++queued;
+      }
+    }
+    user.m_pool.Stop();
+
+    // Everything queued before Stop was processed, in order
+    assert(queued >= 4 && user.m_processedCount == queued);
+    for (u32 i = 1; i < queued; ++i)
+    {
+      assert(user.m_processed[i] > user.m_processed[i - 1]);
+    }
+  }
+
+  void BufferPoolThread_Test::Test_RunTests()
+  {
+    PoolUser user;
+    Test_DropsWhenFull(user);
+    Test_StopDrains(user);
+  }
+} /* namespace MFM */
@@ -0,0 +1,202 @@
+#include "assert.h"
+#include <pthread.h>
+#include <string.h>  /* For memcpy */
+#include "Connection_Test.h"
+#include "Test_Common.h"
+
+namespace MFM {
+
+  typedef Packet<TestAtom> TestPacket;
+  typedef Connection<TestAtom> TestConnection;
+
+  static TestPacket MakePacket(u32 i)
+  {
+    TestPacket packet(PACKET_EVENT_COMPLETE, (u8) i);
+    packet.SetReceivingNeighbor((Dir) (i % Dirs::DIR_COUNT));
+    packet.SetLocation(SPoint(i % 64, (i / 64) % 64));
+    return packet;
+  }
+
+  static void AssertPacket(TestPacket & packet, u32 i)
+  {
+    assert(packet.GetType() == PACKET_EVENT_COMPLETE);
+    assert(packet.GetGeneration() == (u8) i);
+    assert(packet.GetReceivingNeighbor() == i % Dirs::DIR_COUNT);
+    assert(packet.GetLocation() == SPoint(i % 64, (i / 64) % 64));
+  }
+
+  static const u32 PACKET_BYTES = sizeof(TestPacket);
+
+  static void Test_Directions()
+  {
+    TestConnection c;
+    TestPacket packet;
+
+    // The owner's writes reach the child, and vice versa
+    c.Write(false, MakePacket(1));
+    assert(c.OutputByteCount() == PACKET_BYTES && c.InputByteCount() == 0);
+    assert(!c.Read(false, packet));
+    assert(c.Read(true, packet));
+    AssertPacket(packet, 1);
+
+    c.Write(true, MakePacket(2));
+    assert(c.OutputByteCount() == 0 && c.InputByteCount() == PACKET_BYTES);
+    assert(!c.Read(true, packet));
+    assert(c.Read(false, packet));
+    AssertPacket(packet, 2);
+  }
+
+  static void Test_Batches()
+  {
+    const u32 SITES = 5;
+    TestAtom atoms[SITES];
+    u8 sites[SITES];
+    for (u32 i = 0; i < SITES; ++i)
+    {
+      atoms[i] = Element_Empty<TestCoreConfig>::THE_INSTANCE.GetDefaultAtom();
+      sites[i] = (u8) (3 * i + 1);
+    }
+
+    // The header carries just type, neighbor, generation, count and center
+    assert(PACKET_BYTES == 4 + sizeof(SSPoint));
+
+    // A batch record: its Packet, its Atoms, then their site indices
+    TestPacket header(PACKET_WRITE_BATCH, 7);
+    header.SetLocation(SPoint(4, 5));
+    header.SetBatchCount(SITES);
+    const u32 recordBytes = header.GetRecordBytes();
+    assert(recordBytes == PACKET_BYTES + SITES * (sizeof(TestAtom) + 1));
+
+    u8 record[PACKET_BYTES + SITES * (sizeof(TestAtom) + 1)];
+    memcpy(record, &header, PACKET_BYTES);
+    memcpy(record + PACKET_BYTES, atoms, SITES * sizeof(TestAtom));
+    memcpy(record + PACKET_BYTES + SITES * sizeof(TestAtom), sites, SITES);
+
+    TestConnection c;
+    c.Write(false, record, recordBytes);
+    c.Write(false, MakePacket(20));
+    assert(c.OutputByteCount() == recordBytes + PACKET_BYTES);
+
+    // Records may be walked without consuming them
+    TestPacket packet;
+    c.PeekRead(true, packet, 0);
+    assert(packet.GetType() == PACKET_WRITE_BATCH);
+    c.PeekRead(true, packet, packet.GetRecordBytes());
+    AssertPacket(packet, 20);
+
+    assert(c.Read(true, packet));
+    assert(packet.GetType() == PACKET_WRITE_BATCH);
+    assert(packet.GetGeneration() == 7);
+    assert(packet.GetLocation() == SPoint(4, 5));
+    assert(packet.GetBatchCount() == SITES);
+
+    TestAtom gotAtoms[SITES];
+    u8 gotSites[SITES];
+    c.ReadBody(true, (u8 *) gotAtoms, SITES * sizeof(TestAtom));
+    c.ReadBody(true, gotSites, SITES);
+    for (u32 i = 0; i < SITES; ++i)
+    {
+      assert(gotAtoms[i] == atoms[i]);
+      assert(gotSites[i] == sites[i]);
+    }
+
+    assert(c.Read(true, packet));
+    AssertPacket(packet, 20);
+    assert(!c.Read(true, packet));
+  }
+
+  static const u32 THREADED_COUNT = 200000;
+
+  // Small enough for either kind of queue to hold
+  static const u32 THREADED_BACKLOG = 8;
+
+  static void * Produce(void * arg)
+  {
+    TestConnection & c = *(TestConnection *) arg;
+    for (u32 i = 0; i < THREADED_COUNT; )
+    {
+      if (c.InputByteCount() < THREADED_BACKLOG * PACKET_BYTES)
+      {
+        c.Write(true, MakePacket(i++));
+      }
+      else
+      {
+        pthread_yield();  // Let the owner in, even on one core
+      }
+    }
+    return 0;
+  }
+
+  static void Test_Threaded()
+  {
+    TestConnection c;
+    pthread_t child;
+    if (pthread_create(&child, NULL, Produce, &c))
+    {
+      FAIL(ILLEGAL_STATE);
+    }
+
+    TestPacket packet;
+    for (u32 i = 0; i < THREADED_COUNT; )
+    {
+      if (c.Read(false, packet))
+      {
+        AssertPacket(packet, i);
+        ++i;
+      }
+      else
+      {
+        pthread_yield();
+      }
+    }
+    pthread_join(child, NULL);
+    assert(c.InputByteCount() == 0);
+  }
+
+  /**
+   * Returns the FailCode of Unlocking \c c from the given end, or 0
+   * if that succeeded.
+   */
+  static s32 UnlockFailure(TestConnection & c, bool child)
+  {
+    s32 failCode = 0;
+    unwind_protect({
+        failCode = MFMThrownFailCode;
+      },{
+        c.Unlock(child);
+      });
+    return failCode;
+  }
+
+  static void Test_Locking()
+  {
+    TestConnection c;
+    assert(!c.IsLocked());
+    assert(UnlockFailure(c, false) == MFM_FAIL_CODE_NUMBER(LOCK_FAILURE));
+
+    // Only one end holds the lock at a time
+    assert(c.Lock(false));
+    assert(c.IsLocked());
+    assert(!c.Lock(false));
+    assert(!c.Lock(true));
+
+    // The other end may not release it, and leaves it held
+    assert(UnlockFailure(c, true) == MFM_FAIL_CODE_NUMBER(LOCK_FAILURE));
+    assert(c.IsLocked());
+    assert(UnlockFailure(c, false) == 0);
+    assert(!c.IsLocked());
+
+    assert(c.Lock(true));
+    assert(UnlockFailure(c, false) == MFM_FAIL_CODE_NUMBER(LOCK_FAILURE));
+    assert(UnlockFailure(c, true) == 0);
+    assert(!c.IsLocked());
+  }
+
+  void Connection_Test::Test_RunTests()
+  {
+    Test_Directions();
+    Test_Locking();
+    Test_Batches();
+    Test_Threaded();
+  }
+} /* namespace MFM */
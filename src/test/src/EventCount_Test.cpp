@@ -0,0 +1,63 @@
+#include "assert.h"
+#include <pthread.h>
+#include "EventCount_Test.h"
+#include "Util.h"
+#include "Fail.h"
+
+namespace MFM {
+
+  static EventCount ec;
+  static u32 flag;
+
+  static void * SetAndNotify(void * arg)
+  {
+    Sleep(0, 20000000);  // Give the main thread time to block
+    __atomic_store_n(&flag, 1, __ATOMIC_RELEASE);
+    ec.Notify();
+    return 0;
+  }
+
+  static void Test_StaleKey()
+  {
+    const u32 key = ec.PrepareWait();
+    ec.Notify();
+    assert(ec.PrepareWait() != key);
+
+    // Already notified since key: must return without the timeout
+    const u64 start = GetNanoseconds();
+    ec.Wait(key, 10000000);
+    assert((GetNanoseconds() - start) / 1000000 < 5000);
+  }
+
+  static void Test_Wakeup()
+  {
+    pthread_t notifier;
+    flag = 0;
+    if (pthread_create(&notifier, NULL, SetAndNotify, NULL))
+    {
+      FAIL(ILLEGAL_STATE);
+    }
+
+    u32 waits = 0;
+    for (;;)
+    {
+      const u32 key = ec.PrepareWait();
+      if (__atomic_load_n(&flag, __ATOMIC_ACQUIRE))
+      {
+        break;
+      }
+      ec.Wait(key, 10000000);
+      ++waits;
+    }
+    pthread_join(notifier, NULL);
+
+    // One wait should have sufficed, barring spurious returns
+    assert(waits >= 1 && waits < 100);
+  }
+
+  void EventCount_Test::Test_RunTests()
+  {
+    Test_StaleKey();
+    Test_Wakeup();
+  }
+} /* namespace MFM */
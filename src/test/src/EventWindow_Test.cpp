@@ -1,4 +1,5 @@
 #include "ElementTable.h"
+#include "ElementDispatch.h"
 #include "Element_Dreg.h"
 #include "Element_Res.h"
 #include "assert.h"
@@ -6,6 +7,7 @@
 #include "EventWindow.h"
 #include "P1Atom.h"
 #include "Point.h"
+#include "WindowScanner.h"
 
 namespace MFM {
 
@@ -75,4 +77,245 @@ void EventWindow_Test::Test_eventwindowWrite()
 
 }
 
+void EventWindow_Test::Test_eventwindowDirtySites()
+{
+  TestTile tile;
+  TestEventWindow ew(tile);
+  SPoint center(8, 8);
+  ew.SetCenterInTile(center);
+
+  const u32 sites = ew.GetAtomCount();
+
+  ew.ClearDirtySites();
+  for (u32 i = 0; i < sites; ++i)
+  {
+    assert(!ew.IsSiteDirty(i));
+  }
+
+  ew.MarkSiteDirty(center);
+  ew.MarkSiteDirty(center + SPoint(0, -1));
+  ew.MarkSiteDirty(center + SPoint(9, 9));  // Outside window: ignored
+
+  enum { R = TestParamConfig::EVENT_WINDOW_RADIUS };
+  const s32 up = MDist<R>::get().FromPoint(SPoint(0, -1), R);
+  for (u32 i = 0; i < sites; ++i)
+  {
+    assert(ew.IsSiteDirty(i) == (i == 0 || i == (u32) up));
+  }
+
+  ew.ClearDirtySites();
+  for (u32 i = 0; i < sites; ++i)
+  {
+    assert(!ew.IsSiteDirty(i));
+  }
+}
+
+void EventWindow_Test::Test_eventwindowGatherScatter()
+{
+  TestTile tile;
+  Element_Res<TestCoreConfig>::THE_INSTANCE.AllocateType();
+  tile.RegisterElement(Element_Res<TestCoreConfig>::THE_INSTANCE);
+
+  enum { R = TestParamConfig::EVENT_WINDOW_RADIUS };
+  const MDist<R> & md = MDist<R>::get();
+  const u32 RES_TYPE = Element_Res<TestCoreConfig>::THE_INSTANCE.GetType();
+  const u32 EMPTY_TYPE = Element_Empty<TestCoreConfig>::THE_INSTANCE.GetType();
+
+  // Near enough the edge that some of the window is in the
+  // unconnected, and so not live, cache
+  SPoint center(R + 2, R + 2);
+  SPoint east(1, 0);
+  tile.PlaceAtom(TestAtom(RES_TYPE,0,0,0), center + east);
+
+  TestEventWindow ew(tile);
+  ew.SetCenterInTile(center);
+  ew.SetSymmetry(PSYM_DEG270L);  // Our (0,1) is the tile's east
+  const u32 south = (u32) md.FromPoint(SPoint(0, 1), R);
+
+  ew.Gather();
+  assert(ew.IsGathered());
+
+  // Gathered reads agree with the tile, through the symmetry
+  for (u32 i = 0; i < ew.GetAtomCount(); ++i)
+  {
+    const SPoint sp = md.GetPoint(i);
+    const SPoint loc = Map(sp, PSYM_DEG270L, sp) + center;
+    assert(ew.IsLiveSiteIndex(i) == tile.IsLiveSite(loc));
+    assert(ew.IsLiveSite(sp) == tile.IsLiveSite(loc));
+    assert(ew.GetSiteAtom(i).GetType() == tile.GetAtom(loc)->GetType());
+    assert(&ew.GetSiteAtom(i) == &ew.GetRelativeAtom(sp));
+  }
+  assert(ew.GetSiteAtom(south).GetType() == RES_TYPE);
+
+  // Writes stay in the window until scattered, and dead sites take none
+  const SPoint dead(4, 0);    // The tile's (R + 2, R - 2), in the cache
+  assert(!ew.IsLiveSite(dead));
+  assert(!ew.SetRelativeAtom(dead, TestAtom(RES_TYPE,0,0,0)));
+
+  ew.SwapCenterAtom(SPoint(0, 1));
+  assert(ew.GetCenterAtom().GetType() == RES_TYPE);
+  assert(ew.GetSiteAtom(south).GetType() == EMPTY_TYPE);
+  assert(tile.GetAtom(center)->GetType() == EMPTY_TYPE);
+  assert(tile.GetAtom(center + east)->GetType() == RES_TYPE);
+
+  ew.Scatter();
+  assert(!ew.IsGathered());
+  assert(tile.GetAtom(center)->GetType() == RES_TYPE);
+  assert(tile.GetAtom(center + east)->GetType() == EMPTY_TYPE);
+  assert(tile.GetAtom(center + SPoint(0, -4))->GetType() == EMPTY_TYPE);
+}
+
+/**
+ * Records whether its behavior ran with the window gathered
+ */
+class Element_GatherProbe : public Element<TestCoreConfig>
+{
+  typedef TestCoreConfig CC;  // For MFM_UUID_FOR
+
+public:
+  mutable bool m_ran;
+  mutable bool m_ranGathered;
+
+  Element_GatherProbe(const char * name, bool gathers) :
+    Element<TestCoreConfig>(MFM_UUID_FOR(name, 1)), m_ran(false), m_ranGathered(false)
+  {
+    SetGathersWindow(gathers);
+  }
+
+  virtual u32 PercentMovable(const TestAtom& you, const TestAtom& me,
+                             const SPoint& offset) const
+  {
+    return 0;
+  }
+
+  virtual u32 DefaultPhysicsColor() const
+  {
+    return 0xffffffff;
+  }
+
+  virtual void Behavior(EventWindow<TestCoreConfig>& window) const
+  {
+    m_ran = true;
+    m_ranGathered = window.IsGathered();
+  }
+};
+
+static Element_GatherProbe gatherProbe("GatherProbe", true);
+static Element_GatherProbe directProbe("DirectProbe", false);
+static ElementDispatch<TestCoreConfig> probeDispatch;
+
+static bool RunsGathered(TestTile & tile, const Element_GatherProbe & probe)
+{
+  SPoint center(TestParamConfig::EVENT_WINDOW_RADIUS + 2, TestParamConfig::EVENT_WINDOW_RADIUS + 2);
+  tile.PlaceAtom(probe.GetDefaultAtom(), center);
+
+  TestEventWindow ew(tile);
+  ew.SetCenterInTile(center);
+  probe.m_ran = false;
+  tile.GetElementTable().Execute(ew);
+  assert(probe.m_ran);
+  assert(!ew.IsGathered());
+  return probe.m_ranGathered;
+}
+
+void EventWindow_Test::Test_eventwindowGatherOptIn()
+{
+  TestTile tile;
+  gatherProbe.AllocateType();
+  directProbe.AllocateType();
+  tile.RegisterElement(gatherProbe);
+  tile.RegisterElement(directProbe);
+
+  // Only Elements that ask for it are gathered, by the table...
+  assert(RunsGathered(tile, gatherProbe));
+  assert(!RunsGathered(tile, directProbe));
+
+  // ...and by the dispatch, which keeps the choice as a flag
+  probeDispatch.Insert(gatherProbe);
+  probeDispatch.Insert(directProbe);
+  assert(probeDispatch.GetEntry(gatherProbe.GetType()).m_flags &
+         ElementDispatch<TestCoreConfig>::FLAG_GATHER);
+  assert(!(probeDispatch.GetEntry(directProbe.GetType()).m_flags &
+           ElementDispatch<TestCoreConfig>::FLAG_GATHER));
+
+  tile.GetElementTable().SetDispatch(&probeDispatch);
+  assert(RunsGathered(tile, gatherProbe));
+  assert(!RunsGathered(tile, directProbe));
+  tile.GetElementTable().SetDispatch(0);
+}
+
+void EventWindow_Test::Test_eventwindowSiteMasks()
+{
+  TestTile tile;
+  Element_Res<TestCoreConfig>::THE_INSTANCE.AllocateType();
+  tile.RegisterElement(Element_Res<TestCoreConfig>::THE_INSTANCE);
+
+  enum { R = TestParamConfig::EVENT_WINDOW_RADIUS };
+  const MDist<R> & md = MDist<R>::get();
+  const u32 RES_TYPE = Element_Res<TestCoreConfig>::THE_INSTANCE.GetType();
+  const u32 EMPTY_TYPE = Element_Empty<TestCoreConfig>::THE_INSTANCE.GetType();
+
+  // Some Res, some of them in the dead cache
+  SPoint center(R + 2, R + 2);
+  const SPoint res[] = { SPoint(1, 0), SPoint(0, 2), SPoint(-1, -1), SPoint(3, 1) };
+  for (u32 i = 0; i < sizeof(res) / sizeof(res[0]); ++i)
+  {
+    tile.PlaceAtom(TestAtom(RES_TYPE,0,0,0), center + res[i]);
+  }
+  tile.InternalPutAtom(TestAtom(RES_TYPE,0,0,0), center.GetX() - 4, center.GetY());
+
+  TestEventWindow ew(tile);
+  ew.SetCenterInTile(center);
+
+  for (u32 s = 0; s < PSYM_SYMMETRY_COUNT; ++s)
+  {
+    ew.SetSymmetry((PointSymmetry) s);
+    const u64 live = ew.GetLiveSiteMask();
+    const u64 resMask = ew.GetTypeSiteMask(RES_TYPE);
+    const u64 emptyMask = ew.GetTypeSiteMask(EMPTY_TYPE);
+
+    // Gathered masks match the unbuffered ones, and the atoms
+    ew.Gather();
+    assert(ew.GetLiveSiteMask() == live);
+    assert(ew.GetTypeSiteMask(RES_TYPE) == resMask);
+    assert(ew.GetTypeSiteMask(EMPTY_TYPE) == emptyMask);
+    for (u32 i = 0; i < ew.GetAtomCount(); ++i)
+    {
+      const bool isLive = (live >> i) & 1;
+      assert(isLive == ew.IsLiveSiteIndex(i));
+      assert(((resMask >> i) & 1) == (isLive && ew.GetSiteAtom(i).GetType() == RES_TYPE));
+    }
+    assert(!(resMask & emptyMask));
+    assert((resMask | emptyMask) == live);
+
+    // Four live Res, one of them out of radius 2
+    WindowScanner<TestCoreConfig> scanner(ew);
+    assert(scanner.CountAtomsOfType(RES_TYPE, R) == 4);
+    assert(scanner.CountAtomsOfType(RES_TYPE, 2) == 3);
+    assert(scanner.CanSeeAtomOfType(RES_TYPE, 1));
+    assert(scanner.CountMooreNeighbors(RES_TYPE) == 2);
+    assert(scanner.CountVonNeumannNeighbors(RES_TYPE) == 1);
+
+    for (u32 tries = 0; tries < 20; ++tries)
+    {
+      SPoint found;
+      assert(scanner.FindRandomLocationOfType(RES_TYPE, 2, found) == 3);
+      assert(ew.GetRelativeAtom(found).GetType() == RES_TYPE);
+      assert(found.GetManhattanLength() <= 2);
+    }
+
+    // Writes show up in the masks at once
+    SPoint vn;
+    assert(scanner.FindRandomInVonNeumann(RES_TYPE, vn) == 1);
+    ew.SetRelativeAtom(vn, TestAtom(EMPTY_TYPE,0,0,0));
+    assert(scanner.CountVonNeumannNeighbors(RES_TYPE) == 0);
+    assert(ew.GetTypeSiteMask(EMPTY_TYPE) ==
+           (emptyMask | ((u64) 1 << md.FromPoint(vn, R))));
+
+    // Put back before scattering, leaving the tile as it was
+    ew.SetRelativeAtom(vn, TestAtom(RES_TYPE,0,0,0));
+    ew.Scatter();
+  }
+}
+
 } /* namespace MFM */
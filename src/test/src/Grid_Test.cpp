@@ -2,7 +2,15 @@
 #include "Grid.h"
 #include "P1Atom.h"
 #include "Grid_Test.h"
+#include "GridSnapshot.h"
+#include "GridRasterizer.h"
 #include "Element_Res.h"
+#include "Element_Emitter.h"
+#include "Element_Consumer.h"
+#include <stdlib.h>  /* For mkstemp, mkdtemp */
+#include <stdio.h>   /* For snprintf, fopen */
+#include <string.h>  /* For memcmp */
+#include <unistd.h>  /* For close, unlink, rmdir */
 
 namespace MFM {
 
@@ -28,4 +36,473 @@ namespace MFM {
     assert(out->GetType() == atom.GetType());
 
   }
+
+  /** Places 100 Res across the grid, including the Tiles' shared regions */
+  static void PlaceRes(TestGrid & grid)
+  {
+    grid.Needed(Element_Res<TestCoreConfig>::THE_INSTANCE);
+
+    TestAtom atom(Element_Res<TestCoreConfig>::THE_INSTANCE.GetDefaultAtom());
+    for (u32 i = 0; i < 100; ++i)
+    {
+      SPoint gloc((i * 7) % grid.GetWidthSites(),
+                  (i * 13) % grid.GetHeightSites());
+      grid.PlaceAtom(atom, gloc);
+    }
+  }
+
+  void Grid_Test::Test_gridWorkerThreads()
+  {
+    ElementRegistry<TestCoreConfig> ereg;
+    TestGrid grid(ereg);
+
+    grid.SetSeed(1);
+    grid.Reinit();
+    grid.SetWorkerThreads(2);
+    assert(grid.IsUsingWorkerThreads());
+
+    const ElementType resType = Element_Res<TestCoreConfig>::THE_INSTANCE.GetType();
+    PlaceRes(grid);
+    grid.RecountAtoms();
+    const u32 placed = grid.GetAtomCount(resType);
+
+    for (u32 i = 0; i < 3; ++i)
+    {
+      grid.Unpause();
+      Sleep(0, 20000000);
+      grid.Pause();
+    }
+
+    assert(grid.GetTotalEventsExecuted() > 0);
+
+    // Res just wanders; all of it should still be here
+    grid.RecountAtoms();
+    assert(grid.GetAtomCount(resType) == placed);
+  }
+
+  static void SetUpSerialGrid(TestGrid & grid)
+  {
+    grid.SetSeed(1);
+    grid.Reinit();
+    grid.SetSerialExecution(true);
+    PlaceRes(grid);
+  }
+
+  static void AssertSameAtoms(TestGrid & grid1, TestGrid & grid2)
+  {
+    for (u32 x = 0; x < grid1.GetWidthSites(); ++x)
+    {
+      for (u32 y = 0; y < grid1.GetHeightSites(); ++y)
+      {
+        SPoint loc(x, y);
+        assert(*grid1.GetAtom(loc) == *grid2.GetAtom(loc));
+      }
+    }
+  }
+
+  void Grid_Test::Test_gridSerialExecution()
+  {
+    ElementRegistry<TestCoreConfig> ereg;
+    TestGrid grid1(ereg);
+    TestGrid grid2(ereg);
+
+    SetUpSerialGrid(grid1);
+    SetUpSerialGrid(grid2);
+
+    const u64 EVENTS = 20000;
+    grid1.ExecuteSerialEvents(EVENTS);
+    grid2.ExecuteSerialEvents(EVENTS / 2);
+    grid2.ExecuteSerialEvents(EVENTS - EVENTS / 2);
+
+    // Every attempted event happens, since there's no lock to miss
+    assert(grid1.GetTotalEventsExecuted() == EVENTS);
+
+    // Same seed, same events: same grid, atom for atom
+    AssertSameAtoms(grid1, grid2);
+
+    // Each event is reported in the Tile that ran it, grid not being square
+    assert(grid1.GetWidth() != grid1.GetHeight());
+    for (u32 i = 0; i < 100; ++i)
+    {
+      u64 before[TestGrid::MAX_TILES];
+      for (u32 x = 0; x < grid1.GetWidth(); ++x)
+      {
+        for (u32 y = 0; y < grid1.GetHeight(); ++y)
+        {
+          before[x * grid1.GetHeight() + y] = grid1.GetTile(x, y).GetEventsExecuted();
+        }
+      }
+      grid1.ExecuteSerialEvents(1);
+      SPoint last;
+      grid1.FillLastEventTile(last);
+      const u32 lastIndex = last.GetX() * grid1.GetHeight() + last.GetY();
+      assert(grid1.GetTile(last).GetEventsExecuted() == before[lastIndex] + 1);
+    }
+  }
+
+  void Grid_Test::Test_gridSnapshot()
+  {
+    ElementRegistry<TestCoreConfig> ereg;
+    TestGrid grid1(ereg);
+    TestGrid grid2(ereg);
+
+    SetUpSerialGrid(grid1);
+    SetUpSerialGrid(grid2);
+
+    const u64 EVENTS = 5000;
+    grid1.ExecuteSerialEvents(EVENTS);
+    grid2.ExecuteSerialEvents(EVENTS / 3);  // Diverge, atoms and randoms both
+
+    char path[] = "/tmp/Grid_Test-XXXXXX";
+    const s32 fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+
+    GridSnapshot<TestGridConfig> save(grid1);
+    assert(save.Write(path));
+    assert(GridSnapshot<TestGridConfig>::IsSnapshotFile(path));
+
+    GridSnapshot<TestGridConfig> load(grid2);
+    assert(load.Read(path));
+    unlink(path);
+
+    AssertSameAtoms(grid1, grid2);
+
+    // Random states came along too, so the futures match as well
+    grid1.ExecuteSerialEvents(EVENTS);
+    grid2.ExecuteSerialEvents(EVENTS);
+    AssertSameAtoms(grid1, grid2);
+  }
+
+  void Grid_Test::Test_gridCheckpoints()
+  {
+    ElementRegistry<TestCoreConfig> ereg;
+    TestGrid grid1(ereg);
+    TestGrid grid2(ereg);
+
+    SetUpSerialGrid(grid1);
+    SetUpSerialGrid(grid2);
+
+    char dir[] = "/tmp/Grid_Test-XXXXXX";
+    assert(mkdtemp(dir));
+
+    const u32 CHECKPOINTS = 3;
+    char paths[CHECKPOINTS][64];
+    GridSnapshot<TestGridConfig> save(grid1);
+    GridSnapshot<TestGridConfig>::Checkpoint last;
+
+    for (u32 i = 0; i < CHECKPOINTS; ++i)
+    {
+      grid1.ExecuteSerialEvents(500);
+      snprintf(paths[i], sizeof(paths[i]), "%s/%d.mfb", dir, i);
+      assert(save.WriteCheckpoint(paths[i], last, CHECKPOINTS));
+      assert(last.m_deltas == i);
+    }
+
+    // The last delta rebuilds the whole grid from the chain
+    GridSnapshot<TestGridConfig> load(grid2);
+    assert(load.Read(paths[CHECKPOINTS - 1]));
+    AssertSameAtoms(grid1, grid2);
+
+    // Including the random states of Tiles whose Atoms never changed
+    grid1.ExecuteSerialEvents(5000);
+    grid2.ExecuteSerialEvents(5000);
+    AssertSameAtoms(grid1, grid2);
+
+    for (u32 i = 0; i < CHECKPOINTS; ++i)
+    {
+      unlink(paths[i]);
+    }
+    rmdir(dir);
+  }
+
+  void Grid_Test::Test_gridLiveSnapshots()
+  {
+    ElementRegistry<TestCoreConfig> ereg;
+    TestGrid grid(ereg);
+
+    grid.SetSeed(1);
+    grid.Reinit();
+    grid.SetPublishingSnapshots(true);
+
+    const ElementType resType = Element_Res<TestCoreConfig>::THE_INSTANCE.GetType();
+    PlaceRes(grid);
+    grid.RecountAtoms();
+    const u32 placed = grid.GetAtomCount(resType);
+
+    // Paused, snapshots are taken on the spot
+    grid.RequestSnapshots();
+    assert(!grid.IsReadingSnapshots());
+    for (u32 x = 0; x < grid.GetWidthSites(); ++x)
+    {
+      for (u32 y = 0; y < grid.GetHeightSites(); ++y)
+      {
+        SPoint loc(x, y);
+        assert(*grid.GetDisplayAtom(loc) == *grid.GetAtom(loc));
+      }
+    }
+
+    grid.Unpause();
+    assert(grid.IsReadingSnapshots());
+    assert(grid.GetAtomCount(resType) == placed);
+
+    Sleep(0, 20000000);
+    grid.RequestSnapshots();
+
+    // Running, the tiles publish between events
+    for (u32 tries = 0; tries < 1000; ++tries)
+    {
+      bool pending = false;
+      for (u32 x = 0; x < grid.GetWidth(); ++x)
+      {
+        for (u32 y = 0; y < grid.GetHeight(); ++y)
+        {
+          pending = pending || grid.GetTile(x, y).IsSnapshotRequested();
+        }
+      }
+      if (!pending)
+      {
+        break;
+      }
+      Sleep(0, 1000000);
+    }
+    const u64 seen = grid.GetTotalEventsExecuted();
+    assert(seen > 0);
+
+    grid.Pause();
+    assert(!grid.IsReadingSnapshots());
+    assert(grid.GetTotalEventsExecuted() >= seen);
+
+    grid.RecountAtoms();
+    assert(grid.GetAtomCount(resType) == placed);
+  }
+
+  void Grid_Test::Test_gridRasterizer()
+  {
+    ElementRegistry<TestCoreConfig> ereg;
+    TestGrid grid(ereg);
+
+    grid.SetSeed(1);
+    grid.Reinit();
+
+    Element<TestCoreConfig> & res = Element_Res<TestCoreConfig>::THE_INSTANCE;
+    grid.Needed(res);
+
+    TestAtom atom(res.GetDefaultAtom());
+    const SPoint gloc(5, 10);
+    grid.PlaceAtom(atom, gloc);
+
+    char dir[] = "/tmp/Grid_Test-XXXXXX";
+    assert(mkdtemp(dir));
+
+    const u32 PPS = 2;
+    GridRasterizer<TestGridConfig> rasterizer(grid);
+    GridRasterizer<TestGridConfig>::Output output;
+    assert(GridRasterizer<TestGridConfig>::ParseOutput("ppm", output));
+    assert(!GridRasterizer<TestGridConfig>::ParseOutput("png", output));
+    assert(rasterizer.Start(dir, output, PPS, 30));
+
+    const u32 width = rasterizer.GetImageWidth();
+    const u32 height = rasterizer.GetImageHeight();
+    assert(width == grid.GetWidthSites() * PPS);
+    assert(height == grid.GetHeightSites() * PPS);
+
+    assert(rasterizer.Capture(7));
+    rasterizer.Stop();
+    assert(rasterizer.GetCapturesWritten() == 1);
+
+    char path[64];
+    snprintf(path, sizeof(path), "%s/%010d.ppm", dir, 7);
+    FILE * fp = fopen(path, "rb");
+    assert(fp);
+
+    char header[64];
+    const s32 headerLength = snprintf(header, sizeof(header),
+                                      "P6\n# AEPS 7\n%d %d\n255\n", width, height);
+    const u32 imageBytes = headerLength + 3 * width * height;
+    u8 * image = (u8 *) malloc(imageBytes + 1);
+    assert(fread(image, 1, imageBytes + 1, fp) == imageBytes);
+    fclose(fp);
+    assert(!memcmp(image, header, headerLength));
+
+    const u32 color = res.LocalPhysicsColor(atom, 0);
+    const u8 * rgb = image + headerLength;
+    for (u32 y = 0; y < height; ++y)
+    {
+      for (u32 x = 0; x < width; ++x)
+      {
+        const bool isRes = x / PPS == (u32) gloc.GetX() && y / PPS == (u32) gloc.GetY();
+        const u32 expected = isRes ? color : GridRasterizer<TestGridConfig>::EMPTY_COLOR;
+        const u8 * pixel = rgb + 3 * (y * width + x);
+        assert(pixel[0] == ((expected >> 16) & 0xff));
+        assert(pixel[1] == ((expected >> 8) & 0xff));
+        assert(pixel[2] == (expected & 0xff));
+      }
+    }
+    free(image);
+
+    unlink(path);
+    rmdir(dir);
+  }
+
+  void Grid_Test::Test_gridDimensions()
+  {
+    ElementRegistry<TestCoreConfig> ereg;
+    TestGrid grid(ereg);
+
+    assert(grid.GetWidth() == TestGridConfig::GRID_WIDTH);
+    assert(grid.GetHeight() == TestGridConfig::GRID_HEIGHT);
+
+    // Sizes out of range are refused, even where width * height wraps
+    const u32 badSizes[][2] = {
+      { 0, 1 }, { 1, 0 }, { TestGrid::MAX_TILES + 1, 1 }, { 1, TestGrid::MAX_TILES + 1 },
+      { 65, 64 }, { 2, 1u << 31 }, { 1u << 31, 2 }, { 1u << 16, 1u << 16 }
+    };
+    for (u32 i = 0; i < sizeof(badSizes) / sizeof(badSizes[0]); ++i)
+    {
+      s32 failCode = 0;
+      unwind_protect({
+          failCode = MFMThrownFailCode;
+        },{
+          grid.SetDimensions(badSizes[i][0], badSizes[i][1]);
+        });
+      assert(failCode == MFM_FAIL_CODE_NUMBER(ILLEGAL_ARGUMENT));
+      assert(grid.GetWidth() == TestGridConfig::GRID_WIDTH);
+      assert(grid.GetHeight() == TestGridConfig::GRID_HEIGHT);
+    }
+
+    const u32 OWNED_SIDE = Tile<TestCoreConfig>::OWNED_SIDE;
+    grid.SetDimensions(2, 5);
+    assert(grid.GetWidth() == 2);
+    assert(grid.GetHeight() == 5);
+    assert(grid.GetWidthSites() == 2 * OWNED_SIDE);
+    assert(grid.GetHeightSites() == 5 * OWNED_SIDE);
+    assert(grid.IsLegalTileIndex(SPoint(1, 4)));
+    assert(!grid.IsLegalTileIndex(SPoint(2, 0)));
+    assert(!grid.IsLegalTileIndex(SPoint(0, 5)));
+
+    // Pinning rehomes the Tiles, keeping the dimensions, and assigns their CPUs
+    grid.SetThreadPinning(true);
+    assert(grid.GetWidth() == 2 && grid.GetHeight() == 5);
+    u32 cpus[CoreAffinity::MAX_CPUS];
+    const bool haveCPUs = CoreAffinity::GetCPUsBySocket(cpus, CoreAffinity::MAX_CPUS) > 0;
+    for (u32 x = 0; x < grid.GetWidth(); ++x)
+    {
+      for (u32 y = 0; y < grid.GetHeight(); ++y)
+      {
+        assert((grid.GetTile(x, y).GetPinnedCPU() >= 0) == haveCPUs);
+      }
+    }
+
+    // Atoms in the far corner reach the resized Tiles
+    SetUpSerialGrid(grid);
+    SPoint corner(grid.GetWidthSites() - 1, grid.GetHeightSites() - 1);
+    TestAtom atom(Element_Res<TestCoreConfig>::THE_INSTANCE.GetDefaultAtom());
+    grid.PlaceAtom(atom, corner);
+    assert(grid.GetAtom(corner)->GetType() == atom.GetType());
+
+    const ElementType resType = Element_Res<TestCoreConfig>::THE_INSTANCE.GetType();
+    grid.RecountAtoms();
+    const u32 placed = grid.GetAtomCount(resType);
+
+    const u64 EVENTS = 5000;
+    grid.ExecuteSerialEvents(EVENTS);
+    assert(grid.GetTotalEventsExecuted() == EVENTS);
+    grid.RecountAtoms();
+    assert(grid.GetAtomCount(resType) == placed);
+  }
+
+  void Grid_Test::Test_gridAtomCounts()
+  {
+    ElementRegistry<TestCoreConfig> ereg;
+    TestGrid grid(ereg);
+
+    SetUpSerialGrid(grid);
+    const ElementType resType = Element_Res<TestCoreConfig>::THE_INSTANCE.GetType();
+    const TestAtom res(Element_Res<TestCoreConfig>::THE_INSTANCE.GetDefaultAtom());
+
+    // Kept as Atoms are placed, with no recount
+    const u32 placed = grid.GetAtomCount(resType);
+    assert(placed > 0);
+    SPoint loc(1, 2);
+    assert(grid.GetAtom(loc)->GetType() != resType);
+    grid.PlaceAtom(res, loc);
+    assert(grid.GetAtomCount(resType) == placed + 1);
+
+    // Behind the Tiles' backs, only a recount notices, and it reads
+    // the Atoms themselves, whatever the build keeps beside them
+    SPoint other(3, 2);
+    assert(grid.GetAtom(other)->GetType() == Element_Empty<TestCoreConfig>::THE_INSTANCE.GetType());
+    const u32 active = grid.GetTile(0, 0).GetActiveSiteCount();
+    *grid.GetWritableAtom(other) = res;
+    assert(grid.GetAtomCount(resType) == placed + 1);
+    grid.RecountAtoms();
+    assert(grid.GetAtomCount(resType) == placed + 2);
+    assert(grid.GetTile(0, 0).GetActiveSiteCount() == active + 1);
+    assert(grid.GetCountRepairs() == 0);
+
+    // Checks wait for the next events, and count what they repair
+    *grid.GetWritableAtom(loc) = Element_Empty<TestCoreConfig>::THE_INSTANCE.GetDefaultAtom();
+    grid.CheckAtomCounts();
+    assert(grid.GetAtomCount(resType) == placed + 2);
+    grid.ExecuteSerialEvents(10000);
+    assert(grid.GetAtomCount(resType) == placed + 1);
+    assert(grid.GetCountRepairs() == 1);
+  }
+
+  void Grid_Test::Test_gridElementData()
+  {
+    typedef Element_Emitter<TestCoreConfig> Emitter;
+    typedef Element_Consumer<TestCoreConfig> Consumer;
+
+    ElementRegistry<TestCoreConfig> ereg;
+    TestGrid grid(ereg);
+
+    SetUpSerialGrid(grid);
+    grid.Needed(Emitter::THE_INSTANCE);
+    grid.Needed(Consumer::THE_INSTANCE);
+    const u32 emType = Emitter::THE_INSTANCE.GetType();
+    const u32 cnType = Consumer::THE_INSTANCE.GetType();
+
+    // Needed put each slot at the same offset in every Tile
+    const s32 emitted =
+      grid.GetElementDataOffset(emType, Emitter::DATA_SLOT_COUNT, Emitter::DATUMS_EMITTED_SLOT);
+    const s32 rejected =
+      grid.GetElementDataOffset(emType, Emitter::DATA_SLOT_COUNT, Emitter::DATUMS_REJECTED_SLOT);
+    const s32 consumed =
+      grid.GetElementDataOffset(cnType, Consumer::DATA_SLOT_COUNT, Consumer::DATUMS_CONSUMED_SLOT);
+    assert(emitted >= 0 && rejected == emitted + 1);
+    assert(consumed >= 0 && consumed != emitted && consumed != rejected);
+    assert(grid.GetElementDataOffset(emType, Emitter::DATA_SLOT_COUNT + 1, 0) < 0);
+    assert(grid.GetElementDataOffset(emType, Emitter::DATA_SLOT_COUNT,
+                                     Emitter::DATA_SLOT_COUNT) < 0);
+    assert(grid.GetElementDataOffset(Element_Res<TestCoreConfig>::THE_INSTANCE.GetType(), 1, 0) < 0);
+
+    // What the Elements count per Tile, the Grid sums by offset
+    assert(grid.SumElementData(emitted, false) == 0);
+    u64 expected = 0;
+    for (u32 x = 0; x < grid.GetWidth(); ++x)
+    {
+      for (u32 y = 0; y < grid.GetHeight(); ++y)
+      {
+        ElementTable<TestCoreConfig> & et = grid.GetTile(x, y).GetElementTable();
+        u64 * datap = et.GetDataAndRegister(emType, Emitter::DATA_SLOT_COUNT);
+        const u64 delta = x * grid.GetHeight() + y + 1;
+        ElementTable<TestCoreConfig>::AddElementData(datap[Emitter::DATUMS_EMITTED_SLOT], delta);
+        expected += delta;
+      }
+    }
+    assert(grid.SumElementData(emitted, false) == expected);
+    assert(grid.SumElementData(rejected, false) == 0);
+    assert(grid.SumElementData(emitted, true) == expected);
+    assert(grid.SumElementData(emitted, false) == 0);
+
+    // Consumer's own readers take through the same slots
+    TestTile & tile = grid.GetTile(1, 2);
+    u64 * datap = tile.GetElementTable().GetDataAndRegister(cnType, Consumer::DATA_SLOT_COUNT);
+    ElementTable<TestCoreConfig>::AddElementData(datap[Consumer::DATUMS_CONSUMED_SLOT], 3);
+    assert(grid.SumElementData(consumed, false) == 3);
+    assert(Consumer::THE_INSTANCE.GetAndResetDatumsConsumed(tile) == 3);
+    assert(grid.SumElementData(consumed, false) == 0);
+  }
 } /* namespace MFM */
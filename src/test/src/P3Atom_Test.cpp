@@ -0,0 +1,157 @@
+#include "assert.h"
+#include <string.h>
+#include "P3Atom_Test.h"
+#include "P3Atom.h"
+#include "AtomSerializer.h"
+#include "CharBufferByteSource.h"
+
+namespace MFM {
+
+typedef P3Atom<TestParamConfig> TestP3Atom;
+typedef CoreConfig<TestP3Atom, TestParamConfig> TestP3CoreConfig;
+
+/**
+ * Returns \c atom with bit \c bit of its fixed header flipped, going
+ * through the hex text of its bits since they are not public.
+ */
+static TestP3Atom FlipBit(const TestP3Atom & atom, u32 bit)
+{
+  TestP3Atom flipped(atom);
+  AtomSerializer<TestP3CoreConfig> as(flipped);
+
+  OString128 text;
+  as.PrintTo(text);
+  char hex[130];
+  strcpy(hex, text.GetZString());
+
+  // Each hex digit holds four bits, lowest numbered as its MSB
+  const char digits[] = "0123456789ABCDEF";
+  const char * digit = strchr(digits, hex[bit / 4]);
+  assert(digit);
+  hex[bit / 4] = digits[(digit - digits) ^ (8 >> (bit % 4))];
+
+  CharBufferByteSource cbs(hex, strlen(hex));
+  assert(as.ReadFrom(cbs) == ByteSerializable::SUCCESS);
+  return flipped;
+}
+
+void P3Atom_Test::Test_p3atomTypeIfSane()
+{
+  const u32 types[] = { 0, 1, 0x00ff, 0x7c1f, 0xfffe };
+  for (u32 t = 0; t < sizeof(types) / sizeof(types[0]); ++t)
+  {
+    const TestP3Atom atom(types[t], 0, 0, 0);
+    assert(atom.IsSane());
+    assert(atom.GetTypeIfSane() == types[t]);
+
+    // Any one flipped header bit makes it insane, and is repairable
+    for (u32 bit = 0; bit < TestP3Atom::P3_FIXED_HEADER_LEN; ++bit)
+    {
+      TestP3Atom damaged = FlipBit(atom, bit);
+      assert(!damaged.IsSane());
+      assert(damaged.GetTypeIfSane() == TestP3Atom::INSANE_TYPE);
+
+      assert(damaged.HasBeenRepaired());
+      assert(damaged == atom);
+      assert(damaged.GetTypeIfSane() == types[t]);
+    }
+
+    // Agrees with IsSane and GetType even when two bits flip
+    for (u32 b1 = 0; b1 < TestP3Atom::P3_FIXED_HEADER_LEN; ++b1)
+    {
+      for (u32 b2 = b1 + 1; b2 < TestP3Atom::P3_FIXED_HEADER_LEN; ++b2)
+      {
+        const TestP3Atom damaged = FlipBit(FlipBit(atom, b1), b2);
+        assert(damaged.GetTypeIfSane() ==
+               (damaged.IsSane() ? damaged.GetType() : (u32) TestP3Atom::INSANE_TYPE));
+      }
+    }
+
+    // State bits are not covered
+    const TestP3Atom stateFlipped = FlipBit(atom, TestP3Atom::P3_STATE_BITS_POS);
+    assert(stateFlipped.GetTypeIfSane() == types[t]);
+  }
+}
+
+/**
+ * Records the center atom type of each event it runs
+ */
+class Element_P3Probe : public Element<TestP3CoreConfig>
+{
+  typedef TestP3CoreConfig CC;  // For MFM_UUID_FOR
+
+public:
+  mutable u32 m_events;
+
+  Element_P3Probe() : Element<TestP3CoreConfig>(MFM_UUID_FOR("P3Probe", 1)), m_events(0)
+  { }
+
+  virtual u32 PercentMovable(const TestP3Atom& you, const TestP3Atom& me,
+                             const SPoint& offset) const
+  {
+    return 0;
+  }
+
+  virtual u32 DefaultPhysicsColor() const
+  {
+    return 0xffffffff;
+  }
+
+  virtual void Behavior(EventWindow<TestP3CoreConfig>& window) const
+  {
+    assert(window.GetCenterAtom().IsSane());
+    ++m_events;
+  }
+};
+
+void P3Atom_Test::Test_p3atomExecuteRepair()
+{
+  typedef Tile<TestP3CoreConfig> TestP3Tile;
+  static TestP3Tile tile;   // Big
+  static Element_P3Probe probe;
+
+  probe.AllocateType();
+  tile.RegisterElement(probe);
+
+  enum { R = TestParamConfig::EVENT_WINDOW_RADIUS };
+  const SPoint center(R + 2, R + 2);
+  const TestP3Atom atom = probe.GetDefaultAtom();
+  EventWindow<TestP3CoreConfig> ew(tile);
+  ew.SetCenterInTile(center);
+
+  // A repairable atom is repaired in place, and its behavior runs
+  tile.PlaceAtom(FlipBit(atom, 3), center);
+  assert(tile.GetAtom(center)->GetTypeIfSane() == TestP3Atom::INSANE_TYPE);
+  probe.m_events = 0;
+  tile.GetElementTable().Execute(ew);
+  assert(probe.m_events == 1);
+  assert(*tile.GetAtom(center) == atom);
+
+  // Find damage beyond repair
+  TestP3Atom hopeless;
+  bool found = false;
+  for (u32 b1 = 0; !found && b1 < TestP3Atom::P3_FIXED_HEADER_LEN; ++b1)
+  {
+    for (u32 b2 = b1 + 1; !found && b2 < TestP3Atom::P3_FIXED_HEADER_LEN; ++b2)
+    {
+      hopeless = FlipBit(FlipBit(atom, b1), b2);
+      TestP3Atom copy(hopeless);
+      found = !hopeless.IsSane() && !copy.HasBeenRepaired();
+    }
+  }
+  assert(found);
+
+  // It FAILs, and the behavior never runs
+  tile.PlaceAtom(hopeless, center);
+  probe.m_events = 0;
+  bool failed = false;
+  unwind_protect({
+      failed = MFMThrownFailCode == MFM_FAIL_CODE_NUMBER(INCONSISTENT_ATOM);
+    },{
+      tile.GetElementTable().Execute(ew);
+    });
+  assert(failed);
+  assert(probe.m_events == 0);
+}
+
+} /* namespace MFM */
@@ -1,11 +1,16 @@
 #include "assert.h"
 #include "Random_Test.h"
+#include "RandXoshiro.h"
 #include "itype.h"
 
 namespace MFM {
 
   void Random_Test::Test_RunTests() {
     Test_randomSetSeed();
+    Test_randomDeterministics();
+    Test_randomFill();
+    Test_randomSaveLoadState();
+    Test_randomDistribution();
   }
 
   Random & Random_Test::setup()
@@ -69,4 +74,85 @@ namespace MFM {
     }
   }
 
+  void Random_Test::Test_randomFill()
+  {
+    const u32 NUMS = 100;
+    u32 nums[NUMS];
+
+    // Fill matches the same number of Creates
+    Random r1(3), r2(3);
+    r1.Fill(nums, NUMS);
+    for (u32 i = 0; i < NUMS; ++i) {
+      assert(nums[i]==r2.Create());
+    }
+
+    // And leaves the generator where they would
+    assert(r1.Create()==r2.Create());
+
+    r1.Fill(nums, 0);
+    assert(r1.Create()==r2.Create());
+  }
+
+  void Random_Test::Test_randomSaveLoadState()
+  {
+    const u32 NUMS = 100;
+    u32 state[Random::STATE_WORDS];
+
+    Random r1(4);
+    for (u32 i = 0; i < NUMS; ++i) {
+      r1.Create(i + 1);
+    }
+    r1.SaveState(state);
+
+    Random r2(5);
+    r2.LoadState(state);
+    for (u32 i = 0; i < NUMS; ++i) {
+      assert(r1.Create()==r2.Create());
+    }
+  }
+
+  void Random_Test::Test_randomDistribution()
+  {
+    // Bounds below are over ten standard deviations out
+
+    // Each value of a small, non-power-of-two range about equally often
+    Random random(6);
+    const u32 RANGE = 7;
+    const u32 PER_VALUE = 1000;
+    u32 counts[RANGE] = { 0 };
+    for (u32 i = 0; i < PER_VALUE * RANGE; ++i) {
+      ++counts[random.Create(RANGE)];
+    }
+    for (u32 i = 0; i < RANGE; ++i) {
+      assert(counts[i] > PER_VALUE - 300 && counts[i] < PER_VALUE + 300);
+    }
+
+    // A range large enough that Create must often reject and draw
+    // again: still in range, and two thirds below 2**31
+    const u32 LARGE = 3u << 30;
+    const u32 DRAWS = 3000;
+    u32 low = 0;
+    for (u32 i = 0; i < DRAWS; ++i) {
+      const u32 num = random.Create(LARGE);
+      assert(num < LARGE);
+      if (num < (1u << 31)) ++low;
+    }
+    assert(low > 2 * DRAWS / 3 - 300 && low < 2 * DRAWS / 3 + 300);
+
+    // Every output bit of the xoshiro generator is set about half the time
+    RandXoshiro xoshiro;
+    xoshiro.Seed(7);
+    const u32 OUTPUTS = 4096;
+    u32 ones[32] = { 0 };
+    for (u32 i = 0; i < OUTPUTS; ++i) {
+      const u32 word = xoshiro.Next();
+      for (u32 bit = 0; bit < 32; ++bit) {
+        ones[bit] += (word >> bit) & 1;
+      }
+    }
+    for (u32 bit = 0; bit < 32; ++bit) {
+      assert(ones[bit] > OUTPUTS / 2 - 330 && ones[bit] < OUTPUTS / 2 + 330);
+    }
+  }
+
 } /* namespace MFM */
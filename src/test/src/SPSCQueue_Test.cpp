@@ -0,0 +1,128 @@
+#include "assert.h"
+#include <pthread.h>
+#include "SPSCQueue_Test.h"
+
+namespace MFM {
+
+  typedef SPSCQueue<u32, 16> TestQueue;
+
+  static void Test_Basic()
+  {
+    TestQueue q;
+    u32 v;
+
+    assert(q.GetCapacity() == 16);
+    assert(q.ElementsAvailable() == 0);
+    assert(!q.Read(v));
+
+    for (u32 i = 0; i < 16; ++i)
+    {
+      q.Write(i);
+    }
+    assert(q.ElementsAvailable() == 16);
+
+    q.PeekRead(v, 3);
+    assert(v == 3);
+    assert(q.ElementsAvailable() == 16);
+
+    for (u32 i = 0; i < 16; ++i)
+    {
+      assert(q.Read(v));
+      assert(v == i);
+    }
+    assert(!q.Read(v));
+  }
+
+  static void Test_Wraparound()
+  {
+    TestQueue q;
+    u32 v;
+    u32 next = 0;
+    u32 expect = 0;
+
+    for (u32 round = 0; round < 100; ++round)
+    {
+      u32 batch[5];
+      for (u32 i = 0; i < 5; ++i)
+      {
+        batch[i] = next++;
+      }
+      q.Write(batch, 5);
+      for (u32 i = 0; i < 5; ++i)
+      {
+        assert(q.Read(v));
+        assert(v == expect++);
+      }
+    }
+    assert(q.ElementsAvailable() == 0);
+
+    u32 in[10];
+    u32 out[16];
+    for (u32 i = 0; i < 10; ++i)
+    {
+      in[i] = 100 + i;
+    }
+    q.Write(in, 10);
+    assert(q.Read(out, 4) == 4);
+    assert(out[0] == 100 && out[3] == 103);
+    assert(q.Read(out, 16) == 6);
+    assert(out[0] == 104 && out[5] == 109);
+    assert(q.Read(out, 16) == 0);
+
+    q.Write(7);
+    q.Flush();
+    assert(!q.Read(v));
+  }
+
+  static const u32 THREADED_COUNT = 1000000;
+
+  static void * Produce(void * arg)
+  {
+    TestQueue & q = *(TestQueue *) arg;
+    for (u32 i = 0; i < THREADED_COUNT; )
+    {
+      if (q.ElementsAvailable() < q.GetCapacity())
+      {
+        q.Write(i++);
+      }
+      else
+      {
+        pthread_yield();  // Let the consumer in, even on one core
+      }
+    }
+    return 0;
+  }
+
+  static void Test_Threaded()
+  {
+    TestQueue q;
+    pthread_t producer;
+    if (pthread_create(&producer, NULL, Produce, &q))
+    {
+      FAIL(ILLEGAL_STATE);
+    }
+
+    u32 v;
+    for (u32 i = 0; i < THREADED_COUNT; )
+    {
+      if (q.Read(v))
+      {
+        assert(v == i);
+        ++i;
+      }
+      else
+      {
+        pthread_yield();
+      }
+    }
+    pthread_join(producer, NULL);
+    assert(q.ElementsAvailable() == 0);
+  }
+
+  void SPSCQueue_Test::Test_RunTests()
+  {
+    Test_Basic();
+    Test_Wraparound();
+    Test_Threaded();
+  }
+} /* namespace MFM */
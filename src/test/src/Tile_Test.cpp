@@ -22,4 +22,115 @@ namespace MFM {
 
     assert(other.GetType() == atom.GetType());
   }
+
+  void Tile_Test::Test_tileSparseEvents()
+  {
+    TestTile tile;
+    Element_Res<TestCoreConfig>::THE_INSTANCE.AllocateType();
+    tile.RegisterElement(Element_Res<TestCoreConfig>::THE_INSTANCE);
+    const TestAtom res(Element_Res<TestCoreConfig>::THE_INSTANCE.GetDefaultAtom());
+    const TestAtom empty(Element_Empty<TestCoreConfig>::THE_INSTANCE.GetDefaultAtom());
+
+    assert(tile.GetActiveSiteCount() == 0);
+
+    tile.PlaceAtom(res, SPoint(10, 10));
+    tile.PlaceAtom(res, SPoint(12, 20));
+    tile.PlaceAtom(res, SPoint(1, 1));   // In the cache; not ours to run
+    assert(tile.GetActiveSiteCount() == 2);
+
+    tile.PlaceAtom(res, SPoint(10, 10));  // No change
+    assert(tile.GetActiveSiteCount() == 2);
+
+    tile.PlaceAtom(empty, SPoint(10, 10));
+    assert(tile.GetActiveSiteCount() == 1);
+
+    tile.RecountAtoms();
+    assert(tile.GetActiveSiteCount() == 1);
+
+    // Each event at the one active site stands for a sweep of the tile
+    tile.SetExternallyScheduled(true);
+    tile.SetSparseEvents(true);
+    const u32 EVENTS = 10;
+    tile.ExecuteEvents(EVENTS);
+    assert(tile.GetEventsExecuted() == EVENTS * tile.GetSites());
+    assert(tile.GetActiveSiteCount() == 1);
+    assert(tile.GetAtomCount(res.GetType()) == 1);
+
+    // With nothing to run, events pass one at a time
+    tile.ClearAtoms();
+    assert(tile.GetActiveSiteCount() == 0);
+    tile.ExecuteEvents(EVENTS);
+    assert(tile.GetEventsExecuted() == EVENTS * tile.GetSites() + EVENTS);
+  }
+
+  void Tile_Test::Test_tileEventBatches()
+  {
+    TestTile tile;
+    Element_Res<TestCoreConfig>::THE_INSTANCE.AllocateType();
+    tile.RegisterElement(Element_Res<TestCoreConfig>::THE_INSTANCE);
+    const TestAtom res(Element_Res<TestCoreConfig>::THE_INSTANCE.GetDefaultAtom());
+
+    for (u32 x = 4; x < 30; x += 5)
+    {
+      tile.PlaceAtom(res, SPoint(x, x));
+    }
+    const u32 placed = tile.GetAtomCount(res.GetType());
+
+    // A lone Tile needs no locks, so every chosen event runs
+    tile.SetExternallyScheduled(true);
+    tile.SetEventBatchSize(16);
+    tile.ExecuteEvents(40);
+    assert(tile.GetEventsExecuted() == 40);
+
+    tile.SetEventBatchSize(TestTile::MAX_EVENT_BATCH);
+    tile.ExecuteEvents(1000);
+    assert(tile.GetEventsExecuted() == 1040);
+    assert(tile.GetAtomCount(res.GetType()) == placed);
+  }
+
+  static void AssertAtomTypes(const TestTile & tile)
+  {
+    for (s32 x = 0; x < (s32) TestTile::TILE_WIDTH; ++x)
+    {
+      for (s32 y = 0; y < (s32) TestTile::TILE_WIDTH; ++y)
+      {
+        // XRayed types may be wider than a type plane keeps
+        assert((u16) tile.GetAtomType(x, y) == (u16) tile.GetAtom(x, y)->GetType());
+      }
+    }
+  }
+
+  void Tile_Test::Test_tileAtomTypes()
+  {
+    TestTile tile;
+    Element_Res<TestCoreConfig>::THE_INSTANCE.AllocateType();
+    tile.RegisterElement(Element_Res<TestCoreConfig>::THE_INSTANCE);
+    const TestAtom res(Element_Res<TestCoreConfig>::THE_INSTANCE.GetDefaultAtom());
+    AssertAtomTypes(tile);
+
+    for (u32 x = 4; x < 30; x += 5)
+    {
+      tile.PlaceAtom(res, SPoint(x, 33 - x));
+    }
+    AssertAtomTypes(tile);
+    assert(tile.GetAtomType(SPoint(9, 24)) == res.GetType());
+
+    tile.SetExternallyScheduled(true);
+    tile.ExecuteEvents(1000);
+    AssertAtomTypes(tile);
+
+    tile.XRay(4, 8);
+    AssertAtomTypes(tile);
+
+    // Swapping in another Tile's Atoms wholesale keeps up too
+    TestTile other;
+    other.RegisterElement(Element_Res<TestCoreConfig>::THE_INSTANCE);
+    other.PlaceAtom(res, SPoint(20, 20));
+    tile.LoadAtomArray(other.GetAtomArray());
+    AssertAtomTypes(tile);
+    assert(tile.GetAtomCount(res.GetType()) == 1);
+
+    tile.ClearAtoms();
+    AssertAtomTypes(tile);
+  }
 } /* namespace MFM */
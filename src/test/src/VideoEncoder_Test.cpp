@@ -0,0 +1,155 @@
+#include "assert.h"
+#include <stdlib.h>    /* For mkstemp */
+#include <string.h>    /* For strcmp */
+#include <unistd.h>    /* For close, unlink */
+#include <sys/stat.h>  /* For stat */
+#include "VideoEncoder_Test.h"
+#include "Util.h"      /* For Sleep */
+
+namespace MFM {
+
+  static const u32 WIDTH = 37;    // Not a multiple of the block size
+  static const u32 HEIGHT = 20;
+  static const u32 PITCH = 40;    // Pixels per row, including padding
+
+  static void MakeFrame(u32 * pixels, u32 frame)
+  {
+    for (u32 y = 0; y < HEIGHT; ++y)
+    {
+      for (u32 x = 0; x < PITCH; ++x)
+      {
+        // Frame 0 sets everything; later frames change a pixel or two
+        u32 color = 0xff000000 | (x << 8) | y;
+        if (frame > 0 && x == 3 * frame && y == 2 * frame)
+        {
+          color = 0xffffffff;
+        }
+        if (frame > 1 && x == 36 && y == 19)
+        {
+          color = 0xff123456;
+        }
+        pixels[y * PITCH + x] = color;
+      }
+    }
+  }
+
+  static void MakeTempPath(char * path)
+  {
+    const s32 fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+  }
+
+  static void Test_DeltaRoundTrip()
+  {
+    char path[] = "/tmp/VideoEncoder_Test-XXXXXX";
+    MakeTempPath(path);
+
+    u32 pixels[HEIGHT * PITCH];
+    u32 submitted = 0;
+    {
+      VideoEncoder encoder;
+      assert(encoder.Open(path, VideoEncoder::FORMAT_DELTA, WIDTH, HEIGHT, 30));
+      assert(encoder.IsOpen());
+      for (u32 frame = 0; frame < 4; ++frame)
+      {
+        MakeFrame(pixels, frame);
+        while (!encoder.SubmitFrame(pixels, PITCH * sizeof(u32), 100 + frame))
+        {
+          // Dropped; let the encoder catch up and try again
+          Sleep(0, 1000000);
+        }
+        ++submitted;
+      }
+      encoder.Close();
+      assert(!encoder.IsOpen());
+      assert(encoder.GetFramesWritten() == submitted);
+      assert(encoder.GetFramesSubmitted() == submitted + encoder.GetFramesDropped());
+    }
+
+    VideoDeltaReader reader;
+    assert(reader.Open(path));
+    assert(reader.GetWidth() == WIDTH);
+    assert(reader.GetHeight() == HEIGHT);
+    assert(reader.GetFramesPerSecond() == 30);
+
+    for (u32 frame = 0; frame < submitted; ++frame)
+    {
+      u32 label;
+      assert(reader.ReadFrame(label));
+      assert(label == 100 + frame);
+
+      MakeFrame(pixels, frame);
+      for (u32 y = 0; y < HEIGHT; ++y)
+      {
+        for (u32 x = 0; x < WIDTH; ++x)
+        {
+          assert(reader.GetPixels()[y * WIDTH + x] == pixels[y * PITCH + x]);
+        }
+      }
+    }
+    u32 label;
+    assert(!reader.ReadFrame(label));
+    reader.Close();
+
+    // Later frames held just their changed blocks: all six blocks,
+    // then the 16x16 block (0,0), then it and the 5x4 block (2,1),
+    // then the 16x16 block (0,0) again
+    const u32 FRAME_HEADER = sizeof(VideoEncoder::DeltaFrameHeader);
+    const u32 POSITION = 2 * sizeof(u16);
+    const u32 BLOCK = 16 * 16 * sizeof(u32);
+    struct stat st;
+    assert(stat(path, &st) == 0);
+    assert((u32) st.st_size == sizeof(VideoEncoder::DeltaHeader) +
+           FRAME_HEADER + 6 * POSITION + WIDTH * HEIGHT * sizeof(u32) +
+           FRAME_HEADER + POSITION + BLOCK +
+           FRAME_HEADER + 2 * POSITION + BLOCK + 5 * 4 * sizeof(u32) +
+           FRAME_HEADER + POSITION + BLOCK);
+
+    unlink(path);
+  }
+
+  static void Test_Y4M()
+  {
+    char path[] = "/tmp/VideoEncoder_Test-XXXXXX";
+    MakeTempPath(path);
+
+    u32 pixels[HEIGHT * PITCH];
+    MakeFrame(pixels, 0);
+
+    VideoEncoder encoder;
+    assert(encoder.Open(path, VideoEncoder::FORMAT_Y4M, WIDTH, HEIGHT, 25));
+    assert(encoder.SubmitFrame(pixels, PITCH * sizeof(u32), 0));
+    encoder.Close();
+    assert(encoder.GetFramesWritten() == 1);
+
+    const char header[] = "YUV4MPEG2 W37 H20 F25:1 Ip A1:1 C444\n";
+    struct stat st;
+    assert(stat(path, &st) == 0);
+    assert((u32) st.st_size == sizeof(header) - 1 + 6 + 3 * WIDTH * HEIGHT);
+
+    FILE * file = fopen(path, "rb");
+    assert(file);
+    char buffer[sizeof(header) + 6];
+    assert(fread(buffer, 1, sizeof(buffer) - 1, file) == sizeof(buffer) - 1);
+    buffer[sizeof(buffer) - 1] = 0;
+    assert(!strcmp(buffer, "YUV4MPEG2 W37 H20 F25:1 Ip A1:1 C444\nFRAME\n"));
+
+    // Black in BT.601 is Y=16
+    assert(fgetc(file) == 16);
+    fclose(file);
+
+    unlink(path);
+  }
+
+  void VideoEncoder_Test::Test_RunTests()
+  {
+    VideoEncoder::Format format;
+    assert(VideoEncoder::ParseFormat("y4m", format) && format == VideoEncoder::FORMAT_Y4M);
+    assert(VideoEncoder::ParseFormat("delta", format) && format == VideoEncoder::FORMAT_DELTA);
+    assert(!VideoEncoder::ParseFormat("png", format));
+
+    Test_DeltaRoundTrip();
+    Test_Y4M();
+  }
+} /* namespace MFM */